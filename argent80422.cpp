@@ -2,36 +2,24 @@
 // https://www.argentdata.com/catalog/product_info.php?products_id=145
 // Datasheet: https://www.sparkfun.com/datasheets/Sensors/Weather/Weather%20Sensor%20Assembly..pdf
 #include "main.h"
+#include "windvane.h"
 
 #define ANEMOMETER_PIN  33
 #define WINDVANE_PIN    34
 #define RAINGAUGE_PIN   35
 
+// The wind vane is sampled in the background at a fixed rate, and the median of each second of samples is kept
+#define VANE_SAMPLE_HZ  20
+
+static volatile uint16_t vane_median; // Median of the last second of wind vane samples
+
 Gauge anem = {};
 Gauge rain = {};
 
-Gauge::Gauge()
-{
-    lock = portMUX_INITIALIZER_UNLOCKED;
-}
-
 // Use isr wrapper since Arduino interrupt service function cannot be a class member due to implicit "this" pointer
 void IRAM_ATTR Gauge::isr()
 {
-    portENTER_CRITICAL_ISR(&lock);
-
-    uint32_t current_time = micros();
-    uint32_t delta_time = current_time - last_time;
-
-    // Ignore interrupts that are closer than 1 ms apart
-    // A reed switch would have to open and close 1000 times per second to reach this rate
-    if (delta_time > 1000)
-    {
-        last_time = current_time;
-        count++;
-        count2++;
-    }
-    portEXIT_CRITICAL_ISR(&lock);
+    counter.edge(micros()); // Debounced and lock-free: see pulsecount.h
 }
 
 // The interrupt handling routine should have the IRAM_ATTR attribute, in order for the compiler to place the code in IRAM.
@@ -39,75 +27,56 @@ void IRAM_ATTR Gauge::isr()
 void IRAM_ATTR anem_isr() { anem.isr(); }
 void IRAM_ATTR rain_isr() { rain.isr(); }
 
+// Returns the wind vane ADC value, filtered over the last second; this does no ADC work itself
 int read_wind_dir_adc()
 {
-    // Multi-sample ADC input to filter out the noise
-    int total = 0;
-    for (int i = 0; i < 16; i++)
-        total += analogRead(WINDVANE_PIN);
-    total = total / 16;
-
-    return total;
+    return vane_median;
 }
 
-// Given the ADC sensor reading, returns the wind direction 0-15, N->E->S->W->
-int wind_calc_dir(int adc)
+// Sample the wind vane at a fixed rate, away from the acquisition task. Taking the median of the samples rejects the
+// spikes that averaging would smear in, and the vane switching between two contacts does not show up as a direction
+// in between.
+static void vTask_vane(void *p)
 {
-    // ADC returns 0-4096 corresponding to 0V to 3.3V but it is not linear
-    // https://docs.espressif.com/projects/esp-idf/en/latest/api-reference/peripherals/adc.html
-
-    // This table contains values that are measured on an actual wind vane that is in use
-    // With a 10k Ohm on-board pullup
-    //
-    // Direction     Resistance  Voltage (mV)
-    // (Degrees)     (Ohms)      measured   ADC range   avg.
-    //     0     N   33k         2535       2966,2990   2978
-    //     22.5      6.57k       1308       1424,1436   1430
-    //     45    NE  8.2k        1487       1650,1664   1657
-    //     67.5      891          273       143,143     143
-
-    //     90    E   1k           303       175,178     176
-    //     112.5     688          216       68,71       70
-    //     135   SE  2.2k         596       536,545     540
-    //     157.5     1.41k        408       306,307     307
+    uint16_t samples[VANE_SAMPLE_HZ];
+    int n = 0;
+    const TickType_t xFrequency = 1000 / VANE_SAMPLE_HZ / portTICK_PERIOD_MS;
+    TickType_t xLastWakeTime = xTaskGetTickCount();
 
-    //     180   S   3.9k         921       939,945     942
-    //     202.5     3.14k        785       774,775     775
-    //     225   SW  16k         2028       2319,2337   2328
-    //     247.5     14.12k      1929       2212,2217   2215
-
-    //     270   W   120k        3051       3889,3912   3900
-    //     292.5     42.12k      2669       3173,3176   3175
-    //     315   NW  64.9k       2862       3485,3503   3494
-    //     337.5     21.88k      2266       2633,2638   2636
+    for (;;)
+    {
+        vTaskDelayUntil(&xLastWakeTime, xFrequency);
 
-    // Values are sorted and have corresponding direction index; arrays include end-point sentinels
-    static int val[1 + 16 + 1] = { 0, 70, 143, 176, 307, 540, 775, 942,1430,1657,2215,2328,2636,2978,3175,3494,3900,4096 };
-    static int dir[1 + 16 + 1] = { 5,  5,   3,   4,   7,   6,   9,   8,   1,   2,  11,  10,  15,   0,  13,  14,  12,  12 };
+        // Insert the new sample into the sorted samples of this second
+        uint16_t value = analogRead(WINDVANE_PIN);
+        int i = n++;
+        for (; (i > 0) && (samples[i - 1] > value); i--)
+            samples[i] = samples[i - 1];
+        samples[i] = value;
 
-    for (int i = 0; i < 17; i++) // i indexes from 0 to 16, so that (i + 1) = 17, max index into arrays
-    {
-        if (adc < val[i + 1])
+        if (n == VANE_SAMPLE_HZ)
         {
-            int d0 = adc - val[i];
-            int d1 = val[i + 1] - adc;
-            return (d0 < d1) ? dir[i] : dir[i + 1];
+            vane_median = samples[n / 2];
+            n = 0;
         }
     }
-    return 0; // We should NEVER be here
 }
 
 void setup_wind_rain()
 {
-    // Anemometer (wind speed) interrupt
+    // Anemometer (wind speed) counter; the pulse timestamps are used to measure the wind gusts
+    anem.keep_times(true);
     pinMode(ANEMOMETER_PIN, INPUT);
     attachInterrupt(digitalPinToInterrupt(ANEMOMETER_PIN), anem_isr, RISING);
 
-    // Rain gauge interrupt
+    // Rain gauge counter; the tip timestamps are used to calculate the rain rate
+    rain.keep_times(true);
     pinMode(RAINGAUGE_PIN, INPUT);
     attachInterrupt(digitalPinToInterrupt(RAINGAUGE_PIN), rain_isr, RISING);
 
-    // Wind vane ADC
+    // Wind vane ADC, sampled by its own task on the core that does not run the acquisition task
     pinMode(WINDVANE_PIN, INPUT);
     analogReadResolution(12); // This may be the default?
+    vane_median = analogRead(WINDVANE_PIN);
+    xTaskCreatePinnedToCore(vTask_vane, "task_vane", 2048, NULL, 1, NULL, 0);
 }
@@ -0,0 +1,66 @@
+// Benchmark runner: bench [--quick] [group...]
+#include "bench.h"
+#include "Arduino.h"
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <new>
+
+static BenchGroup *bench_first = NULL, **bench_last = &bench_first;
+static std::atomic<uint64_t> allocs(0);
+static bool quick = false;
+
+void bench_register(BenchGroup *g)
+{
+    *bench_last = g;
+    bench_last = &g->next;
+}
+
+uint64_t bench_allocs() { return allocs.load(); }
+bool bench_quick() { return quick; }
+
+void bench_report(const char *name, double ns_per_op, double allocs_per_op, double bytes_per_op)
+{
+    printf("  %-44s %12.1f ns/op %8.2f allocs/op", name, ns_per_op, allocs_per_op);
+    if (bytes_per_op)
+        printf(" %9.1f MB/s", bytes_per_op * 1e3 / ns_per_op);
+    printf("\n");
+}
+
+// Counts the allocations of the code measured, not those of the host shims around it
+void *operator new(size_t size)
+{
+    if (!host_shim_depth)
+        allocs++;
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+int main(int argc, char **argv)
+{
+    int groups = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--quick") == 0)
+            quick = true;
+        else
+            groups++;
+    }
+
+    for (BenchGroup *g = bench_first; g; g = g->next)
+    {
+        bool selected = !groups;
+        for (int i = 1; i < argc; i++)
+            selected |= strcmp(argv[i], g->name) == 0;
+        if (!selected)
+            continue;
+        printf("%s\n", g->name);
+        g->fn();
+    }
+    return 0;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+
+// Minimal benchmark harness: each BENCH group runs its operations with bench_op(), which repeats an operation for a
+// fixed time and reports its ns/op and heap allocations per op (operator new is counted by bench.cpp). With --quick,
+// every operation runs only briefly, as a smoke test.
+
+struct BenchGroup
+{
+    const char *name;
+    void (*fn)();
+    BenchGroup *next;
+};
+
+void bench_register(BenchGroup *g);
+uint64_t bench_allocs();      // Number of operator new calls so far
+bool bench_quick();
+
+struct BenchRegister
+{
+    BenchRegister(BenchGroup *g) { bench_register(g); }
+};
+
+#define BENCH(name) \
+    static void bench_##name(); \
+    static BenchGroup bench_group_##name = { #name, bench_##name, NULL }; \
+    static BenchRegister bench_reg_##name(&bench_group_##name); \
+    static void bench_##name()
+
+// Keep the compiler from optimizing a result away
+template<class T>
+static inline void bench_keep(const T& value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+void bench_report(const char *name, double ns_per_op, double allocs_per_op, double bytes_per_op);
+
+// Time the operation and report it; bytes_per_op, if given, is shown as the throughput
+template<class F>
+static void bench_op(const char *name, F op, double bytes_per_op = 0)
+{
+    typedef std::chrono::steady_clock clock;
+    const double target_ns = bench_quick() ? 1e6 : 2e8;
+    uint64_t iters = 1;
+    for (;;)
+    {
+        uint64_t allocs = bench_allocs();
+        clock::time_point start = clock::now();
+        for (uint64_t i = 0; i < iters; i++)
+            op();
+        double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+        if ((ns >= target_ns) || (iters >= (uint64_t(1) << 40)))
+        {
+            bench_report(name, ns / iters, double(bench_allocs() - allocs) / iters, bytes_per_op);
+            return;
+        }
+        iters = (ns < target_ns / 100) ? iters * 100 : uint64_t(iters * target_ns / ns) + 1;
+    }
+}
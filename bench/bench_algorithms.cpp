@@ -0,0 +1,358 @@
+// The station's algorithms against the code they replaced
+#include "bench.h"
+#include "main.h"
+#include "window.h"
+#include "snapshot.h"
+#include "textwriter.h"
+#include "wsbin.h"
+#include "rainrate.h"
+#include "windgust.h"
+#include "windvane.h"
+#include "dhtdecode.h"
+#include "pulsecount.h"
+#include "weathercalc.h"
+#include <string>
+
+// The 2-min wind average, the 2-min peak and the 10-min rain sum, then the same over 1 hr, each rescanned per sample
+// the way vTask_read_sensors used to, against the windows
+template<int N>
+static void bench_windows(const char *rescan_name, const char *window_name)
+{
+    static float avg[N], peak[N];
+    static uint8_t rain[N];
+    uint32_t next = 0, i = 0;
+    bench_op(rescan_name, [&]()
+    {
+        avg[next] = float(i % 37);
+        peak[next] = float(i % 53);
+        rain[next] = uint8_t(i % 3);
+        next = (next + 1) % N;
+        i++;
+        float sum = avg[0], max = peak[0];
+        uint32_t rain_sum = rain[0];
+        for (int k = 1; k < N; k++)
+        {
+            sum += avg[k];
+            if (peak[k] > max)
+                max = peak[k];
+            rain_sum += rain[k];
+        }
+        bench_keep(sum);
+        bench_keep(max);
+        bench_keep(rain_sum);
+    });
+
+    static WindowSum<float, N> w_avg;
+    static WindowMax<float, N> w_peak;
+    static WindowSum<uint8_t, N, uint32_t> w_rain;
+    bench_op(window_name, [&]()
+    {
+        w_avg.push(float(i % 37));
+        w_peak.push(float(i % 53));
+        w_rain.push(uint8_t(i % 3));
+        i++;
+        bench_keep(w_avg.get_sum());
+        bench_keep(w_peak.get_max());
+        bench_keep(w_rain.get_sum());
+    });
+}
+
+BENCH(window)
+{
+    bench_windows<24>("rescan, 24 samples (2 min)", "WindowSum/WindowMax, 24 samples");
+    bench_windows<120>("rescan, 120 samples (10 min)", "WindowSum/WindowMax, 120 samples");
+    bench_windows<720>("rescan, 720 samples (1 hr)", "WindowSum/WindowMax, 720 samples");
+}
+
+// Publishing and reading the weather data: a seqlock snapshot against the semaphore the web handlers used to wait on
+BENCH(seqlock)
+{
+    static SeqLock<WeatherData> lock;
+    WeatherData wd = {};
+    bench_op("SeqLock<WeatherData>::write", [&]()
+    {
+        wd.seconds++;
+        lock.write(wd);
+    });
+    bench_op("SeqLock<WeatherData>::read", [&]() { bench_keep(lock.read(wd)); });
+    bench_op("wdata_publish (critical section + write)", []() { wdata_publish(); });
+
+    SemaphoreHandle_t sem = xSemaphoreCreateMutex();
+    static WeatherData shared;
+    bench_op("semaphore take + copy + give", [&]()
+    {
+        xSemaphoreTake(sem, TickType_t(100));
+        memcpy(&wd, &shared, sizeof(wd));
+        xSemaphoreGive(sem);
+        bench_keep(wd);
+    });
+}
+
+static void sample_data(WeatherData& wd)
+{
+    memset(&wd, 0, sizeof(wd));
+    strcpy(wd.id, "station-1");
+    strcpy(wd.tag, "Backyard, 2 m above ground");
+    wd.seconds = 123456;
+    wd.temp_c_calib = -0.5f;
+    wd.temp_c = 21.37f;
+    wd.temp_f = 70.47f;
+    wd.pressure = 1013.25f;
+    wd.humidity = 48.2f;
+    wd.wind_peak = 12.3f;
+    wd.wind_rt = 7.46f;
+    wd.wind_avg = 6.9f;
+    wd.wind_dir_rt = 5;
+    wd.wind_dir_avg = 117;
+    wd.rain_calib = 0.021f;
+    wd.rain_rate = 4;
+    wd.rain_event = 17;
+    wd.rain_event_cnt = 2;
+    wd.rain_total = 1234;
+}
+
+// String(float) of the Arduino core: dtostrf into a temporary, then a new String
+static std::string str_float(float v, int decimals = 2)
+{
+    char tmp[33];
+    snprintf(tmp, sizeof(tmp), "%.*f", decimals, double(v));
+    return std::string(tmp);
+}
+
+// The /json weather fields, built the way webserver_set_response used to with String concatenations, against the
+// TextWriter into a static buffer
+BENCH(serializer)
+{
+    WeatherData wd;
+    sample_data(wd);
+    static char buf[512];
+    auto render = [&]()
+    {
+        TextWriter w(buf, sizeof(buf));
+        w.str("{");
+        w.str(" \"id\":\"").str(wd.id).str("\"");
+        w.str(", \"tag\":\"").str(wd.tag).str("\"");
+        w.str(", \"uptime\":").u32(wd.seconds);
+        w.str(", \"temp_c_calib\":").fixed(wd.temp_c_calib, 2);
+        w.str(", \"temp_c\":").fixed(wd.temp_c);
+        w.str(", \"temp_f\":").fixed(wd.temp_f);
+        w.str(", \"pressure\":").fixed(wd.pressure);
+        w.str(", \"humidity\":").fixed(wd.humidity);
+        w.str(", \"wind_peak\":").fixed(wd.wind_peak);
+        w.str(", \"wind_rt\":").fixed(wd.wind_rt);
+        w.str(", \"wind_avg\":").fixed(wd.wind_avg);
+        w.str(", \"wind_dir_rt\":").i32(wd.wind_dir_rt);
+        w.str(", \"wind_dir_avg\":").i32(wd.wind_dir_avg);
+        w.str(", \"rain_calib\":").fixed(wd.rain_calib, 4);
+        w.str(", \"rain_rate\":").u32(wd.rain_rate);
+        w.str(", \"rain_event\":").u32(wd.rain_event);
+        w.str(", \"rain_event_cnt\":").u32(wd.rain_event_cnt);
+        w.str(", \"rain_total\":").u32(wd.rain_total);
+        w.str(" }");
+        return w.length();
+    };
+    const double len = double(render());
+
+    static std::string text;
+    bench_op("String concatenation (old /json)", [&]()
+    {
+        text = "{";
+        text.reserve(512);
+        text += " \"id\":\"" + std::string(wd.id) + "\"";
+        text += ", \"tag\":\"" + std::string(wd.tag) + "\"";
+        text += ", \"uptime\":" + std::to_string(wd.seconds);
+        text += ", \"temp_c_calib\":" + str_float(wd.temp_c_calib, 2);
+        text += ", \"temp_c\":" + str_float(wd.temp_c);
+        text += ", \"temp_f\":" + str_float(wd.temp_f);
+        text += ", \"pressure\":" + str_float(wd.pressure);
+        text += ", \"humidity\":" + str_float(wd.humidity);
+        text += ", \"wind_peak\":" + str_float(wd.wind_peak);
+        text += ", \"wind_rt\":" + str_float(wd.wind_rt);
+        text += ", \"wind_avg\":" + str_float(wd.wind_avg);
+        text += ", \"wind_dir_rt\":" + std::to_string(wd.wind_dir_rt);
+        text += ", \"wind_dir_avg\":" + std::to_string(wd.wind_dir_avg);
+        text += ", \"rain_calib\":" + str_float(wd.rain_calib, 4);
+        text += ", \"rain_rate\":" + std::to_string(wd.rain_rate);
+        text += ", \"rain_event\":" + std::to_string(wd.rain_event);
+        text += ", \"rain_event_cnt\":" + std::to_string(wd.rain_event_cnt);
+        text += ", \"rain_total\":" + std::to_string(wd.rain_total);
+        text += " }";
+        bench_keep(text);
+    }, len);
+    bench_op("TextWriter into a static buffer", [&]() { bench_keep(render()); }, len);
+    printf("  (%u bytes of JSON)\n", unsigned(len));
+}
+
+// /bin against /json: the payload and the time to encode and to decode it
+BENCH(wsbin)
+{
+    WeatherData wd;
+    sample_data(wd);
+    WsBinSample s = {};
+    s.flags = WSBIN_FLAG_VALID;
+    s.uptime = wd.seconds;
+    s.temp_c = wd.temp_c;
+    s.pressure = wd.pressure;
+    s.rain_total = wd.rain_total;
+    strcpy(s.id, wd.id);
+    strcpy(s.tag, wd.tag);
+
+    static uint8_t buf[WSBIN_MAX_LEN];
+    size_t len = wsbin_encode(buf, sizeof(buf), s);
+    bench_op("wsbin_encode", [&]()
+    {
+        s.generation++;
+        bench_keep(wsbin_encode(buf, sizeof(buf), s));
+    }, double(len));
+    WsBinSample d;
+    bench_op("wsbin_decode", [&]() { bench_keep(wsbin_decode(buf, len, d)); }, double(len));
+
+    // A client parsing the /json text with strtod, the minimum a JSON decoder has to do for the numbers
+    static char json[512];
+    TextWriter w(json, sizeof(json));
+    w.str("{ \"uptime\":").u32(wd.seconds).str(", \"temp_c\":").fixed(wd.temp_c).str(", \"pressure\":")
+        .fixed(wd.pressure).str(", \"humidity\":").fixed(wd.humidity).str(", \"wind_rt\":").fixed(wd.wind_rt)
+        .str(", \"rain_calib\":").fixed(wd.rain_calib, 4).str(", \"rain_total\":").u32(wd.rain_total).str(" }");
+    bench_op("strtod of the /json numbers", [&]()
+    {
+        double sum = 0;
+        for (const char *p = strchr(json, ':'); p; p = strchr(p + 1, ':'))
+            sum += strtod(p + 1, NULL);
+        bench_keep(sum);
+    }, double(w.length()));
+    printf("  (/bin is %u bytes)\n", unsigned(len));
+}
+
+// Cost of each rain gauge tip and of the rate the aggregation reads every 5 s
+BENCH(rainrate)
+{
+    RainRate rr(30 * 60 * 1000000u);
+    uint32_t t = 0;
+    bench_op("RainRate::tip + rate", [&]()
+    {
+        t += 20000000 + (t & 0xFFFFF);
+        rr.tip(t);
+        bench_keep(rr.rate(t + 1000000));
+    });
+    bench_op("RainRate::rate", [&]() { bench_keep(rr.rate(t += 1000)); });
+}
+
+// Per-pulse cost of the gust meter at 0.25 s samples and a 3 s mean, against counting pulses for 3 s
+BENCH(windgust)
+{
+    GustMeter<12> g(250000, 2000000);
+    uint32_t t = 0;
+    bench_op("GustMeter::pulse (~20 Hz)", [&]()
+    {
+        t += 45000 + (t % 10007);
+        g.pulse(t);
+    });
+    bench_keep(g.get_and_clear_gust());
+
+    volatile uint32_t count = 0;
+    bench_op("count++ (old ISR)", [&]() { count = count + 1; });
+}
+
+// The vane lookup table against the linear walk of the sorted thresholds wind_calc_dir used to do
+static int wind_calc_dir_linear(int adc)
+{
+    static const int val[1 + 16 + 1] = { 0, 70, 143, 176, 307, 540, 775, 942, 1430, 1657, 2215, 2328, 2636, 2978, 3175,
+                                         3494, 3900, 4096 };
+    static const int dir[1 + 16 + 1] = { 5, 5, 3, 4, 7, 6, 9, 8, 1, 2, 11, 10, 15, 0, 13, 14, 12, 12 };
+    for (int i = 0; i < 17; i++)
+    {
+        if (adc < val[i + 1])
+        {
+            int d0 = adc - val[i];
+            int d1 = val[i + 1] - adc;
+            return (d0 < d1) ? dir[i] : dir[i + 1];
+        }
+    }
+    return 0;
+}
+
+BENCH(windvane)
+{
+    WindVane vane;
+    uint32_t adc = 0;
+    bench_op("linear threshold walk (old)", [&]() { bench_keep(wind_calc_dir_linear((adc += 977) & 4095)); });
+    bench_op("WindVane::dir lookup table", [&]() { bench_keep(vane.dir((adc += 977) & 4095)); });
+}
+
+// DHT22 frame decoding from the captured pulse durations
+BENCH(dhtdecode)
+{
+    static const uint8_t frame[5] = { 0x02, 0x8C, 0x01, 0x5F, 0xEE };
+    DhtPulse p[96];
+    size_t n = 0;
+    p[n++] = { 1, 30 };
+    p[n++] = { 0, 80 };
+    p[n++] = { 1, 80 };
+    for (int bit = 0; bit < 40; bit++)
+    {
+        int j = (bit * 7 % 9) - 4;
+        p[n++] = { 0, uint16_t(50 + j) };
+        p[n++] = { 1, uint16_t(((frame[bit / 8] >> (7 - bit % 8)) & 1) ? 70 + j : 26 + j) };
+    }
+    p[n++] = { 0, 50 };
+
+    uint8_t data[5];
+    bench_op("dht_decode (one frame)", [&]() { bench_keep(dht_decode(p, n, data)); });
+    bench_op("dht_decode + humidity + temperature", [&]()
+    {
+        dht_decode(p, n, data);
+        bench_keep(dht_humidity(data) + dht_temperature(data));
+    });
+}
+
+// Cost of a pulse: the interrupt's share (without the interrupt entry itself), and the reader clearing the count
+BENCH(pulsecount)
+{
+    PulseCounter c;
+    c.keep_times(true);
+    uint32_t t = 0, tp;
+    bench_op("PulseCounter::edge + pop_time", [&]()
+    {
+        c.edge(t += 10000);
+        c.pop_time(tp);
+    });
+    static Gauge g;
+    g.keep_times(true);
+    bench_op("Gauge::isr (micros, no lock)", [&]()
+    {
+        host_advance_us(10000);
+        g.isr();
+        g.pop_time(tp);
+    });
+    bench_op("Gauge::get_and_clear_count", [&]() { bench_keep(g.get_and_clear_count()); });
+}
+
+// The whole calculation of a tick in a storm (20 pulses a second), as the aggregation task and the replay run it; one
+// op is a 5-sec period: four 1-sec ticks and the tick that recalculates the 5-sec data
+BENCH(weathercalc)
+{
+    static WeatherCalc calc;
+    static WeatherData wd = {};
+    wd.wind_calib = WIND_FACTOR_MPH;
+    wd.humidity = 80;
+    memcpy(wd.vane_adc, vane_default_adc, sizeof(wd.vane_adc));
+    static RawSample r = {};
+    r.anem_count = r.anem_n = 20;
+    r.flags = RAW_DHT | RAW_DHT_OK;
+    r.dht_temp = 12.5f;
+    r.dht_hum = 80;
+    uint32_t seconds = 0;
+    bench_op("WeatherCalc::process, 5 ticks", [&]()
+    {
+        for (int i = 0; i < PERIOD_5_SEC; i++)
+        {
+            r.seconds = ++seconds;
+            r.time = seconds * 1000000u;
+            for (int p = 0; p < r.anem_n; p++)
+                r.anem_times[p] = r.time - 1000000u + p * 50000u;
+            r.wind_dir_adc = vane_default_adc[(seconds / 7) % 16];
+            r.flags = (seconds % PERIOD_5_SEC) ? (r.flags & ~RAW_SENSORS) : (r.flags | RAW_SENSORS);
+            bench_keep(calc.process(r, wd));
+        }
+    });
+}
@@ -0,0 +1,167 @@
+// Hot paths of the firmware: the sensor math and the web responses
+#include "bench.h"
+#include "main.h"
+#include "bme280calc.h"
+#include <ESPAsyncWebSrv.h>
+#include <esp_heap_caps.h>
+
+void setup();
+
+static void firmware_setup()
+{
+    static bool done = false;
+    if (!done)
+        setup();
+    done = true;
+}
+
+BENCH(bme280)
+{
+    Bme280Trim t = {};
+    t.T1 = 27504; t.T2 = 26435; t.T3 = -1000;
+    t.P1 = 36477; t.P2 = -10685; t.P3 = 3024; t.P4 = 2855; t.P5 = 140; t.P6 = -7; t.P7 = 15500; t.P8 = -14600;
+    t.P9 = 6000;
+    t.H1 = 75; t.H2 = 362; t.H3 = 0; t.H4 = 324; t.H5 = 50; t.H6 = 30;
+    uint8_t regs[8] = { 0x65, 0x5A, 0xC0, 0x7E, 0xED, 0x00, 0x6B, 0x4F };
+    int32_t adc = 519888;
+
+    bench_op("bme280_calc_t", [&]()
+    {
+        int32_t t_fine;
+        bench_keep(bme280_calc_t(t, adc++ & 0xFFFFF, t_fine));
+    });
+    bench_op("bme280_calc_p", [&]() { bench_keep(bme280_calc_p(t, 415148 + (adc++ & 0xFFF), 128422)); });
+    bench_op("bme280_calc_h", [&]() { bench_keep(bme280_calc_h(t, 27471 + (adc++ & 0xFFF), 128422)); });
+    bench_op("bme280_parse_data + calc all", [&]()
+    {
+        regs[7]++;
+        Bme280Raw raw;
+        bme280_parse_data(regs, raw);
+        int32_t t_fine;
+        bench_keep(bme280_calc_t(t, raw.temp, t_fine));
+        bench_keep(bme280_calc_p(t, raw.pres, t_fine));
+        bench_keep(bme280_calc_h(t, raw.hum, t_fine));
+    });
+}
+
+// Make the weather data change, so that the next request renders its response again
+static void publish()
+{
+    wdata_lock(portMAX_DELAY);
+    wdata.seconds += PERIOD_5_SEC;
+    wdata.temp_c += 0.01f;
+    wdata_publish();
+    wdata_unlock();
+}
+
+BENCH(web)
+{
+    firmware_setup();
+    strcpy(wdata.id, "bench");
+    strcpy(wdata.tag, "Host benchmark");
+
+    // The time includes the in-process dispatch of the shim (the unhandled request); the allocations are the firmware's
+    bench_op("unhandled request (shim only)", []() { bench_keep(host_http(HTTP_GET, "/none")); });
+    bench_op("/ (render + send)", []() { publish(); bench_keep(host_http(HTTP_GET, "/")); });
+    bench_op("/json (render + send)", []() { publish(); bench_keep(host_http(HTTP_GET, "/json")); });
+    bench_op("/bin (render + send)", []() { publish(); bench_keep(host_http(HTTP_GET, "/bin")); });
+    bench_op("/json (cached)", []() { bench_keep(host_http(HTTP_GET, "/json")); });
+    bench_op("/set?wind_calib=1.5&rain_calib=0.02", []()
+    {
+        bench_keep(host_http(HTTP_GET, "/set?wind_calib=1.5&rain_calib=0.02"));
+    });
+    bench_op("webserver_push_sample (into the ring)", []()
+    {
+        wdata.temp_c += 0.01f;
+        webserver_push_sample(wdata);
+    });
+}
+
+// A client polling / or /json once a second while the data changes every 5 s, with and without If-None-Match. Reports
+// the body bytes sent per poll, besides the handler time.
+static void bench_poller(const char *url, bool etag)
+{
+    static std::vector<std::pair<std::string, std::string>> headers(1);
+    static uint64_t polls, bytes;
+    polls = bytes = 0;
+    headers[0] = std::make_pair(std::string(etag ? "If-None-Match" : "X-None"), std::string(32, ' '));
+    headers[0].second.clear(); // Keep the capacity, so that the poller itself does not allocate
+    char name[64];
+    snprintf(name, sizeof(name), "poll %s, %s", url, etag ? "If-None-Match (304)" : "always 200");
+    bench_op(name, [&]()
+    {
+        if (++polls % PERIOD_5_SEC == 0)
+            publish();
+        HostResponse r = host_http(HTTP_GET, url, headers);
+        if (r.code == 200)
+            headers[0].second = r.header("ETag");
+        bytes += r.body.size();
+    });
+    printf("  %-44s %12.1f bytes/poll\n", name, double(bytes) / polls);
+}
+
+BENCH(poller)
+{
+    firmware_setup();
+    for (const char *url : { "/", "/json" })
+    {
+        bench_poller(url, false);
+        bench_poller(url, true);
+    }
+}
+
+// Read a whole /history listing through the cursor, the way the web server sends it in chunks; returns the bytes
+static size_t history_listing(uint32_t step)
+{
+    static HistoryCursor cur;
+    static char buf[1436]; // The size of a TCP segment the web server fills
+    size_t bytes = 0;
+    history_cursor_init(cur, 0, 0xFFFFFFFF, step);
+    for (size_t n; (n = history_read(cur, buf, sizeof(buf))) != 0; )
+        bytes += n;
+    return bytes;
+}
+
+BENCH(history)
+{
+    // How much history the largest free block leaves room for, from a tight heap to a roomy one
+    static const size_t largest[] = { 80 * 1024, 110 * 1024, 160 * 1024 };
+    for (size_t heap : largest)
+    {
+        host_heap(200 * 1024, heap);
+        setup_history();
+        HistoryStats st;
+        history_stats(st);
+        char name[64];
+        snprintf(name, sizeof(name), "sizing, largest free block %u KB", unsigned(heap / 1024));
+        printf("  %-44s %12u at 5 sec %6.1f hr, %u at 1 min %6.1f hr\n", name, unsigned(st.size),
+               st.size * PERIOD_5_SEC / 3600.0, unsigned(st.coarse_size), st.coarse_size / 60.0);
+    }
+
+    // A full 24-hour history, the most the station keeps, to time the longest listings
+    host_heap(200 * 1024, 1024 * 1024);
+    setup_history();
+    WeatherData wd = {};
+    wd.pressure = 1013.0f;
+    wd.humidity = 60.0f;
+    for (int i = 0; i < 24 * PERIOD_1_HR / PERIOD_5_SEC; i++)
+    {
+        wd.seconds += PERIOD_5_SEC;
+        wd.temp_c = 15.0f + (i % 100) / 10.0f;
+        wd.wind_rt = float(i % 40);
+        history_add(wd, i % 3);
+    }
+
+    bench_op("history_add", [&]()
+    {
+        wd.seconds += PERIOD_5_SEC;
+        wd.temp_c += 0.1f;
+        history_add(wd, 1);
+    });
+    size_t bytes = history_listing(PERIOD_5_SEC);
+    bench_op("history_read, 24 hr at 5 sec", []() { bench_keep(history_listing(PERIOD_5_SEC)); }, bytes);
+    bytes = history_listing(60);
+    bench_op("history_read, 24 hr at 1 min", []() { bench_keep(history_listing(60)); }, bytes);
+    bytes = history_listing(PERIOD_1_HR);
+    bench_op("history_read, 24 hr at 1 hr", []() { bench_keep(history_listing(PERIOD_1_HR)); }, bytes);
+}
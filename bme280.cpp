@@ -1,196 +1,135 @@
 #include "main.h"
 
 #define BME280_ADDRESS 0x76
-signed long int t_fine;
-
-uint16_t dig_T1;
- int16_t dig_T2;
- int16_t dig_T3;
-uint16_t dig_P1;
- int16_t dig_P2;
- int16_t dig_P3;
- int16_t dig_P4;
- int16_t dig_P5;
- int16_t dig_P6;
- int16_t dig_P7;
- int16_t dig_P8;
- int16_t dig_P9;
- int8_t  dig_H1;
- int16_t dig_H2;
- int8_t  dig_H3;
- int16_t dig_H4;
- int16_t dig_H5;
- int8_t  dig_H6;
 
-static bool readTrim()
+// Measurement settings. Oversampling: 0 = skipped, 1..5 = x1, x2, x4, x8, x16; IIR filter: 0 = off, 1..4 = 2, 4, 8, 16
+#define BME280_OSRS_T      1    // Temperature oversampling x 1
+#define BME280_OSRS_P      1    // Pressure oversampling x 1
+#define BME280_OSRS_H      1    // Humidity oversampling x 1
+#define BME280_FILTER      0    // Filter off
+#define BME280_TIMEOUT_MS  10   // I2C transfer timeout; a transfer takes well under 1 ms
+
+enum Bme280State { BME_IDLE, BME_MEASURING, BME_RECOVER };
+
+static Bme280State bme_state = BME_IDLE;
+static uint32_t bme_recoveries = 0; // Number of times the bus had to be recovered (for stats)
+
+static uint8_t trim_regs[32];   // Trimming parameters read from the sensor, as the registers (see bme280_parse_trim)
+static bool trim_valid = false;
+
+// Burst read count registers starting at reg; returns false unless all of them were read
+static bool readRegs(uint8_t reg, uint8_t *data, uint8_t count)
 {
-    uint8_t data[32],i=0;
     Wire.beginTransmission(BME280_ADDRESS);
-    Wire.write(0x88);
-    Wire.endTransmission();
-    Wire.requestFrom(BME280_ADDRESS,24);
-    if (!Wire.available())
-    {
-        wdata.error |= ERROR_BME_INIT;
+    Wire.write(reg);
+    if (Wire.endTransmission() != 0)
         return false;
-    }
-    while(Wire.available() && (i < 24)){
+    if (Wire.requestFrom(BME280_ADDRESS, int(count)) != count)
+        return false;
+    for (uint8_t i = 0; i < count; i++)
         data[i] = Wire.read();
-        i++;
-    }
-
-    Wire.beginTransmission(BME280_ADDRESS);
-    Wire.write(0xA1);
-    Wire.endTransmission();
-    Wire.requestFrom(BME280_ADDRESS,1);
-    data[i] = Wire.read();
-    i++;
+    return true;
+}
 
-    Wire.beginTransmission(BME280_ADDRESS);
-    Wire.write(0xE1);
-    Wire.endTransmission();
-    Wire.requestFrom(BME280_ADDRESS,7);
-    while(Wire.available() && (i < (24 + 1 + 7))){ // Total: 24 (0x88) + 1 (0xA1) + 7 (0xE1) = sizeof(data)
-        data[i] = Wire.read();
-        i++;
-    }
-    dig_T1 = (data[1] << 8) | data[0];
-    dig_T2 = (data[3] << 8) | data[2];
-    dig_T3 = (data[5] << 8) | data[4];
-    dig_P1 = (data[7] << 8) | data[6];
-    dig_P2 = (data[9] << 8) | data[8];
-    dig_P3 = (data[11]<< 8) | data[10];
-    dig_P4 = (data[13]<< 8) | data[12];
-    dig_P5 = (data[15]<< 8) | data[14];
-    dig_P6 = (data[17]<< 8) | data[16];
-    dig_P7 = (data[19]<< 8) | data[18];
-    dig_P8 = (data[21]<< 8) | data[20];
-    dig_P9 = (data[23]<< 8) | data[22];
-    dig_H1 =  data[24];
-    dig_H2 = (data[26]<< 8) | data[25];
-    dig_H3 =  data[27];
-    dig_H4 = (data[28]<< 4) | (0x0F & data[29]);
-    dig_H5 = (data[30]<< 4) | ((data[29] >> 4) & 0x0F);
-    dig_H6 =  data[31];
+// Read the trimming parameters; a short read would leave some of them garbage, so it fails the whole set up
+static bool readTrim()
+{
+    uint8_t data[32]; // Total: 24 (0x88) + 1 (0xA1) + 7 (0xE1) = sizeof(data)
+    if (!readRegs(0x88, data, 24) || !readRegs(0xA1, data + 24, 1) || !readRegs(0xE1, data + 25, 7))
+        return false;
+    memcpy(trim_regs, data, sizeof(trim_regs));
+    trim_valid = true;
     return true;
 }
 
-static void writeReg(uint8_t reg_address, uint8_t data)
+static bool writeReg(uint8_t reg_address, uint8_t data)
 {
     Wire.beginTransmission(BME280_ADDRESS);
     Wire.write(reg_address);
     Wire.write(data);
-    Wire.endTransmission();
+    return Wire.endTransmission() == 0;
 }
 
-static signed long int calibration_T(signed long int adc_T)
+// Write the configuration; with the sensor in the sleep mode, measurements are started one at a time (forced mode)
+static bool configure()
 {
+    uint8_t ctrl_meas_reg = (BME280_OSRS_T << 5) | (BME280_OSRS_P << 2) | 0; // Sleep mode
+    uint8_t config_reg    = (BME280_FILTER << 2);
+    uint8_t ctrl_hum_reg  = BME280_OSRS_H;
 
-    signed long int var1, var2, T;
-    var1 = ((((adc_T >> 3) - ((signed long int)dig_T1<<1))) * ((signed long int)dig_T2)) >> 11;
-    var2 = (((((adc_T >> 4) - ((signed long int)dig_T1)) * ((adc_T>>4) - ((signed long int)dig_T1))) >> 12) * ((signed long int)dig_T3)) >> 14;
-
-    t_fine = var1 + var2;
-    T = (t_fine * 5 + 128) >> 8;
-    return T;
+    // ctrl_hum takes effect only after a write to ctrl_meas
+    return writeReg(0xF4, ctrl_meas_reg) && writeReg(0xF5, config_reg) && writeReg(0xF2, ctrl_hum_reg) &&
+           writeReg(0xF4, ctrl_meas_reg) && readTrim();
 }
 
-static unsigned long int calibration_P(signed long int adc_P)
+// Free the bus from a device that holds SDA low in the middle of a transfer (ex. after a reset or a glitch on SCL):
+// clock SCL until the device lets SDA go, then make a STOP condition, and set the I2C controller up again
+static void bus_recover()
 {
-    signed long int var1, var2;
-    unsigned long int P;
-    var1 = (((signed long int)t_fine)>>1) - (signed long int)64000;
-    var2 = (((var1>>2) * (var1>>2)) >> 11) * ((signed long int)dig_P6);
-    var2 = var2 + ((var1*((signed long int)dig_P5))<<1);
-    var2 = (var2>>2)+(((signed long int)dig_P4)<<16);
-    var1 = (((dig_P3 * (((var1>>2)*(var1>>2)) >> 13)) >>3) + ((((signed long int)dig_P2) * var1)>>1))>>18;
-    var1 = ((((32768+var1))*((signed long int)dig_P1))>>15);
-    if (var1 == 0)
+    Wire.end();
+    pinMode(SDA, INPUT_PULLUP);
+    pinMode(SCL, OUTPUT_OPEN_DRAIN);
+    for (int i = 0; (i < 9) && (digitalRead(SDA) == LOW); i++)
     {
-        return 0;
+        digitalWrite(SCL, LOW);
+        delayMicroseconds(5);
+        digitalWrite(SCL, HIGH);
+        delayMicroseconds(5);
     }
-    P = (((unsigned long int)(((signed long int)1048576)-adc_P)-(var2>>12)))*3125;
-    if(P<0x80000000)
-    {
-       P = (P << 1) / ((unsigned long int) var1);
-    }
-    else
+    pinMode(SDA, OUTPUT_OPEN_DRAIN);
+    digitalWrite(SDA, LOW);
+    delayMicroseconds(5);
+    digitalWrite(SCL, HIGH);
+    delayMicroseconds(5);
+    digitalWrite(SDA, HIGH); // STOP: SDA rising while SCL is high
+    delayMicroseconds(5);
+    Wire.begin();
+    Wire.setTimeOut(BME280_TIMEOUT_MS);
+    bme_recoveries++;
+}
+
+// Start a measurement, to be collected by read_bme280_raw() on a later tick when the conversion is long done,
+// so the acquisition task never waits for it. If the last transfer failed, recover the bus and set the sensor up first.
+void bme280_start()
+{
+    if (bme_state == BME_RECOVER)
     {
-        P = (P / (unsigned long int)var1) * 2;
+        bus_recover();
+        if (!configure())
+            return; // Try again next time
     }
-    var1 = (((signed long int)dig_P9) * ((signed long int)(((P>>3) * (P>>3))>>13)))>>12;
-    var2 = (((signed long int)(P>>2)) * ((signed long int)dig_P8))>>13;
-    P = (unsigned long int)((signed long int)P + ((var1 + var2 + dig_P7) >> 4));
-    return P;
+    uint8_t ctrl_meas_reg = (BME280_OSRS_T << 5) | (BME280_OSRS_P << 2) | 1; // Forced mode
+    bme_state = writeReg(0xF4, ctrl_meas_reg) ? BME_MEASURING : BME_RECOVER;
 }
 
-static unsigned long int calibration_H(signed long int adc_H)
+// Burst read the data registers of the measurement started before; returns false if there is no new measurement
+bool read_bme280_raw(uint8_t data[8])
 {
-    signed long int v_x1;
-
-    v_x1 = (t_fine - ((signed long int)76800));
-    v_x1 = (((((adc_H << 14) -(((signed long int)dig_H4) << 20) - (((signed long int)dig_H5) * v_x1)) +
-              ((signed long int)16384)) >> 15) * (((((((v_x1 * ((signed long int)dig_H6)) >> 10) *
-              (((v_x1 * ((signed long int)dig_H3)) >> 11) + ((signed long int) 32768))) >> 10) + (( signed long int)2097152)) *
-              ((signed long int) dig_H2) + 8192) >> 14));
-   v_x1 = (v_x1 - (((((v_x1 >> 15) * (v_x1 >> 15)) >> 7) * ((signed long int)dig_H1)) >> 4));
-   v_x1 = (v_x1 < 0 ? 0 : v_x1);
-   v_x1 = (v_x1 > 419430400 ? 419430400 : v_x1);
-   return (unsigned long int)(v_x1 >> 12);
+    if (bme_state != BME_MEASURING)
+        return false;
+    bme_state = BME_RECOVER;
+    if (!readRegs(0xF7, data, 8))
+        return false;
+    bme_state = BME_IDLE;
+    return true;
 }
 
-void read_bme280()
+uint32_t bme280_recoveries()
 {
-    unsigned long int hum_raw, temp_raw, pres_raw;
-    int i = 0;
-    uint32_t data[8];
-    Wire.beginTransmission(BME280_ADDRESS);
-    Wire.write(0xF7);
-    Wire.endTransmission();
-    Wire.requestFrom(BME280_ADDRESS,8);
-    if (!Wire.available())
-    {
-        wdata.error |= ERROR_BME_READ;
-        return;
-    }
-    while(Wire.available() && (i < 8)){
-        data[i] = Wire.read();
-        i++;
-    }
-    pres_raw = (data[0] << 12) | (data[1] << 4) | (data[2] >> 4);
-    temp_raw = (data[3] << 12) | (data[4] << 4) | (data[5] >> 4);
-    hum_raw  = (data[6] << 8) | data[7];
-
-    signed long int temp_cal;
-    unsigned long int press_cal, hum_cal;
-
-    temp_cal = calibration_T(temp_raw);
-    press_cal = calibration_P(pres_raw);
-    hum_cal = calibration_H(hum_raw);
-
-    wdata.temp_c = float(temp_cal) / 100.0;
-    wdata.temp_c += wdata.temp_c_calib; // Apply calibration value
-    wdata.temp_f = wdata.temp_c * 9.0 / 5.0 + 32.0;
-    wdata.pressure = float(press_cal) / 100.0;
-    wdata.humidity = float(hum_cal) / 1024.0;
+    return bme_recoveries;
 }
 
-bool setup_bme280()
+// Get the trimming parameters that the weather calculation needs; returns false if they were never read
+bool bme280_trim_regs(uint8_t regs[32])
 {
-    uint8_t osrs_t = 1;             // Temperature oversampling x 1
-    uint8_t osrs_p = 1;             // Pressure oversampling x 1
-    uint8_t osrs_h = 1;             // Humidity oversampling x 1
-    uint8_t mode = 3;               // Normal mode
-    uint8_t t_sb = 5;               // Tstandby 1000ms
-    uint8_t filter = 0;             // Filter off
-    uint8_t spi3w_en = 0;           // 3-wire SPI Disable
-
-    uint8_t ctrl_meas_reg = (osrs_t << 5) | (osrs_p << 2) | mode;
-    uint8_t config_reg    = (t_sb << 5) | (filter << 2) | spi3w_en;
-    uint8_t ctrl_hum_reg  = osrs_h;
+    memcpy(regs, trim_regs, sizeof(trim_regs));
+    return trim_valid;
+}
 
+bool setup_bme280()
+{
     Wire.begin();
-    Wire.setTimeOut(100);
+    Wire.setTimeOut(BME280_TIMEOUT_MS);
     delay(1000); // Wait a second after the initialization
 
     // Get Chip ID
@@ -203,12 +142,10 @@ bool setup_bme280()
     Serial.print("Using BME280 ID=0x");
     Serial.println(Wire.read(), HEX);
 
-    writeReg(0xF2,ctrl_hum_reg);
-    writeReg(0xF4,ctrl_meas_reg);
-    writeReg(0xF5,config_reg);
-
-    if (!readTrim())
+    if (!configure())
+    {
+        wdata.error |= ERROR_BME_INIT;
         return false;
-
+    }
     return true;
 }
@@ -0,0 +1,115 @@
+#pragma once
+#include <stdint.h>
+
+// BME280 compensation formulas from the Bosch datasheet, section 4.2.3 (32-bit integer version)
+// This header has no dependencies on Arduino or the I2C bus, so the math can be built and profiled off-device. The
+// datasheet code uses "signed long int" which is 64-bit on most hosts; fixed-width types give the same results
+// everywhere as on the ESP32.
+
+// Trimming parameters read from the sensor NVM
+struct Bme280Trim
+{
+    uint16_t T1;
+    int16_t T2, T3;
+    uint16_t P1;
+    int16_t P2, P3, P4, P5, P6, P7, P8, P9;
+    int8_t H1;
+    int16_t H2;
+    int8_t H3;
+    int16_t H4, H5;
+    int8_t H6;
+};
+
+// Uncompensated readings of one measurement
+struct Bme280Raw
+{
+    int32_t pres, temp, hum;
+};
+
+// Decode the trimming parameters from the registers 0x88-0x9F (24 bytes), 0xA1 (1 byte) and 0xE1-0xE7 (7 bytes)
+static inline void bme280_parse_trim(const uint8_t data[32], Bme280Trim& t)
+{
+    t.T1 = (data[1] << 8) | data[0];
+    t.T2 = (data[3] << 8) | data[2];
+    t.T3 = (data[5] << 8) | data[4];
+    t.P1 = (data[7] << 8) | data[6];
+    t.P2 = (data[9] << 8) | data[8];
+    t.P3 = (data[11]<< 8) | data[10];
+    t.P4 = (data[13]<< 8) | data[12];
+    t.P5 = (data[15]<< 8) | data[14];
+    t.P6 = (data[17]<< 8) | data[16];
+    t.P7 = (data[19]<< 8) | data[18];
+    t.P8 = (data[21]<< 8) | data[20];
+    t.P9 = (data[23]<< 8) | data[22];
+    t.H1 =  data[24];
+    t.H2 = (data[26]<< 8) | data[25];
+    t.H3 =  data[27];
+    t.H4 = (data[28]<< 4) | (0x0F & data[29]);
+    t.H5 = (data[30]<< 4) | ((data[29] >> 4) & 0x0F);
+    t.H6 =  data[31];
+}
+
+// Decode the burst read of the data registers 0xF7-0xFE
+static inline void bme280_parse_data(const uint8_t data[8], Bme280Raw& raw)
+{
+    raw.pres = (uint32_t(data[0]) << 12) | (data[1] << 4) | (data[2] >> 4);
+    raw.temp = (uint32_t(data[3]) << 12) | (data[4] << 4) | (data[5] >> 4);
+    raw.hum  = (data[6] << 8) | data[7];
+}
+
+// Returns the temperature in 0.01 C and the fine temperature that the other two formulas need
+static inline int32_t bme280_calc_t(const Bme280Trim& t, int32_t adc_T, int32_t& t_fine)
+{
+    int32_t var1, var2;
+    var1 = ((((adc_T >> 3) - ((int32_t)t.T1<<1))) * ((int32_t)t.T2)) >> 11;
+    var2 = (((((adc_T >> 4) - ((int32_t)t.T1)) * ((adc_T>>4) - ((int32_t)t.T1))) >> 12) * ((int32_t)t.T3)) >> 14;
+
+    t_fine = var1 + var2;
+    return (t_fine * 5 + 128) >> 8;
+}
+
+// Returns the pressure in Pa
+static inline uint32_t bme280_calc_p(const Bme280Trim& t, int32_t adc_P, int32_t t_fine)
+{
+    int32_t var1, var2;
+    uint32_t P;
+    var1 = (((int32_t)t_fine)>>1) - (int32_t)64000;
+    var2 = (((var1>>2) * (var1>>2)) >> 11) * ((int32_t)t.P6);
+    var2 = var2 + ((var1*((int32_t)t.P5))<<1);
+    var2 = (var2>>2)+(((int32_t)t.P4)<<16);
+    var1 = (((t.P3 * (((var1>>2)*(var1>>2)) >> 13)) >>3) + ((((int32_t)t.P2) * var1)>>1))>>18;
+    var1 = ((((32768+var1))*((int32_t)t.P1))>>15);
+    if (var1 == 0)
+    {
+        return 0; // Avoid an exception caused by a division by zero
+    }
+    P = (((uint32_t)(((int32_t)1048576)-adc_P)-(var2>>12)))*3125;
+    if(P<0x80000000)
+    {
+       P = (P << 1) / ((uint32_t) var1);
+    }
+    else
+    {
+        P = (P / (uint32_t)var1) * 2;
+    }
+    var1 = (((int32_t)t.P9) * ((int32_t)(((P>>3) * (P>>3))>>13)))>>12;
+    var2 = (((int32_t)(P>>2)) * ((int32_t)t.P8))>>13;
+    P = (uint32_t)((int32_t)P + ((var1 + var2 + t.P7) >> 4));
+    return P;
+}
+
+// Returns the relative humidity in %RH as unsigned 22.10 fixed point (value / 1024)
+static inline uint32_t bme280_calc_h(const Bme280Trim& t, int32_t adc_H, int32_t t_fine)
+{
+    int32_t v_x1;
+
+    v_x1 = (t_fine - ((int32_t)76800));
+    v_x1 = (((((adc_H << 14) -(((int32_t)t.H4) << 20) - (((int32_t)t.H5) * v_x1)) +
+              ((int32_t)16384)) >> 15) * (((((((v_x1 * ((int32_t)t.H6)) >> 10) *
+              (((v_x1 * ((int32_t)t.H3)) >> 11) + ((int32_t) 32768))) >> 10) + (( int32_t)2097152)) *
+              ((int32_t) t.H2) + 8192) >> 14));
+    v_x1 = (v_x1 - (((((v_x1 >> 15) * (v_x1 >> 15)) >> 7) * ((int32_t)t.H1)) >> 4));
+    v_x1 = (v_x1 < 0 ? 0 : v_x1);
+    v_x1 = (v_x1 > 419430400 ? 419430400 : v_x1);
+    return (uint32_t)(v_x1 >> 12);
+}
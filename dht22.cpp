@@ -1,50 +1,98 @@
 #include "main.h"
+#include "dhtdecode.h"
 
-#include <DHT22.h>
+#include <driver/rmt.h>
+#include <driver/gpio.h>
 
 // SDA, or almost any other I/O pin. SDA is GPIO 21 on ESP32-WROOM-32U board
 #define pinDATA SDA
 
-DHT22 dht22(pinDATA);
+// The frame is captured by the RMT peripheral, so the CPU is free while the sensor sends it (about 5 ms)
+#define DHT_RMT_CHANNEL  RMT_CHANNEL_0
+#define DHT_START_US     1100 // Host start signal, the line held low for at least 1 ms
+#define DHT_IDLE_US      200  // The line idle (high) for this long ends the frame
+#define DHT_FILTER       100  // Ignore glitches shorter than this many APB clock cycles (1.25 us)
+#define DHT_PULSES_MAX   96   // Two pulses per bit plus the response and the tail of the start signal
 
-bool setup_dht22()
-{   
-    delay(1000); // Wait a second after the initialization
-    float sample = dht22.getTemperature();
-    if (dht22.getLastError() != 0)
-        return false;
-    Serial.println("Using DHT22");
-    delay(1000);
-    return true;    
+static RingbufHandle_t dht_rb = NULL;
+
+// Send the start signal and capture the sensor's answer in the background
+void dht22_start()
+{
+    // Discard any frame that was not collected
+    size_t len;
+    void *items;
+    rmt_rx_stop(DHT_RMT_CHANNEL);
+    while ((items = xRingbufferReceive(dht_rb, &len, 0)) != NULL)
+        vRingbufferReturnItem(dht_rb, items);
+
+    // The pin stays connected to the RMT input while the GPIO drives it low as an open-drain output
+    gpio_set_direction(gpio_num_t(pinDATA), GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_level(gpio_num_t(pinDATA), 0);
+    delayMicroseconds(DHT_START_US);
+    gpio_set_level(gpio_num_t(pinDATA), 1);
+    rmt_rx_start(DHT_RMT_CHANNEL, true);
 }
 
-void read_dht22()
+// Decode the frame captured since dht22_start(); returns false if there is no valid frame
+bool read_dht22_raw(float& temperature, float& humidity)
 {
-    // Reading temperature and humidity
-    float temperature = dht22.getTemperature();
-    float humidity = dht22.getHumidity();
+    size_t len = 0;
+    rmt_item32_t *items = (rmt_item32_t *)xRingbufferReceive(dht_rb, &len, 0);
+    if (!items)
+    {
+        Serial.println("Failed to read from DHT sensor: no data");
+        return false;
+    }
 
-    // Check if any reads failed and exit early (to try again)
-    if (dht22.getLastError() != dht22.OK)
+    // Each RMT item holds two levels and their durations (in us)
+    DhtPulse pulses[DHT_PULSES_MAX];
+    size_t n = 0;
+    for (size_t i = 0; (i < len / sizeof(rmt_item32_t)) && (n + 2 <= DHT_PULSES_MAX); i++)
     {
-        wdata.error |= ERROR_DHT_READ;
-        Serial.println("Failed to read from DHT sensor!");
-        Serial.println(dht22.getLastError());
-        return;
+        if (items[i].duration0)
+            pulses[n++] = { uint8_t(items[i].level0), uint16_t(items[i].duration0) };
+        if (items[i].duration1)
+            pulses[n++] = { uint8_t(items[i].level1), uint16_t(items[i].duration1) };
     }
+    vRingbufferReturnItem(dht_rb, items);
 
-    wdata.temp_c = temperature;
-    wdata.temp_c += wdata.temp_c_calib; // Apply calibration value
-    wdata.temp_f = wdata.temp_c * 9.0 / 5.0 + 32.0;
-    wdata.pressure = 0;
-    wdata.humidity = humidity;
-
-#ifdef TEST
-    // Print the results
-    Serial.print("DHT22: Humidity: ");
-    Serial.print(humidity);
-    Serial.print("%  Temperature: ");
-    Serial.print(temperature);
-    Serial.println("°C");
-#endif
+    uint8_t data[5];
+    int err = dht_decode(pulses, n, data);
+    if (err != DHT_OK)
+    {
+        Serial.printf("Failed to read from DHT sensor: %d\n", err);
+        return false;
+    }
+    temperature = dht_temperature(data);
+    humidity = dht_humidity(data);
+    return true;
+}
+
+bool setup_dht22()
+{
+    // Take the pin back from the I2C controller, which was set up on it while looking for a BME280
+    gpio_reset_pin(gpio_num_t(pinDATA));
+
+    rmt_config_t config = RMT_DEFAULT_CONFIG_RX(gpio_num_t(pinDATA), DHT_RMT_CHANNEL);
+    config.clk_div = 80; // 1 us ticks
+    config.rx_config.filter_en = true;
+    config.rx_config.filter_ticks_thresh = DHT_FILTER;
+    config.rx_config.idle_threshold = DHT_IDLE_US;
+    if ((rmt_config(&config) != ESP_OK) || (rmt_driver_install(DHT_RMT_CHANNEL, 1024, 0) != ESP_OK))
+        return false;
+    rmt_get_ringbuf_handle(DHT_RMT_CHANNEL, &dht_rb);
+    gpio_pullup_en(gpio_num_t(pinDATA));
+
+    delay(1000); // The sensor needs a second after the power up
+    float temperature, humidity;
+    dht22_start();
+    delay(10);
+    if (!read_dht22_raw(temperature, humidity))
+    {
+        rmt_driver_uninstall(DHT_RMT_CHANNEL);
+        return false;
+    }
+    Serial.println("Using DHT22");
+    return true;
 }
@@ -0,0 +1,66 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// DHT22 (AM2302) frame decoder working on the captured pulse durations
+// This header has no dependencies on Arduino, so the decoder can be built and checked off-device.
+//
+// After the host start signal, the sensor answers with 80 us low and 80 us high, then sends 40 bits, MSB first: each
+// bit is 50 us low followed by 26-28 us high for a 0, or 70 us high for a 1. The frame is 16 bits of humidity and 16
+// bits of temperature (both in 0.1 units, the temperature MSB is the sign), followed by an 8-bit checksum.
+
+#define DHT_OK            0
+#define DHT_NO_RESPONSE   1 // The sensor's response pulse was not found
+#define DHT_SHORT         2 // The frame has less than 40 bits
+#define DHT_BAD_PULSE     3 // A pulse is too long or too short to be a bit
+#define DHT_CHECKSUM      4 // The checksum does not match
+
+#define DHT_RESPONSE_MIN  60 // Response high pulse, in us
+#define DHT_RESPONSE_MAX  100
+#define DHT_BIT_ONE_MIN   48 // A high pulse longer than this is a 1
+#define DHT_PULSE_MAX     100
+
+// One level of the line and how long it lasted
+struct DhtPulse
+{
+    uint8_t level;
+    uint16_t us;
+};
+
+// Decode the 5 bytes of a frame from the captured pulses; returns DHT_OK or an error code
+static inline int dht_decode(const DhtPulse *p, size_t n, uint8_t data[5])
+{
+    // Skip over whatever was captured of the start signal, to the response high pulse. It is the first high pulse that
+    // long, since the line is only briefly high between the host releasing it and the sensor answering.
+    size_t i = 0;
+    while ((i < n) && !(p[i].level && (p[i].us >= DHT_RESPONSE_MIN) && (p[i].us <= DHT_RESPONSE_MAX)))
+        i++;
+    if (i == n)
+        return DHT_NO_RESPONSE;
+    i++;
+
+    for (int b = 0; b < 5; b++)
+        data[b] = 0;
+    for (int bit = 0; bit < 40; bit++, i += 2)
+    {
+        if (i + 1 >= n)
+            return DHT_SHORT;
+        if (p[i].level || !p[i + 1].level || (p[i].us > DHT_PULSE_MAX) || (p[i + 1].us > DHT_PULSE_MAX))
+            return DHT_BAD_PULSE;
+        data[bit / 8] = (data[bit / 8] << 1) | (p[i + 1].us > DHT_BIT_ONE_MIN);
+    }
+    if (uint8_t(data[0] + data[1] + data[2] + data[3]) != data[4])
+        return DHT_CHECKSUM;
+    return DHT_OK;
+}
+
+static inline float dht_humidity(const uint8_t data[5])
+{
+    return ((data[0] << 8) | data[1]) / 10.0f;
+}
+
+static inline float dht_temperature(const uint8_t data[5])
+{
+    float t = (((data[2] & 0x7F) << 8) | data[3]) / 10.0f;
+    return (data[2] & 0x80) ? -t : t;
+}
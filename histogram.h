@@ -0,0 +1,69 @@
+#pragma once
+#include <stdint.h>
+
+// Duration histogram with fixed power-of-two buckets, for the stage timing metrics
+// This header has no dependencies on Arduino, so the bucketing and the percentiles can be checked off-device.
+//
+// Bucket i counts the durations d with 2^(i-1) < d <= 2^i microseconds (bucket 0 counts d <= 1 us), which is the
+// "le" (less or equal) bound of the Prometheus histograms. The last bucket counts everything above 2^(HIST_BUCKETS-2)
+// microseconds (about a second). Adding a sample is O(1) and the histogram never allocates, so it can be updated on
+// every pass of a task. A percentile is only known to the precision of its bucket: it is reported as the upper bound
+// of the bucket that holds it (but never more than the maximum), so it is at most 2x too high.
+
+#define HIST_BUCKETS  22
+
+class Histogram
+{
+public:
+    Histogram() { clear(); }
+
+    void clear()
+    {
+        for (int i = 0; i < HIST_BUCKETS; i++)
+            bucket[i] = 0;
+        count = 0;
+        sum = 0;
+        max = 0;
+    }
+
+    void add(uint32_t us)
+    {
+        int i = (us <= 1) ? 0 : 32 - __builtin_clz(us - 1);
+        bucket[(i < HIST_BUCKETS - 1) ? i : HIST_BUCKETS - 1]++;
+        count++;
+        sum += us;
+        if (us > max)
+            max = us;
+    }
+
+    // Upper bound of a bucket in microseconds; the last bucket has none (+Inf)
+    static uint32_t le(int i) { return uint32_t(1) << i; }
+    static bool is_inf(int i) { return i == HIST_BUCKETS - 1; }
+
+    uint32_t get_bucket(int i) const { return bucket[i]; }
+    uint32_t get_count() const { return count; }
+    uint64_t get_sum() const { return sum; }
+    uint32_t get_max() const { return max; }
+
+    // Returns the given percentile (1-100) in microseconds, or 0 if there are no samples
+    uint32_t percentile(uint32_t pct) const
+    {
+        if (!count)
+            return 0;
+        uint64_t rank = (uint64_t(count) * pct + 99) / 100; // Rank of the sample at the percentile, 1-based
+        uint64_t n = 0;
+        for (int i = 0; i < HIST_BUCKETS - 1; i++)
+        {
+            n += bucket[i];
+            if (n >= rank)
+                return (le(i) < max) ? le(i) : max;
+        }
+        return max;
+    }
+
+private:
+    uint32_t bucket[HIST_BUCKETS];
+    uint32_t count;
+    uint64_t sum;   // Sum of all samples, in microseconds
+    uint32_t max;   // Longest sample, in microseconds
+};
@@ -0,0 +1,382 @@
+// In-RAM history of the 5-sec samples, kept in ring buffers of compact fixed-size records
+// Slowly changing values (temperature, pressure, humidity) are stored as deltas from the previous record, while the
+// wind, which can change a lot from one sample to the next, is stored as an absolute value with a reduced resolution.
+// The records do not hold their time: they are grouped in blocks of consecutive records that share the time of their
+// first record. A missed sample ends the block early, so that it does not shift the time of the older records.
+// The heap of an ESP32 running WiFi and the web server does not have room for 24 hours of 5-sec records (about 8
+// hours with a 110 KB largest free block), so the samples are also downsampled into 1-min records, which always cover
+// the last 24 hours. A listing takes the 1-min records up to the oldest 5-sec record, and the 5-sec records from there.
+#include "main.h"
+#include "textwriter.h"
+#include <esp_heap_caps.h>
+
+#define HISTORY_FINE_MAX     (24 * PERIOD_1_HR / PERIOD_5_SEC) // 24 hours of 5-sec records, if the heap has room
+#define HISTORY_COARSE_SEC   60          // Period of the downsampled records
+#define HISTORY_COARSE_MAX   (24 * PERIOD_1_HR / HISTORY_COARSE_SEC) // 24 hours of 1-min records
+#define HISTORY_HEAP_RESERVE (64 * 1024) // Heap that has to remain free for the WiFi and the web server
+#define HISTORY_WALK_MAX     256         // Max records to walk through while holding the lock
+#define HISTORY_BLOCK        32          // Records per block
+
+// One sample, 6 bytes
+struct HistoryRecord
+{
+    int8_t temp;        // Temperature delta, in 0.1 C
+    int8_t pressure;    // Pressure delta, in 0.1 hPa
+    int8_t humidity;    // Relative humidity delta, in 0.5 %
+    uint8_t wind_rt;    // Wind realtime (the average over a 1-min record), in 0.5 mph
+    uint8_t wind_peak;  // Wind peak, in 0.5 mph
+    uint8_t dir_rain;   // Wind direction 0-15 in the upper nibble, new rain tips (saturated at 15) in the lower nibble
+};
+
+// Time base of a block of records
+struct HistoryBlock
+{
+    uint32_t sec;       // Uptime seconds of the first record of the block
+    uint32_t count;     // Number of records in the block
+};
+
+// Ring buffer of records at a given period
+struct HistoryRing
+{
+    uint32_t period;        // Seconds between the records
+    HistoryRecord *rec;     // Records, a whole number of blocks
+    HistoryBlock *block;    // Blocks of the records
+    uint32_t size;          // Capacity, in records
+    uint32_t blocks;        // Capacity, in blocks
+    uint32_t total;         // Sequence number of the next record; the slots left at the end of a block count too
+    uint32_t count;         // Number of records in the ring buffer
+    uint32_t last_sec;      // Uptime seconds of the newest record
+    HistoryState tail;      // Decoded values before the oldest record
+    HistoryState enc;       // Decoded values of the newest record; the next delta is relative to these
+};
+
+// The 1-min record being collected from the 5-sec samples
+struct HistoryMinute
+{
+    uint32_t minute;        // Minute the samples belong to; the record is stamped with its end
+    uint32_t samples;       // Number of samples collected
+    HistoryState value;     // Values of the last sample
+    float wind_sum;         // Sum of the wind realtime of the samples
+    float wind_peak;        // Max wind peak of the samples
+    uint32_t dir;           // Wind direction of the last sample
+    uint32_t rain;          // New rain tips of the samples
+};
+
+static void *hist_mem;          // Allocated at setup based on the available heap
+static HistoryRing hist_fine = { PERIOD_5_SEC };        // The 5-sec samples, as many as the heap can spare
+static HistoryRing hist_coarse = { HISTORY_COARSE_SEC }; // The 1-min records, 24 hours
+static HistoryMinute hist_minute;
+static portMUX_TYPE hist_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Returns the delta from the last encoded value to the new one, saturated to fit a record, and tracks the value that
+// the decoder will see. A saturated delta is therefore made up by the following records.
+static int8_t encode_delta(int32_t value, int32_t& last)
+{
+    int32_t delta = value - last;
+    delta = (delta > 127) ? 127 : (delta < -128) ? -128 : delta;
+    last += delta;
+    return int8_t(delta);
+}
+
+static uint8_t encode_wind(float mph)
+{
+    int32_t n = lroundf(mph * 2);
+    return (n > 255) ? 255 : (n < 0) ? 0 : uint8_t(n);
+}
+
+static void apply_delta(HistoryState& state, const HistoryRecord& r)
+{
+    state.temp += r.temp;
+    state.pressure += r.pressure;
+    state.humidity += r.humidity;
+}
+
+// Hand a part of the allocation to a ring buffer
+static void ring_init(HistoryRing& h, HistoryBlock *block, HistoryRecord *rec, uint32_t blocks)
+{
+    uint32_t period = h.period;
+    h = HistoryRing();
+    h.period = period;
+    h.block = block;
+    h.rec = rec;
+    h.blocks = blocks;
+    h.size = blocks * HISTORY_BLOCK;
+}
+
+void setup_history()
+{
+    // Start over if the history is sized again (the host benchmarks do that)
+    free(hist_mem);
+    hist_mem = NULL;
+    hist_minute = HistoryMinute();
+
+    // Size the history to what the heap can spare, leaving enough for the web server and WiFi buffers. The 24 hours of
+    // 1-min records come first, the 5-sec records get the rest. A ring buffer drops its oldest block whole, so the
+    // 1-min records take one more block than 24 hours. The blocks and their records take a single allocation.
+    const size_t block_bytes = sizeof(HistoryBlock) + HISTORY_BLOCK * sizeof(HistoryRecord);
+    size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    size_t n = (largest > HISTORY_HEAP_RESERVE) ? (largest - HISTORY_HEAP_RESERVE) / block_bytes : 0;
+    const uint32_t coarse_max = HISTORY_COARSE_MAX / HISTORY_BLOCK + 1;
+    uint32_t coarse = (n < coarse_max) ? n : coarse_max;
+    n -= coarse;
+    uint32_t fine = (n < HISTORY_FINE_MAX / HISTORY_BLOCK) ? n : HISTORY_FINE_MAX / HISTORY_BLOCK;
+    if (coarse + fine)
+        hist_mem = malloc((coarse + fine) * block_bytes);
+    if (!hist_mem)
+        coarse = fine = 0;
+    HistoryBlock *block = (HistoryBlock *)hist_mem;
+    HistoryRecord *rec = (HistoryRecord *)(block + coarse + fine);
+    ring_init(hist_coarse, block, rec, coarse);
+    ring_init(hist_fine, block + coarse, rec + coarse * HISTORY_BLOCK, fine);
+    Serial.printf("History: %u 5-sec records (%u min), %u 1-min records (%u min), %u bytes, free heap %u\n",
+                  hist_fine.size, hist_fine.size * PERIOD_5_SEC / 60, hist_coarse.size,
+                  hist_coarse.size * HISTORY_COARSE_SEC / 60, unsigned((coarse + fine) * block_bytes), ESP.getFreeHeap());
+}
+
+// Encode a record against the newest one of the ring buffer; only the aggregation task does that
+static HistoryRecord ring_encode(HistoryRing& h, const HistoryState& value, float wind_rt, float wind_peak,
+                                 uint32_t dir, uint32_t rain)
+{
+    if (h.total == 0)
+        h.enc = value; // The very first record starts from its own values
+
+    HistoryRecord r;
+    r.temp = encode_delta(value.temp, h.enc.temp);
+    r.pressure = encode_delta(value.pressure, h.enc.pressure);
+    r.humidity = encode_delta(value.humidity, h.enc.humidity);
+    r.wind_rt = encode_wind(wind_rt);
+    r.wind_peak = encode_wind(wind_peak);
+    r.dir_rain = (uint8_t(dir) << 4) | ((rain > 15) ? 15 : rain);
+    return r;
+}
+
+// Add an encoded record to the ring buffer
+static void ring_add(HistoryRing& h, const HistoryRecord& r, uint32_t sec)
+{
+    portENTER_CRITICAL(&hist_lock);
+    if (h.total == 0)
+        h.tail = h.enc;
+
+    // A record that does not follow the newest one by the period (a sample was missed, or merged into this one) starts
+    // a new block with its own time base
+    uint32_t k = h.total % HISTORY_BLOCK;
+    if (k && (sec != h.last_sec + h.period))
+    {
+        h.total += HISTORY_BLOCK - k;
+        k = 0;
+    }
+    HistoryBlock& b = h.block[(h.total / HISTORY_BLOCK) % h.blocks];
+    if (k == 0)
+    {
+        // The oldest block is about to be overwritten: its records move into the decoded values before the oldest one
+        if (h.total >= h.size)
+        {
+            const HistoryRecord *old = &h.rec[h.total % h.size];
+            for (uint32_t i = 0; i < b.count; i++)
+                apply_delta(h.tail, old[i]);
+            h.count -= b.count;
+        }
+        b.sec = sec;
+        b.count = 0;
+    }
+    h.rec[h.total % h.size] = r;
+    b.count++;
+    h.total++;
+    h.count++;
+    h.last_sec = sec;
+    portEXIT_CRITICAL(&hist_lock);
+}
+
+// Add the 1-min record collected so far, stamped with the end of its minute
+static void minute_flush()
+{
+    HistoryMinute& m = hist_minute;
+    HistoryRecord r = ring_encode(hist_coarse, m.value, m.wind_sum / m.samples, m.wind_peak, m.dir, m.rain);
+    ring_add(hist_coarse, r, m.minute * HISTORY_COARSE_SEC);
+    m = HistoryMinute();
+}
+
+// Add a new record to the history; called by the aggregation task once every 5 sec
+void history_add(const WeatherData& wd, uint32_t rain_count)
+{
+    HistoryState value;
+    value.temp = lroundf(wd.temp_c * 10);
+    value.pressure = lroundf(wd.pressure * 10);
+    value.humidity = lroundf(wd.humidity * 2);
+    if (hist_fine.size)
+        ring_add(hist_fine, ring_encode(hist_fine, value, wd.wind_rt, wd.wind_peak, wd.wind_dir_rt, rain_count),
+                 wd.seconds);
+
+    // Collect the samples of each minute into a 1-min record. It is added with the sample at the end of the minute, or
+    // with the first sample of the next one if that was missed.
+    if (!hist_coarse.size)
+        return;
+    HistoryMinute& m = hist_minute;
+    uint32_t minute = (wd.seconds + HISTORY_COARSE_SEC - 1) / HISTORY_COARSE_SEC;
+    if (m.samples && (m.minute != minute))
+        minute_flush();
+    m.minute = minute;
+    m.samples++;
+    m.value = value;
+    m.wind_sum += wd.wind_rt;
+    m.wind_peak = (wd.wind_peak > m.wind_peak) ? wd.wind_peak : m.wind_peak;
+    m.dir = wd.wind_dir_rt;
+    m.rain += rain_count;
+    if ((wd.seconds % HISTORY_COARSE_SEC) == 0)
+        minute_flush();
+}
+
+void history_cursor_init(HistoryCursor& cur, uint32_t from, uint32_t to, uint32_t step)
+{
+    cur = {};
+    cur.next_sec = from;
+    cur.to_sec = to;
+    cur.step = step ? step : PERIOD_5_SEC;
+}
+
+// Uptime seconds of the oldest record of the ring buffer, or UINT32_MAX if it is empty; the caller holds the lock
+static uint32_t ring_oldest_sec(const HistoryRing& h)
+{
+    if (!h.count)
+        return UINT32_MAX;
+    uint32_t blocks = (h.total + HISTORY_BLOCK - 1) / HISTORY_BLOCK;
+    return h.block[((blocks > h.blocks) ? blocks - h.blocks : 0) % h.blocks].sec;
+}
+
+// Step the cursor to the next record of the ring buffer and decode it; the caller holds the lock. Returns false when
+// the cursor is past the newest record.
+static bool ring_next(const HistoryRing& h, HistoryCursor& cur, uint32_t& sec)
+{
+    uint32_t blocks = (h.total + HISTORY_BLOCK - 1) / HISTORY_BLOCK;
+    uint32_t oldest = (blocks > h.blocks) ? (blocks - h.blocks) * HISTORY_BLOCK : 0;
+    for (;;)
+    {
+        if (!cur.started || (cur.seq < oldest))
+        {
+            // Start from the oldest record, also if the records we were at have been overwritten in the meantime
+            if (h.count == 0)
+                return false;
+            cur.seq = oldest;
+            cur.state = h.tail;
+            cur.started = true;
+        }
+        else if (cur.seq + 1 < h.total)
+            cur.seq++;
+        else
+            return false;
+
+        const HistoryBlock& b = h.block[(cur.seq / HISTORY_BLOCK) % h.blocks];
+        uint32_t k = cur.seq % HISTORY_BLOCK;
+        if (k >= b.count)
+            continue; // Unused slot at the end of a block that was ended early, the next block follows
+        apply_delta(cur.state, h.rec[cur.seq % h.size]);
+        sec = b.sec + k * h.period;
+        return true;
+    }
+}
+
+// Walk the cursor to the next record that should be listed and decode it into the cursor's line buffer: the 1-min
+// records older than the 5-sec ones, then the 5-sec records. The lock is held only while walking a limited number of
+// records. Returns false when there are no more records in the range.
+static bool history_next(HistoryCursor& cur)
+{
+    HistoryState s;
+    uint32_t sec = 0;
+    bool found = false;
+    HistoryRecord r = HistoryRecord();
+
+    portENTER_CRITICAL(&hist_lock);
+    for (int walk = 0; walk < HISTORY_WALK_MAX; walk++)
+    {
+        if (!cur.fine)
+        {
+            if (!ring_next(hist_coarse, cur, sec) || (sec >= ring_oldest_sec(hist_fine)))
+            {
+                cur.fine = true; // Go on with the 5-sec records
+                cur.started = false;
+                continue;
+            }
+        }
+        else if (!ring_next(hist_fine, cur, sec))
+        {
+            cur.done = true; // We are past the newest record
+            break;
+        }
+
+        if (sec > cur.to_sec)
+        {
+            cur.done = true;
+            break;
+        }
+        if (sec >= cur.next_sec)
+        {
+            const HistoryRing& h = cur.fine ? hist_fine : hist_coarse;
+            r = h.rec[cur.seq % h.size];
+            cur.next_sec = sec + cur.step;
+            found = true;
+            break;
+        }
+    }
+    s = cur.state;
+    portEXIT_CRITICAL(&hist_lock);
+
+    if (found)
+    {
+        TextWriter w(cur.line, sizeof(cur.line));
+        w.u32(sec);
+        w.str(",").fixed(s.temp / 10.0, 1);
+        w.str(",").fixed(s.pressure / 10.0, 1);
+        w.str(",").fixed(s.humidity / 2.0, 1);
+        w.str(",").fixed(r.wind_rt / 2.0, 1);
+        w.str(",").fixed(r.wind_peak / 2.0, 1);
+        w.str(",").u32(r.dir_rain >> 4);
+        w.str(",").u32(r.dir_rain & 15);
+        w.str("\n");
+        cur.line_len = w.length();
+        cur.line_pos = 0;
+    }
+    return !cur.done;
+}
+
+// Fill the buffer with the next chunk of the CSV listing of the history; returns 0 at the end of the listing.
+// The memory used by a listing is bounded by the cursor, no matter how many records it covers.
+size_t history_read(HistoryCursor& cur, char *buf, size_t size)
+{
+    size_t len = 0;
+    if (!cur.header)
+    {
+        TextWriter w(cur.line, sizeof(cur.line));
+        w.str("uptime,temp_c,pressure,humidity,wind_rt,wind_peak,wind_dir_rt,rain\n");
+        cur.line_len = w.length();
+        cur.header = true;
+    }
+    while (len < size)
+    {
+        if (cur.line_pos < cur.line_len)
+        {
+            size_t n = cur.line_len - cur.line_pos;
+            n = (n < size - len) ? n : size - len;
+            memcpy(buf + len, cur.line + cur.line_pos, n);
+            cur.line_pos += n;
+            len += n;
+        }
+        else if (cur.done || !history_next(cur))
+            break;
+    }
+    return len;
+}
+
+// The records of both ring buffers, and the time they cover
+void history_stats(HistoryStats& s)
+{
+    portENTER_CRITICAL(&hist_lock);
+    s.count = hist_fine.count;
+    s.size = hist_fine.size;
+    s.coarse_count = hist_coarse.count;
+    s.coarse_size = hist_coarse.size;
+    uint32_t oldest = ring_oldest_sec(hist_fine);
+    s.sec = (oldest != UINT32_MAX) ? hist_fine.last_sec - oldest + PERIOD_5_SEC : 0;
+    oldest = ring_oldest_sec(hist_coarse);
+    s.coarse_sec = (oldest != UINT32_MAX) ? hist_coarse.last_sec - oldest + HISTORY_COARSE_SEC : 0;
+    portEXIT_CRITICAL(&hist_lock);
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <string>
+#include "freertos_shim.h"
+
+// Host build: the part of the Arduino-ESP32 core the station uses
+// The sketch sources are compiled as they are against this header. Time is virtual: micros() only moves when the code
+// waits (delay, vTaskDelay...) or a test advances it, so the firmware runs deterministically and as fast as it can.
+
+#define IRAM_ATTR
+#define PROGMEM
+
+#define LOW                0
+#define HIGH               1
+#define INPUT              0x01
+#define OUTPUT             0x03
+#define INPUT_PULLUP       0x05
+#define OUTPUT_OPEN_DRAIN  0x13
+#define RISING             0x01
+#define HEX                16
+#define DEC                10
+#define SDA                21
+#define SCL                22
+#define RAD_TO_DEG         57.295779513082320876798154814105
+
+typedef int esp_err_t;
+#define ESP_OK    0
+#define ESP_FAIL  -1
+
+// Virtual time
+uint32_t micros();
+uint32_t millis();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void host_advance_us(uint32_t us);
+
+// GPIO and ADC; a test sets the levels the firmware reads
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t level);
+uint16_t analogRead(uint8_t pin);
+void analogReadResolution(uint8_t bits);
+void attachInterrupt(uint8_t irq, void (*isr)(), int mode);
+void host_set_pin(uint8_t pin, int level);
+void host_set_analog(uint8_t pin, uint16_t value);
+void (*host_isr(uint8_t pin))(); // Interrupt handler attached to the pin, or NULL
+#define digitalPinToInterrupt(pin)  (pin)
+
+uint32_t getCpuFrequencyMhz();
+uint32_t esp_random();
+
+// newlib has strlcpy, glibc only from 2.38 on
+size_t host_strlcpy(char *dst, const char *src, size_t size);
+#define strlcpy  host_strlcpy
+
+// Arduino String, on top of std::string; the firmware only passes it around
+class String
+{
+public:
+    String() {}
+    String(const char *s) : s(s ? s : "") {}
+    String(const std::string& s) : s(s) {}
+    String(int v) : s(std::to_string(v)) {}
+    String(unsigned v) : s(std::to_string(v)) {}
+    const char *c_str() const { return s.c_str(); }
+    size_t length() const { return s.size(); }
+    bool operator==(const char *o) const { return s == o; }
+    bool operator==(const String& o) const { return s == o.s; }
+    String& operator+=(const String& o) { s += o.s; return *this; }
+
+private:
+    std::string s;
+};
+
+class Printable
+{
+public:
+    virtual ~Printable() {}
+    virtual String toString() const = 0;
+};
+
+// The serial console; silent unless host_serial_echo is set
+class HardwareSerial
+{
+public:
+    void begin(uint32_t baud) {}
+    size_t print(const char *s) { return out(s); }
+    size_t print(const String& s) { return out(s.c_str()); }
+    size_t print(const Printable& p) { return out(p.toString().c_str()); }
+    size_t print(char c) { char s[2] = { c, 0 }; return out(s); }
+    size_t print(long v, int base = DEC);
+    size_t print(unsigned long v, int base = DEC);
+    size_t print(int v, int base = DEC) { return print(long(v), base); }
+    size_t print(unsigned v, int base = DEC) { return print((unsigned long)v, base); }
+    size_t print(double v, int decimals = 2);
+    template<class T> size_t println(const T& v) { return print(v) + out("\n"); }
+    template<class T> size_t println(const T& v, int fmt) { return print(v, fmt) + out("\n"); }
+    size_t println() { return out("\n"); }
+    size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+private:
+    size_t out(const char *s);
+};
+
+extern HardwareSerial Serial;
+extern bool host_serial_echo;
+
+// The shims' own allocations (the in-process requests, the responses...) are not the firmware's; the benchmarks do not
+// count the allocations made inside a HostShimScope
+extern thread_local int host_shim_depth;
+
+struct HostShimScope
+{
+    HostShimScope() { host_shim_depth++; }
+    ~HostShimScope() { host_shim_depth--; }
+};
+
+class EspClass
+{
+public:
+    uint32_t getCycleCount();       // Derived from the host clock, at getCpuFrequencyMhz()
+    uint32_t getFreeHeap();
+    void restart();
+};
+
+extern EspClass ESP;
+extern bool host_restarted;         // ESP.restart() was called
@@ -0,0 +1,130 @@
+#pragma once
+#include "Arduino.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Host build: the part of ESPAsyncWebServer the station uses, with no network behind it
+// A test makes a request with host_http(), which runs the matching handler the same way the server would, and gets
+// back the response the client would have received. A chunked response is drained until its filler has nothing more
+// to give; the filler stays with the response, so a test can ask it for more later.
+
+typedef enum { HTTP_GET = 0b01, HTTP_POST = 0b10, HTTP_ANY = 0b11 } WebRequestMethod;
+typedef uint8_t WebRequestMethodComposite;
+
+#define RESPONSE_TRY_AGAIN  0xFFFFFFFF
+
+class AsyncWebServerRequest;
+typedef std::function<void(AsyncWebServerRequest *)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest *, String, size_t, uint8_t *, size_t, bool)> ArUploadHandlerFunction;
+typedef std::function<size_t(uint8_t *, size_t, size_t)> AwsResponseFiller;
+typedef std::function<void()> ArDisconnectHandler;
+
+class AsyncWebHeader
+{
+public:
+    AsyncWebHeader(const String& name, const String& value) : n(name), v(value) {}
+    const String& name() const { return n; }
+    const String& value() const { return v; }
+
+private:
+    String n, v;
+};
+
+typedef AsyncWebHeader AsyncWebParameter;
+
+class AsyncWebServerResponse
+{
+public:
+    virtual ~AsyncWebServerResponse() {}
+    void addHeader(const String& name, const String& value)
+    {
+        HostShimScope shim;
+        headers.push_back(AsyncWebHeader(name, value));
+    }
+
+    int code = 200;
+    String type;
+    std::vector<AsyncWebHeader> headers;
+    std::string body;
+    AwsResponseFiller filler;   // Chunked response: gives the body a part at a time
+};
+
+class AsyncResponseStream : public AsyncWebServerResponse
+{
+public:
+    size_t write(const uint8_t *data, size_t len)
+    {
+        HostShimScope shim;
+        body.append((const char *)data, len);
+        return len;
+    }
+};
+
+class AsyncWebServerRequest
+{
+public:
+    bool hasHeader(const char *name) const;
+    const AsyncWebHeader *getHeader(const char *name) const;
+    bool hasArg(const char *name) const;
+    const String& arg(const char *name) const;
+    size_t params() const { return param_list.size(); }
+    const AsyncWebParameter *getParam(size_t i) const { return &param_list[i]; }
+    bool hasParam(const char *name) const { return hasArg(name); }
+    const AsyncWebParameter *getParam(const char *name) const;
+
+    void send(int code, const String& type = String(), const String& content = String());
+    void send(AsyncWebServerResponse *response);
+    AsyncWebServerResponse *beginResponse(int code, const String& type = String(), const String& content = String());
+    AsyncWebServerResponse *beginResponse_P(int code, const String& type, const uint8_t *content, size_t len);
+    AsyncResponseStream *beginResponseStream(const String& type, size_t bufferSize = 1460);
+    AsyncWebServerResponse *beginChunkedResponse(const String& type, AwsResponseFiller filler);
+    void onDisconnect(ArDisconnectHandler fn) { disconnect = fn; }
+
+    std::vector<AsyncWebHeader> header_list;
+    std::vector<AsyncWebParameter> param_list;
+    std::unique_ptr<AsyncWebServerResponse> response;
+    ArDisconnectHandler disconnect;
+};
+
+class AsyncWebServer
+{
+public:
+    AsyncWebServer(uint16_t port);
+    void on(const char *uri, ArRequestHandlerFunction fn) { on(uri, HTTP_ANY, fn); }
+    void on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction fn,
+            ArUploadHandlerFunction upload = ArUploadHandlerFunction());
+    void begin() {}
+
+    struct Route
+    {
+        std::string uri;
+        WebRequestMethodComposite method;
+        ArRequestHandlerFunction fn;
+        ArUploadHandlerFunction upload;
+    };
+    std::vector<Route> routes;
+};
+
+// Response as the client sees it
+struct HostResponse
+{
+    int code = 404;
+    std::string type;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+    std::shared_ptr<AsyncWebServerRequest> request; // Kept for a chunked response, to drain more or disconnect
+    bool ended = false;     // The chunked response has ended
+
+    const char *header(const char *name) const;
+    size_t more(size_t max_len = 1460);     // Drain more of a chunked response into body; returns the bytes added
+    void disconnect();
+};
+
+// Make a request to the last server created: url is the path with an optional query string. An upload body is handed
+// to the upload handler in chunks of the given size before the request handler runs.
+HostResponse host_http(WebRequestMethod method, const char *url,
+                       const std::vector<std::pair<std::string, std::string>>& headers = {},
+                       const std::string& upload = std::string(), size_t chunk = 1460);
@@ -0,0 +1,28 @@
+#pragma once
+#include "Arduino.h"
+#include <vector>
+
+// Host build: the OTA partition writer, keeping the image in memory
+// host_update_fail() makes the given write fail, to exercise the error paths.
+
+#define UPDATE_SIZE_UNKNOWN  0xFFFFFFFF
+
+class UpdateClass
+{
+public:
+    bool begin(size_t size);
+    size_t write(uint8_t *data, size_t len);
+    bool end(bool evenIfRemaining = false);
+    void abort();
+    bool hasError() const { return error; }
+    void printError(HardwareSerial& out) { out.println("Update error"); }
+
+    std::vector<uint8_t> image;     // Bytes written so far
+    std::vector<size_t> writes;     // Length of each write
+    bool active = false;
+    bool done = false;              // The image was activated
+    bool error = false;
+    int fail_write = -1;            // Index of the write that fails, or -1
+};
+
+extern UpdateClass Update;
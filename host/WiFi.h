@@ -0,0 +1,37 @@
+#pragma once
+#include "Arduino.h"
+
+// Host build: a station that is always connected
+
+#define WIFI_STA       1
+#define WL_CONNECTED   3
+
+class IPAddress : public Printable
+{
+public:
+    IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : a(a), b(b), c(c), d(d) {}
+    String toString() const
+    {
+        char s[16];
+        snprintf(s, sizeof(s), "%u.%u.%u.%u", a, b, c, d);
+        return String(s);
+    }
+
+private:
+    uint8_t a, b, c, d;
+};
+
+class WiFiClass
+{
+public:
+    bool disconnect(bool wifioff = false) { return true; }
+    bool mode(int m) { return true; }
+    bool config(IPAddress ip, IPAddress gateway, IPAddress subnet) { return true; }
+    int begin(const char *ssid, const char *pass) { return WL_CONNECTED; }
+    int status() { return WL_CONNECTED; }
+    String macAddress() { return String("00:00:00:00:00:00"); }
+    IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+    int8_t RSSI() { return -50; }
+};
+
+extern WiFiClass WiFi;
@@ -0,0 +1,27 @@
+#pragma once
+#include "Arduino.h"
+
+// Host build: the I2C bus with a register-file device behind it
+// A test attaches a device (a BME280 register image) at an address. A read starts at the register pointer written by
+// the last transmission and auto-increments, the same as the BME280 does. host_wire_short() makes the next reads
+// return fewer bytes than requested, and host_wire_nack() makes the transmissions fail, to exercise the error paths.
+class TwoWire
+{
+public:
+    bool begin() { return true; }
+    void end() {}
+    void setTimeOut(uint16_t ms) {}
+    void beginTransmission(uint8_t addr);
+    size_t write(uint8_t data);
+    uint8_t endTransmission();
+    uint8_t requestFrom(uint8_t addr, uint8_t len);
+    uint8_t requestFrom(int addr, int len) { return requestFrom(uint8_t(addr), uint8_t(len)); }
+    int available();
+    int read();
+};
+
+extern TwoWire Wire;
+
+void host_wire_device(uint8_t addr, uint8_t *regs); // regs: 256 registers, or NULL to remove the device
+void host_wire_short(int reads, int len);           // The next reads return at most len bytes
+void host_wire_nack(int transmissions);             // The next transmissions are not acknowledged
@@ -0,0 +1,479 @@
+// Host build: Arduino core, IDF drivers and FreeRTOS shims
+#include "Arduino.h"
+#include "Wire.h"
+#include "WiFi.h"
+#include "Update.h"
+#include "nvs.h"
+#include "esp_heap_caps.h"
+#include "driver/rmt.h"
+#include <stdarg.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+HardwareSerial Serial;
+EspClass ESP;
+TwoWire Wire;
+WiFiClass WiFi;
+UpdateClass Update;
+bool host_serial_echo = false;
+bool host_restarted = false;
+thread_local int host_shim_depth = 0;
+
+// Virtual time
+static std::atomic<uint64_t> host_us(0);
+
+uint32_t micros() { return uint32_t(host_us.load()); }
+uint32_t millis() { return uint32_t(host_us.load() / 1000); }
+void host_advance_us(uint32_t us) { host_us += us; }
+void delay(uint32_t ms) { host_us += uint64_t(ms) * 1000; }
+void delayMicroseconds(uint32_t us) { host_us += us; }
+
+// GPIO and ADC
+static int host_pins[64];
+static uint16_t host_analog_pins[64];
+static void (*host_isrs[64])();
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+int digitalRead(uint8_t pin) { return host_pins[pin & 63]; }
+void digitalWrite(uint8_t pin, uint8_t level) { host_pins[pin & 63] = level; }
+uint16_t analogRead(uint8_t pin) { return host_analog_pins[pin & 63]; }
+void analogReadResolution(uint8_t bits) {}
+void attachInterrupt(uint8_t irq, void (*isr)(), int mode) { host_isrs[irq & 63] = isr; }
+void host_set_pin(uint8_t pin, int level) { host_pins[pin & 63] = level; }
+void host_set_analog(uint8_t pin, uint16_t value) { host_analog_pins[pin & 63] = value; }
+void (*host_isr(uint8_t pin))() { return host_isrs[pin & 63]; }
+
+uint32_t getCpuFrequencyMhz() { return 240; }
+uint32_t esp_random() { return 0x5eed1234; }
+extern "C" uint8_t temprature_sens_read() { return 128; }
+
+size_t host_strlcpy(char *dst, const char *src, size_t size)
+{
+    size_t len = strlen(src);
+    if (size)
+    {
+        size_t n = (len < size - 1) ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = 0;
+    }
+    return len;
+}
+
+// Serial console
+size_t HardwareSerial::out(const char *s)
+{
+    if (host_serial_echo)
+        fputs(s, stdout);
+    return strlen(s);
+}
+
+size_t HardwareSerial::print(long v, int base)
+{
+    char s[24];
+    snprintf(s, sizeof(s), (base == HEX) ? "%lX" : "%ld", v);
+    return out(s);
+}
+
+size_t HardwareSerial::print(unsigned long v, int base)
+{
+    char s[24];
+    snprintf(s, sizeof(s), (base == HEX) ? "%lX" : "%lu", v);
+    return out(s);
+}
+
+size_t HardwareSerial::print(double v, int decimals)
+{
+    char s[48];
+    snprintf(s, sizeof(s), "%.*f", decimals, v);
+    return out(s);
+}
+
+size_t HardwareSerial::printf(const char *fmt, ...)
+{
+    char s[256];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(s, sizeof(s), fmt, args);
+    va_end(args);
+    return out(s);
+}
+
+// The cycle counter runs off the real clock, so that the stage timings measure the host
+uint32_t EspClass::getCycleCount()
+{
+    static const auto start = std::chrono::steady_clock::now();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    return uint32_t(uint64_t(ns) * getCpuFrequencyMhz() / 1000);
+}
+
+uint32_t EspClass::getFreeHeap() { return heap_caps_get_free_size(MALLOC_CAP_8BIT); }
+void EspClass::restart() { host_restarted = true; }
+
+// Heap statistics
+static size_t heap_free = 200 * 1024, heap_largest = 110 * 1024, heap_min = 200 * 1024;
+
+size_t heap_caps_get_free_size(uint32_t caps) { return heap_free; }
+size_t heap_caps_get_largest_free_block(uint32_t caps) { return heap_largest; }
+size_t heap_caps_get_minimum_free_size(uint32_t caps) { return heap_min; }
+
+void host_heap(size_t free, size_t largest)
+{
+    heap_free = free;
+    heap_largest = largest;
+    if (free < heap_min)
+        heap_min = free;
+}
+
+// FreeRTOS: critical sections share one recursive mutex, as disabling the interrupts on both cores would
+static std::recursive_mutex host_critical;
+
+void host_critical_enter(portMUX_TYPE *mux) { host_critical.lock(); }
+void host_critical_exit(portMUX_TYPE *mux) { host_critical.unlock(); }
+
+struct HostSemaphore
+{
+    std::timed_mutex m;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex() { return new HostSemaphore; }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t timeout)
+{
+    if (timeout == portMAX_DELAY)
+    {
+        s->m.lock();
+        return pdTRUE;
+    }
+    return s->m.try_lock_for(std::chrono::milliseconds(timeout)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s)
+{
+    s->m.unlock();
+    return pdTRUE;
+}
+
+struct HostQueue
+{
+    std::mutex m;
+    std::condition_variable cv;
+    std::deque<std::vector<uint8_t>> items;
+    UBaseType_t len, item_size;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t item_size)
+{
+    HostQueue *q = new HostQueue;
+    q->len = len;
+    q->item_size = item_size;
+    return q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t timeout)
+{
+    std::unique_lock<std::mutex> lock(q->m);
+    auto has_space = [q]() { return q->items.size() < q->len; };
+    if (timeout == portMAX_DELAY)
+        q->cv.wait(lock, has_space);
+    else if (!q->cv.wait_for(lock, std::chrono::milliseconds(timeout), has_space))
+        return pdFALSE;
+    q->items.push_back(std::vector<uint8_t>((const uint8_t *)item, (const uint8_t *)item + q->item_size));
+    q->cv.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t timeout)
+{
+    std::unique_lock<std::mutex> lock(q->m);
+    auto has_item = [q]() { return !q->items.empty(); };
+    if (timeout == portMAX_DELAY)
+        q->cv.wait(lock, has_item);
+    else if (!q->cv.wait_for(lock, std::chrono::milliseconds(timeout), has_item))
+        return pdFALSE;
+    memcpy(item, q->items.front().data(), q->item_size);
+    q->items.pop_front();
+    q->cv.notify_all();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+    std::lock_guard<std::mutex> lock(q->m);
+    return q->items.size();
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t q)
+{
+    std::lock_guard<std::mutex> lock(q->m);
+    return q->len - q->items.size();
+}
+
+// Tasks are only registered; a test runs the code it wants to exercise itself
+struct HostTask
+{
+    std::string name;
+    TaskFunction_t fn;
+    uint32_t stack;
+};
+
+static std::vector<HostTask *> host_tasks;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *param,
+                                   UBaseType_t prio, TaskHandle_t *handle, BaseType_t core)
+{
+    HostTask *t = new HostTask { name, fn, stack };
+    host_tasks.push_back(t);
+    if (handle)
+        *handle = t;
+    return pdPASS;
+}
+
+TaskHandle_t xTaskGetHandle(const char *name)
+{
+    for (HostTask *t : host_tasks)
+    {
+        if (t->name == name)
+            return t;
+    }
+    return NULL;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) { return task->stack / 2; }
+TickType_t xTaskGetTickCount() { return millis(); }
+void vTaskDelay(TickType_t ticks) { host_us += uint64_t(ticks) * 1000; std::this_thread::yield(); }
+
+void vTaskDelayUntil(TickType_t *last_wake, TickType_t period)
+{
+    *last_wake += period;
+    uint64_t wake_us = uint64_t(*last_wake) * 1000;
+    uint64_t now = host_us.load();
+    while ((now < wake_us) && !host_us.compare_exchange_weak(now, wake_us))
+        ;
+}
+
+void taskYIELD() { std::this_thread::yield(); }
+BaseType_t xPortGetCoreID() { return 0; }
+
+// I2C bus
+static uint8_t *wire_regs[128];
+static uint8_t wire_addr, wire_reg;
+static bool wire_reg_set;
+static std::deque<uint8_t> wire_rx;
+static int wire_short_reads, wire_short_len, wire_nacks;
+
+void host_wire_device(uint8_t addr, uint8_t *regs) { wire_regs[addr & 127] = regs; }
+void host_wire_short(int reads, int len) { wire_short_reads = reads; wire_short_len = len; }
+void host_wire_nack(int transmissions) { wire_nacks = transmissions; }
+
+void TwoWire::beginTransmission(uint8_t addr)
+{
+    wire_addr = addr & 127;
+    wire_reg_set = false;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+    uint8_t *regs = wire_regs[wire_addr];
+    if (!regs)
+        return 0;
+    if (!wire_reg_set)
+    {
+        wire_reg = data;
+        wire_reg_set = true;
+    }
+    else
+        regs[wire_reg++] = data;
+    return 1;
+}
+
+uint8_t TwoWire::endTransmission()
+{
+    if (wire_nacks > 0)
+    {
+        wire_nacks--;
+        return 2;
+    }
+    return wire_regs[wire_addr] ? 0 : 2;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t addr, uint8_t len)
+{
+    wire_rx.clear();
+    uint8_t *regs = wire_regs[addr & 127];
+    if (!regs)
+        return 0;
+    if (wire_short_reads > 0)
+    {
+        wire_short_reads--;
+        len = (len < wire_short_len) ? len : wire_short_len;
+    }
+    for (int i = 0; i < len; i++)
+        wire_rx.push_back(regs[uint8_t(wire_reg + i)]);
+    return len;
+}
+
+int TwoWire::available() { return wire_rx.size(); }
+
+int TwoWire::read()
+{
+    if (wire_rx.empty())
+        return -1;
+    int c = wire_rx.front();
+    wire_rx.pop_front();
+    return c;
+}
+
+// NVS
+static std::map<std::string, std::vector<uint8_t>> nvs_store;
+static int nvs_fail_sets, nvs_fail_commits;
+static uint32_t nvs_commits, nvs_sets;
+
+void host_nvs_clear() { nvs_store.clear(); nvs_commits = nvs_sets = 0; }
+void host_nvs_fail(int sets, int commits) { nvs_fail_sets = sets; nvs_fail_commits = commits; }
+uint32_t host_nvs_commits() { return nvs_commits; }
+uint32_t host_nvs_sets() { return nvs_sets; }
+
+esp_err_t nvs_open(const char *name, nvs_open_mode mode, nvs_handle *handle)
+{
+    *handle = 1;
+    return ESP_OK;
+}
+
+static esp_err_t nvs_get(const char *key, void *value, size_t *len, size_t max)
+{
+    auto i = nvs_store.find(key);
+    if (i == nvs_store.end())
+        return ESP_ERR_NVS_NOT_FOUND;
+    if (i->second.size() > max)
+        return ESP_FAIL;
+    memcpy(value, i->second.data(), i->second.size());
+    if (len)
+        *len = i->second.size();
+    return ESP_OK;
+}
+
+static esp_err_t nvs_set(const char *key, const void *value, size_t len)
+{
+    if (nvs_fail_sets > 0)
+    {
+        nvs_fail_sets--;
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+    nvs_store[key] = std::vector<uint8_t>((const uint8_t *)value, (const uint8_t *)value + len);
+    nvs_sets++;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_u32(nvs_handle h, const char *key, uint32_t *value) { return nvs_get(key, value, NULL, 4); }
+esp_err_t nvs_get_blob(nvs_handle h, const char *key, void *value, size_t *len)
+{
+    return nvs_get(key, value, len, *len);
+}
+esp_err_t nvs_get_str(nvs_handle h, const char *key, char *value, size_t *len)
+{
+    return nvs_get(key, value, len, *len);
+}
+esp_err_t nvs_set_u32(nvs_handle h, const char *key, uint32_t value) { return nvs_set(key, &value, 4); }
+esp_err_t nvs_set_blob(nvs_handle h, const char *key, const void *value, size_t len)
+{
+    return nvs_set(key, value, len);
+}
+esp_err_t nvs_set_str(nvs_handle h, const char *key, const char *value)
+{
+    return nvs_set(key, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_commit(nvs_handle h)
+{
+    if (nvs_fail_commits > 0)
+    {
+        nvs_fail_commits--;
+        return ESP_FAIL;
+    }
+    nvs_commits++;
+    return ESP_OK;
+}
+
+// RMT receiver with a single frame ring buffer
+static bool rmt_fail;
+static std::vector<rmt_item32_t> rmt_frame, rmt_taken;
+static bool rmt_have_frame;
+
+void host_rmt_fail(bool fail) { rmt_fail = fail; }
+
+void host_rmt_frame(const rmt_item32_t *items, size_t n)
+{
+    rmt_frame.assign(items, items + n);
+    rmt_have_frame = true;
+}
+
+esp_err_t rmt_config(const rmt_config_t *config) { return ESP_OK; }
+esp_err_t rmt_driver_install(rmt_channel_t channel, size_t rx_buf_size, int intr_alloc_flags)
+{
+    return rmt_fail ? ESP_FAIL : ESP_OK;
+}
+esp_err_t rmt_driver_uninstall(rmt_channel_t channel) { return ESP_OK; }
+esp_err_t rmt_get_ringbuf_handle(rmt_channel_t channel, RingbufHandle_t *buf_handle)
+{
+    *buf_handle = &rmt_frame;
+    return ESP_OK;
+}
+esp_err_t rmt_rx_start(rmt_channel_t channel, bool rx_idx_rst) { return ESP_OK; }
+esp_err_t rmt_rx_stop(rmt_channel_t channel) { return ESP_OK; }
+
+void *xRingbufferReceive(RingbufHandle_t rb, size_t *len, TickType_t timeout)
+{
+    if (!rmt_have_frame)
+        return NULL;
+    rmt_have_frame = false;
+    rmt_taken.swap(rmt_frame);
+    *len = rmt_taken.size() * sizeof(rmt_item32_t);
+    return rmt_taken.data();
+}
+
+void vRingbufferReturnItem(RingbufHandle_t rb, void *item) {}
+
+// OTA partition
+bool UpdateClass::begin(size_t size)
+{
+    image.clear();
+    writes.clear();
+    active = true;
+    done = error = false;
+    return true;
+}
+
+size_t UpdateClass::write(uint8_t *data, size_t len)
+{
+    if (!active || error)
+        return 0;
+    if (int(writes.size()) == fail_write)
+    {
+        error = true;
+        return 0;
+    }
+    image.insert(image.end(), data, data + len);
+    writes.push_back(len);
+    return len;
+}
+
+bool UpdateClass::end(bool evenIfRemaining)
+{
+    if (!active || error)
+        return false;
+    active = false;
+    done = true;
+    return true;
+}
+
+void UpdateClass::abort()
+{
+    active = false;
+}
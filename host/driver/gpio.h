@@ -0,0 +1,12 @@
+#pragma once
+#include "Arduino.h"
+
+// Host build: the IDF GPIO driver, on top of the Arduino pin shim
+
+typedef int gpio_num_t;
+typedef enum { GPIO_MODE_INPUT = 1, GPIO_MODE_OUTPUT = 2, GPIO_MODE_INPUT_OUTPUT_OD = 7 } gpio_mode_t;
+
+static inline esp_err_t gpio_set_direction(gpio_num_t pin, gpio_mode_t mode) { return ESP_OK; }
+static inline esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level) { digitalWrite(pin, level); return ESP_OK; }
+static inline esp_err_t gpio_reset_pin(gpio_num_t pin) { return ESP_OK; }
+static inline esp_err_t gpio_pullup_en(gpio_num_t pin) { return ESP_OK; }
@@ -0,0 +1,55 @@
+#pragma once
+#include "Arduino.h"
+#include "driver/gpio.h"
+
+// Host build: the RMT receiver; a test queues the frame that the next receive returns
+// host_rmt_fail() makes the driver installation fail, as it does when there is no sensor on the pin.
+
+typedef enum { RMT_CHANNEL_0, RMT_CHANNEL_1, RMT_CHANNEL_MAX } rmt_channel_t;
+typedef enum { RMT_MODE_TX, RMT_MODE_RX } rmt_mode_t;
+
+typedef struct
+{
+    union
+    {
+        struct
+        {
+            uint32_t duration0 : 15;
+            uint32_t level0 : 1;
+            uint32_t duration1 : 15;
+            uint32_t level1 : 1;
+        };
+        uint32_t val;
+    };
+} rmt_item32_t;
+
+typedef struct
+{
+    uint16_t idle_threshold;
+    uint8_t filter_ticks_thresh;
+    bool filter_en;
+} rmt_rx_config_t;
+
+typedef struct
+{
+    rmt_mode_t rmt_mode;
+    rmt_channel_t channel;
+    gpio_num_t gpio_num;
+    uint8_t clk_div;
+    uint8_t mem_block_num;
+    uint32_t flags;
+    rmt_rx_config_t rx_config;
+} rmt_config_t;
+
+#define RMT_DEFAULT_CONFIG_RX(gpio, channel_id) \
+    { RMT_MODE_RX, channel_id, gpio, 80, 1, 0, { 12000, 100, true } }
+
+esp_err_t rmt_config(const rmt_config_t *config);
+esp_err_t rmt_driver_install(rmt_channel_t channel, size_t rx_buf_size, int intr_alloc_flags);
+esp_err_t rmt_driver_uninstall(rmt_channel_t channel);
+esp_err_t rmt_get_ringbuf_handle(rmt_channel_t channel, RingbufHandle_t *buf_handle);
+esp_err_t rmt_rx_start(rmt_channel_t channel, bool rx_idx_rst);
+esp_err_t rmt_rx_stop(rmt_channel_t channel);
+
+void host_rmt_fail(bool fail);
+void host_rmt_frame(const rmt_item32_t *items, size_t n); // Queue a captured frame, replacing any waiting one
@@ -0,0 +1,11 @@
+#pragma once
+#include "Arduino.h"
+
+// Host build: heap statistics, set by a test to exercise the low memory mode
+
+#define MALLOC_CAP_8BIT  (1 << 2)
+
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+size_t heap_caps_get_minimum_free_size(uint32_t caps);
+void host_heap(size_t free, size_t largest);
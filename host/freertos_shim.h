@@ -0,0 +1,62 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Host build: the FreeRTOS API the station uses, on top of the C++ standard library
+// Mutexes and queues are real (the stress tests run tasks as threads), critical sections all share one recursive
+// mutex the way disabling the interrupts would, and creating a task only registers it: the tests drive the task
+// bodies themselves.
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef void (*TaskFunction_t)(void *);
+typedef struct HostTask *TaskHandle_t;
+typedef struct HostSemaphore *SemaphoreHandle_t;
+typedef struct HostQueue *QueueHandle_t;
+
+#define pdTRUE   1
+#define pdFALSE  0
+#define pdPASS   1
+#define portMAX_DELAY       0xFFFFFFFFu
+#define portTICK_PERIOD_MS  1
+#define pdMS_TO_TICKS(ms)   TickType_t(ms)
+
+struct portMUX_TYPE
+{
+    int owner;
+};
+#define portMUX_INITIALIZER_UNLOCKED  { 0 }
+
+// All critical sections share one mutex; the spinlock given is not used
+void host_critical_enter(portMUX_TYPE *mux);
+void host_critical_exit(portMUX_TYPE *mux);
+#define portENTER_CRITICAL(mux)      host_critical_enter(mux)
+#define portEXIT_CRITICAL(mux)       host_critical_exit(mux)
+#define portENTER_CRITICAL_ISR(mux)  host_critical_enter(mux)
+#define portEXIT_CRITICAL_ISR(mux)   host_critical_exit(mux)
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t timeout);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s);
+
+QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t item_size);
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t timeout);
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t timeout);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q);
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t q);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *param,
+                                   UBaseType_t prio, TaskHandle_t *handle, BaseType_t core);
+TaskHandle_t xTaskGetHandle(const char *name);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+TickType_t xTaskGetTickCount();
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t *last_wake, TickType_t period);
+void taskYIELD();
+BaseType_t xPortGetCoreID();
+
+// RMT receive ring buffer; there is never a frame to receive on the host
+typedef void *RingbufHandle_t;
+void *xRingbufferReceive(RingbufHandle_t rb, size_t *len, TickType_t timeout);
+void vRingbufferReturnItem(RingbufHandle_t rb, void *item);
@@ -0,0 +1,20 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Host build: SHA-256 with the mbedtls 3.x interface (FIPS 180-4, a plain implementation)
+
+#define MBEDTLS_VERSION_NUMBER  0x03000000
+
+typedef struct
+{
+    uint32_t state[8];
+    uint64_t total;         // Bytes hashed so far
+    uint8_t block[64];      // Partial block
+} mbedtls_sha256_context;
+
+void mbedtls_sha256_init(mbedtls_sha256_context *ctx);
+void mbedtls_sha256_free(mbedtls_sha256_context *ctx);
+int mbedtls_sha256_starts(mbedtls_sha256_context *ctx, int is224);
+int mbedtls_sha256_update(mbedtls_sha256_context *ctx, const unsigned char *input, size_t len);
+int mbedtls_sha256_finish(mbedtls_sha256_context *ctx, unsigned char output[32]);
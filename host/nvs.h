@@ -0,0 +1,28 @@
+#pragma once
+#include "Arduino.h"
+
+// Host build: the NVS key-value store, kept in memory
+// Each set is stored right away, as on the device; nvs_commit() only counts the commits. host_nvs_fail() makes the
+// next sets or commits fail, to exercise the error paths.
+
+typedef uint32_t nvs_handle;
+typedef nvs_handle nvs_handle_t;
+
+enum nvs_open_mode { NVS_READONLY, NVS_READWRITE };
+
+#define ESP_ERR_NVS_NOT_FOUND  0x1102
+#define ESP_ERR_NVS_NOT_ENOUGH_SPACE  0x1105
+
+esp_err_t nvs_open(const char *name, nvs_open_mode mode, nvs_handle *handle);
+esp_err_t nvs_get_u32(nvs_handle h, const char *key, uint32_t *value);
+esp_err_t nvs_get_blob(nvs_handle h, const char *key, void *value, size_t *len);
+esp_err_t nvs_get_str(nvs_handle h, const char *key, char *value, size_t *len);
+esp_err_t nvs_set_u32(nvs_handle h, const char *key, uint32_t value);
+esp_err_t nvs_set_blob(nvs_handle h, const char *key, const void *value, size_t len);
+esp_err_t nvs_set_str(nvs_handle h, const char *key, const char *value);
+esp_err_t nvs_commit(nvs_handle h);
+
+void host_nvs_clear();
+void host_nvs_fail(int sets, int commits);  // The next sets and commits fail with ESP_ERR_NVS_NOT_ENOUGH_SPACE
+uint32_t host_nvs_commits();
+uint32_t host_nvs_sets();
@@ -0,0 +1,6 @@
+#pragma once
+
+// Host build: flash data is ordinary memory
+#ifndef PROGMEM
+#define PROGMEM
+#endif
@@ -0,0 +1,224 @@
+// Host build: ESPAsyncWebServer requests dispatched in-process
+#include "ESPAsyncWebSrv.h"
+
+static AsyncWebServer *host_server;
+static const String empty;
+
+// Runs a firmware handler from inside the shim: its allocations are the firmware's again
+struct FirmwareScope
+{
+    int saved;
+    FirmwareScope() : saved(host_shim_depth) { host_shim_depth = 0; }
+    ~FirmwareScope() { host_shim_depth = saved; }
+};
+
+AsyncWebServer::AsyncWebServer(uint16_t port)
+{
+    host_server = this;
+}
+
+void AsyncWebServer::on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction fn,
+                        ArUploadHandlerFunction upload)
+{
+    HostShimScope shim;
+    routes.push_back(Route { uri, method, fn, upload });
+}
+
+bool AsyncWebServerRequest::hasHeader(const char *name) const
+{
+    return getHeader(name) != NULL;
+}
+
+const AsyncWebHeader *AsyncWebServerRequest::getHeader(const char *name) const
+{
+    for (const AsyncWebHeader& h : header_list)
+    {
+        if (strcasecmp(h.name().c_str(), name) == 0)
+            return &h;
+    }
+    return NULL;
+}
+
+bool AsyncWebServerRequest::hasArg(const char *name) const
+{
+    return getParam(name) != NULL;
+}
+
+const String& AsyncWebServerRequest::arg(const char *name) const
+{
+    const AsyncWebParameter *p = getParam(name);
+    return p ? p->value() : empty;
+}
+
+const AsyncWebParameter *AsyncWebServerRequest::getParam(const char *name) const
+{
+    for (const AsyncWebParameter& p : param_list)
+    {
+        if (p.name() == name)
+            return &p;
+    }
+    return NULL;
+}
+
+void AsyncWebServerRequest::send(int code, const String& type, const String& content)
+{
+    send(beginResponse(code, type, content));
+}
+
+void AsyncWebServerRequest::send(AsyncWebServerResponse *r)
+{
+    HostShimScope shim;
+    response.reset(r);
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginResponse(int code, const String& type, const String& content)
+{
+    HostShimScope shim;
+    AsyncWebServerResponse *r = new AsyncWebServerResponse;
+    r->code = code;
+    r->type = type;
+    r->body = content.c_str();
+    return r;
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginResponse_P(int code, const String& type, const uint8_t *content,
+                                                               size_t len)
+{
+    HostShimScope shim;
+    AsyncWebServerResponse *r = beginResponse(code, type);
+    r->body.assign((const char *)content, len);
+    return r;
+}
+
+AsyncResponseStream *AsyncWebServerRequest::beginResponseStream(const String& type, size_t bufferSize)
+{
+    HostShimScope shim;
+    AsyncResponseStream *r = new AsyncResponseStream;
+    r->type = type;
+    return r;
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginChunkedResponse(const String& type, AwsResponseFiller filler)
+{
+    HostShimScope shim;
+    AsyncWebServerResponse *r = beginResponse(200, type);
+    r->filler = filler;
+    return r;
+}
+
+const char *HostResponse::header(const char *name) const
+{
+    for (auto& h : headers)
+    {
+        if (strcasecmp(h.first.c_str(), name) == 0)
+            return h.second.c_str();
+    }
+    return NULL;
+}
+
+size_t HostResponse::more(size_t max_len)
+{
+    HostShimScope shim;
+    if (!request || !request->response || !request->response->filler)
+        return 0;
+    std::string buf(max_len, 0);
+    size_t added = 0;
+    for (;;)
+    {
+        size_t n;
+        {
+            FirmwareScope firmware;
+            n = request->response->filler((uint8_t *)&buf[0], max_len, body.size());
+        }
+        ended = (n == 0);
+        if ((n == 0) || (n == RESPONSE_TRY_AGAIN))
+            break;
+        body.append(buf, 0, n);
+        added += n;
+    }
+    return added;
+}
+
+void HostResponse::disconnect()
+{
+    if (request && request->disconnect)
+        request->disconnect();
+    request.reset();
+}
+
+static std::string url_decode(const std::string& s)
+{
+    std::string out;
+    for (size_t i = 0; i < s.size(); i++)
+    {
+        if ((s[i] == '%') && (i + 2 < s.size()))
+        {
+            out.push_back(char(strtoul(s.substr(i + 1, 2).c_str(), NULL, 16)));
+            i += 2;
+        }
+        else
+            out.push_back((s[i] == '+') ? ' ' : s[i]);
+    }
+    return out;
+}
+
+HostResponse host_http(WebRequestMethod method, const char *url,
+                       const std::vector<std::pair<std::string, std::string>>& headers,
+                       const std::string& upload, size_t chunk)
+{
+    HostShimScope shim;
+    HostResponse resp;
+    std::shared_ptr<AsyncWebServerRequest> request(new AsyncWebServerRequest);
+    for (auto& h : headers)
+        request->header_list.push_back(AsyncWebHeader(h.first.c_str(), h.second.c_str()));
+
+    std::string path = url, query;
+    size_t q = path.find('?');
+    if (q != std::string::npos)
+    {
+        query = path.substr(q + 1);
+        path.resize(q);
+    }
+    for (size_t pos = 0; pos < query.size(); )
+    {
+        size_t end = query.find('&', pos);
+        if (end == std::string::npos)
+            end = query.size();
+        std::string arg = query.substr(pos, end - pos);
+        size_t eq = arg.find('=');
+        std::string name = url_decode(arg.substr(0, eq));
+        std::string value = (eq == std::string::npos) ? "" : url_decode(arg.substr(eq + 1));
+        request->param_list.push_back(AsyncWebParameter(name.c_str(), value.c_str()));
+        pos = end + 1;
+    }
+
+    for (auto& r : host_server->routes)
+    {
+        if ((r.uri != path) || !(r.method & method))
+            continue;
+        if (r.upload)
+        {
+            for (size_t i = 0; i == 0 || i < upload.size(); i += chunk)
+            {
+                size_t n = (upload.size() - i < chunk) ? upload.size() - i : chunk;
+                FirmwareScope firmware;
+                r.upload(request.get(), String("firmware.bin"), i, (uint8_t *)&upload[i], n, i + n == upload.size());
+            }
+        }
+        FirmwareScope firmware;
+        r.fn(request.get());
+        break;
+    }
+    if (!request->response)
+        return resp;
+
+    AsyncWebServerResponse *r = request->response.get();
+    resp.code = r->code;
+    resp.type = r->type.c_str();
+    for (auto& h : r->headers)
+        resp.headers.push_back(std::make_pair(std::string(h.name().c_str()), std::string(h.value().c_str())));
+    resp.body = r->body;
+    resp.request = request;
+    resp.more();
+    return resp;
+}
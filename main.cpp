@@ -1,67 +1,157 @@
 #include "main.h"
-#include <Preferences.h>
+#include "snapshot.h"
+#include "weathercalc.h"
 
 WeatherData wdata = {};
 
+// Published snapshot of the weather data that the web server reads from, and the lock serializing its writers
+static SeqLock<WeatherData> wdata_pub;
+static portMUX_TYPE wdata_pub_mux = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t wdata_semaphore;
+
+// Queue of the raw samples from the acquisition task to the aggregation task, and its instrumentation
+#define RAW_QUEUE_LEN  4
+static QueueHandle_t raw_queue;
+static uint32_t raw_depth_max = 0;      // Max number of samples waiting in the queue
+static uint32_t raw_drops = 0;          // Number of samples merged into the next one because the queue was full
+static uint32_t raw_latency_us = 0;     // Time from reading a sample to publishing it, in microseconds
+static uint32_t raw_latency_us_max = 0;
+static volatile uint32_t tick_done_us = 0;  // Time the inputs of the last tick were read (micros)
+static uint32_t tick_jitter_us_max = 0;     // Max deviation of a tick from the 1-sec cadence, since the last reset
+
 // Auto-detected sensors
 static bool using_bme280 = false;
 static bool using_dht22 = false;
 
-// Sliding window buffer to calculate the average wind speed over a period of two minutes
-#define RT_AVG_MAX  (120 / PERIOD_5_SEC)
-static float rt_avg[RT_AVG_MAX] = {};
-static uint32_t rt_avg_next = 0;
-
-// Sliding window buffer to keep individual peak winds over a period of two minutes
-#define RT_PEAK_MAX  (120 / PERIOD_PEAK_WIND_SEC)
-static float rt_peak[RT_PEAK_MAX] = {};
-static uint32_t rt_peak_next = 0;
-
-// Sliding window buffer to calculate the average wind direction over a period of two minutes
-static float rt_wdir_ew[RT_AVG_MAX] = {}; // Wind direction: East-West coordinate
-static float rt_wdir_ns[RT_AVG_MAX] = {}; // Wind direction: North-South coordinate
-static uint32_t rt_wdir_next = 0;
-
-// Sliding window buffer to keep detected rain tip values (new rain) for the rain rate calculation over a period of ten minutes
-#define RT_RAIN_MAX  (PERIOD_RAIN_RATE / PERIOD_5_SEC)
-static uint8_t rt_rain[RT_RAIN_MAX] = {}; // Using a byte array since we can't have more than a few tips in a 5-sec period
-static uint32_t rt_rain_next = 0;
-
-// Look up tables for wind direction polar system transformation, we only read 16 directions from the wind vane
-static const float tbl_sin[16] = {
-     0.000000, 0.382683, 0.707107, 0.923880, 1.000000, 0.923880, 0.707107, 0.382683,
-     0.000000,-0.382683,-0.707107,-0.923879,-1.000000,-0.923879,-0.707107,-0.382683 };
-static const float tbl_cos[16] = {
-     1.000000, 0.923880, 0.707107, 0.382683, 0.000000,-0.382683,-0.707107,-0.923880,
-    -1.000000,-0.923880,-0.707107,-0.382684, 0.000000, 0.382684, 0.707107, 0.923880 };
-
-static Preferences pref;
-
-// Set a preference string value pairs, we are using int, float and string variants
-void pref_set(const char* name, uint32_t value)
+// Calculation of the weather data, with all of its state (see weathercalc.h)
+static WeatherCalc calc(pref_changed);
+
+// Take the lock guarding modifications of the working copy of the weather data
+bool wdata_lock(TickType_t timeout)
+{
+    return xSemaphoreTake(wdata_semaphore, timeout) == pdTRUE;
+}
+
+void wdata_unlock()
 {
-    pref.begin("wd", false);
-    pref.putUInt(name, value);
-    pref.end();
+    xSemaphoreGive(wdata_semaphore);
 }
 
-void pref_set(const char* name, float value)
+// Publish the current working copy of the weather data; the caller has to hold the wdata lock
+void wdata_publish()
 {
-    pref.begin("wd", false);
-    pref.putFloat(name, value);
-    pref.end();
+    // The web server reads the snapshot from a task of a higher priority than the aggregation task; it must not preempt
+    // the write half way, or it would spin on the snapshot forever (see snapshot.h)
+    portENTER_CRITICAL(&wdata_pub_mux);
+    wdata_pub.write(wdata);
+    portEXIT_CRITICAL(&wdata_pub_mux);
 }
 
-void pref_set(const char* name, String value)
+// Get a consistent copy of the last published weather data and return its generation. This never blocks.
+uint32_t wdata_snapshot(WeatherData& wd)
 {
-    pref.begin("wd", false);
-    pref.putString(name, value);
-    pref.end();
+    return wdata_pub.read(wd);
 }
 
-static void vTask_read_sensors(void *p)
+// The generation counter increments with every published change of the weather data
+uint32_t wdata_generation()
 {
-    float hz, mph;
+    return wdata_pub.generation();
+}
+
+// Read the raw inputs of one tick: the pulses counted since the last tick, the wind vane and, once every 5 seconds,
+// all other sensors
+static void read_raw(RawSample& r)
+{
+    r.time = micros();
+    r.flags = 0;
+    r.anem_count = anem.get_and_clear_count();
+    r.rain_count = rain.get_and_clear_count();
+    for (r.anem_n = 0; (r.anem_n < RAW_ANEM_MAX) && anem.pop_time(r.anem_times[r.anem_n]); r.anem_n++)
+        ;
+    for (r.rain_n = 0; (r.rain_n < RAW_RAIN_MAX) && rain.pop_time(r.rain_times[r.rain_n]); r.rain_n++)
+        ;
+    StageTimer t = stage_begin();
+    r.wind_dir_adc = read_wind_dir_adc(); // Filtered over the last second by its own task, this does not wait
+    stage_end(STAGE_VANE, t);
+
+    // Start the temperature sensor measurement a tick ahead, so that it is ready to be read without waiting for it
+    if ((r.seconds % PERIOD_5_SEC) == PERIOD_5_SEC - 1)
+    {
+        if (using_bme280) bme280_start();
+        if (using_dht22)  dht22_start();
+    }
+
+    // Once every 5 seconds, read the other sensors
+    if ((r.seconds % PERIOD_5_SEC) == 0)
+    {
+        r.flags |= RAW_SENSORS;
+        if (using_bme280)
+        {
+            t = stage_begin();
+            r.flags |= RAW_BME | (read_bme280_raw(r.bme) ? RAW_BME_OK : 0);
+            stage_end(STAGE_BME280, t);
+        }
+        if (using_dht22)
+        {
+            t = stage_begin();
+            r.flags |= RAW_DHT | (read_dht22_raw(r.dht_temp, r.dht_hum) ? RAW_DHT_OK : 0);
+            stage_end(STAGE_DHT22, t);
+        }
+    }
+}
+
+// Calculate the weather data from the raw inputs of one tick (see weathercalc.h); the caller has to hold the wdata
+// lock. Returns the number of new rain tips when the 5-sec data was recalculated, or -1 otherwise.
+static int process_raw(const RawSample& r)
+{
+    int rain_new = calc.process(r, wdata);
+    if (rain_new < 0)
+        return rain_new;
+
+#ifdef TEST
+    Serial.print(wdata.seconds);
+    Serial.print(": ");
+    Serial.print(wdata.temp_c);
+    Serial.print(" C ");
+    Serial.print(wdata.temp_f);
+    Serial.print(" F ");
+    Serial.print(wdata.pressure);
+    Serial.print(" hPa HUM: ");
+    Serial.print(wdata.humidity);
+    Serial.print(" % PEAK: ");
+    Serial.print(wdata.wind_peak);
+    Serial.print(" mph RT: ");
+    Serial.print(wdata.wind_rt);
+    Serial.print(" mph AVG: ");
+    Serial.print(wdata.wind_avg);
+    Serial.print(" mph DIR: ");
+    Serial.print(wdata.wind_dir_rt);
+    Serial.print(" DIR_AVG: ");
+    Serial.print(wdata.wind_dir_avg);
+    Serial.print(" deg RAIN: ");
+    Serial.print(wdata.rain_rate);
+    Serial.print(" EVENT: ");
+    Serial.print(wdata.rain_event);
+    Serial.print(" TOT: ");
+    Serial.print(wdata.rain_total);
+    Serial.println(" RTEST: ");
+    Serial.print(wdata.rain_test);
+    Serial.println("");
+#endif // TEST
+
+    return rain_new;
+}
+
+// Acquisition stage: read the raw inputs once a second and hand them over to the aggregation stage. This task does
+// nothing else, so its cadence is not disturbed by the calculation, the web server or the NVM writes.
+static void vTask_acquire(void *p)
+{
+    static RawSample raw;  // Raw inputs to hand over: the current tick, or the ticks not handed over yet
+    static RawSample tick; // Raw inputs of the current tick
+    bool pending = false;  // The last sample could not be handed over
+    uint32_t seconds = 0;
+    uint32_t last_time = 0;
 
     // Make this task sleep and awake once a second
     const TickType_t xFrequency = 1 * 1000 / portTICK_PERIOD_MS;
@@ -71,163 +161,99 @@ static void vTask_read_sensors(void *p)
     {
         // Wait for the next cycle first, all calculation below will be triggered after the initial period passed
         vTaskDelayUntil(&xLastWakeTime, xFrequency);
-        wdata.seconds++;
+        tick.seconds = ++seconds;
+        StageTimer t = stage_begin();
+        read_raw(tick);
+        stage_end(STAGE_ACQUIRE, t);
+        tick_done_us = micros();
+
+        // How far off the 1-sec cadence this tick was read; anything stalling both cores (a flash write) shows here
+        if (seconds > 1)
+        {
+            uint32_t dt = tick.time - last_time;
+            uint32_t jitter = (dt > 1000000) ? dt - 1000000 : 1000000 - dt;
+            if (jitter > tick_jitter_us_max)
+                tick_jitter_us_max = jitter;
+        }
+        last_time = tick.time;
+
+        // If the aggregation stage has fallen behind by the whole queue, the sample is kept and the next tick is
+        // merged into it, so that the pulse counts and the 5-sec sensor readings still get through
+        if (pending)
+            raw_merge(raw, tick);
+        else
+            raw = tick;
+        pending = xQueueSend(raw_queue, &raw, 0) != pdTRUE;
+        if (pending)
+            raw_drops++;
+        uint32_t depth = uxQueueMessagesWaiting(raw_queue);
+        if (depth > raw_depth_max)
+            raw_depth_max = depth;
+    }
+}
+
+// Aggregation stage: calculate and publish the weather data from the raw samples, on the other core
+static void vTask_aggregate(void *p)
+{
+    static RawSample raw; // Raw inputs being processed
+    static TraceSetup setup; // Configuration of the calculation, recorded with the samples
+    uint32_t flushed = 0; // Seconds of the last preferences flush
 
-        // Once an hour, adjust rain event counters and possibly reset rain_event value
-        if ((wdata.seconds % PERIOD_1_HR) == 0)
+    for (;;)
+    {
+        xQueueReceive(raw_queue, &raw, portMAX_DELAY);
+
+        wdata_lock(portMAX_DELAY);
+        calc.get_setup(wdata, setup);
+        trace_sample(raw, setup);
+        StageTimer t = stage_begin();
+        int rain_new = process_raw(raw);
+        stage_end(STAGE_PROCESS, t);
+        if (rain_new >= 0)
         {
-            wdata.rain_event_cnt += 1; // Increment the counter by one hour and make sure it is safely stored in the NVM
-            pref_set("rain_event_cnt", wdata.rain_event_cnt);
-            // Reset the rain_event only when the time since the last rain equals the reset limit. The counter will keep
-            // incrementing showing the number of hours since the last rain even after it had zeroed out the rain_event
-            if (wdata.rain_event_cnt == wdata.rain_event_max)
+            // Write back the preferences cache on a schedule (a merged sample may have skipped the exact second)
+            if ((wdata.seconds / PREF_FLUSH_SEC) != (flushed / PREF_FLUSH_SEC))
             {
-                wdata.rain_event = 0;
-                pref_set("rain_event", wdata.rain_event);
+                pref_flush();
+                flushed = wdata.seconds;
             }
-        }
 
-        // Once every 3 seconds, calculate individual peak wind
-        if ((wdata.seconds % PERIOD_PEAK_WIND_SEC) == 0)
-        {
-            uint32_t count2 = anem.get_and_clear_count2();
-            hz = float(count2) / PERIOD_PEAK_WIND_SEC;
-            mph = hz * wdata.wind_calib;
+            // At the end, publish a new snapshot of the weather data that the web server will give out. This happens
+            // only when we have new data; the web server renders its responses on demand when the generation moves.
+            mem_update();
 
-            // Store the new 3-sec wind peak value into a circular buffer
-            rt_peak[rt_peak_next] = mph;
-            rt_peak_next = (rt_peak_next + 1) % RT_PEAK_MAX;
+            t = stage_begin();
+            wdata_publish();
+            webserver_push_sample(wdata);
+            history_add(wdata, rain_new);
+            stage_end(STAGE_PUBLISH, t);
         }
+        wdata_unlock();
 
-        // Once every 5 seconds, read all sensors and recalculate relevant data
-        if ((wdata.seconds % PERIOD_5_SEC) == 0)
-        {
-            // Fill up WeatherData fields with the sensors' (and computed) data
+        // Time from reading the inputs to having them published
+        raw_latency_us = micros() - raw.time;
+        if (raw_latency_us > raw_latency_us_max)
+            raw_latency_us_max = raw_latency_us;
+    }
+}
 
-            // Read temperature, humidity and pressure sensor
-            if (using_bme280) read_bme280();
-            if (using_dht22)  read_dht22();
+void pipeline_stats(uint32_t& depth_max, uint32_t& drops, uint32_t& latency_us, uint32_t& latency_us_max)
+{
+    depth_max = raw_depth_max;
+    drops = raw_drops;
+    latency_us = raw_latency_us;
+    latency_us_max = raw_latency_us_max;
+}
 
-            // Find the max peak wind over the size of its circular buffer, a 2-minute sliding window
-            float wind_peak = rt_peak[0];
-            for (int i = 1; i < RT_PEAK_MAX; i++)
-            {
-                if (rt_peak[i] > wind_peak)
-                    wind_peak = rt_peak[i];
-            }
-            wdata.wind_peak = wind_peak;
-
-            // Calculate wind realitime, average over a 5-sec sampling period
-            uint32_t count = anem.get_and_clear_count();
-            wdata.anem_count = count;
-            hz = float(count) / PERIOD_5_SEC;
-            mph = hz * wdata.wind_calib;
-            wdata.wind_rt = mph;
-
-            // Store the new 5-sec real-time wind into a circular buffer
-            rt_avg[rt_avg_next] = wdata.wind_rt;
-            rt_avg_next = (rt_avg_next + 1) % RT_AVG_MAX;
-
-            // Calculate average wind speed over the size of its circular buffer, a 2-minute sliding window
-            float sum = rt_avg[0];
-            for (int i = 1; i < RT_AVG_MAX; i++)
-                sum += rt_avg[i];
-            wdata.wind_avg = sum / RT_AVG_MAX;
-
-            // Get and store wind vane direction
-            wdata.wind_dir_adc = read_wind_dir_adc();
-            wdata.wind_dir_rt = wind_calc_dir(wdata.wind_dir_adc);
-
-            // Make a wind vane vector from (direction, wind speed)
-            uint32_t wdir = wdata.wind_dir_rt;
-            float wrt = wdata.wind_rt;
-
-            // Store the new 5-sec real-time wind direction into a circular buffer
-            rt_wdir_ew[rt_wdir_next] = wrt * tbl_sin[wdir];
-            rt_wdir_ns[rt_wdir_next] = wrt * tbl_cos[wdir];
-            rt_wdir_next = (rt_wdir_next + 1) % RT_AVG_MAX;
-
-            // Calculate the average of wind directional vectors, a 2-minute sliding window
-            // http://www.webmet.com/met_monitoring/622.html
-            float wdir_ew = rt_wdir_ew[0];
-            float wdir_ns = rt_wdir_ns[0];
-            for (int i = 1; i < RT_AVG_MAX; i++)
-            {
-                wdir_ew += rt_wdir_ew[i];
-                wdir_ns += rt_wdir_ns[i];
-            }
-            wdir_ew /= RT_AVG_MAX;
-            wdir_ns /= RT_AVG_MAX;
-            // From the (x,y) that is (ew,ns), compute the vector angle of the final average wind direction
-            float angle = atan2(wdir_ew, wdir_ns) * RAD_TO_DEG;
-            if (angle < 0)
-                angle = angle + 360;
-            wdata.wind_dir_avg = int(angle) % 360;
-
-            // Read the current rain gauge tip counter for any tips accumulated in the last 5-sec interval
-            uint32_t rain_count = rain.get_and_clear_count();
-            wdata.rain_test += rain_count; // Always increment the test counter
-            // If the relative humidity was less than a cutoff value, it is a false rain positive and will be ignored
-            // However, if the BME humidity sensor could not be read, ignore that check
-            if ((wdata.error & ERROR_BME_READ) || (uint32_t(wdata.humidity) >= CAN_RAIN_HUMIDITY_MIN))
-            {
-                // Store the new rain tip amount into a circular buffer
-                rt_rain[rt_rain_next] = uint8_t(rain_count);
-                rt_rain_next = (rt_rain_next + 1) % RT_RAIN_MAX;
-
-                // Calculate the sum of all new rain tips for the past 10-min and publish it as a rain rate
-                uint32_t rain_sum = uint32_t(rt_rain[0]);
-                for (int i = 1; i < RT_RAIN_MAX; i++)
-                    rain_sum += uint32_t(rt_rain[i]);
-                wdata.rain_rate = rain_sum * RAIN_RATE_MUL; // Publish it as "per hour" value
-
-                // Add the new rain volume to the current rain_event and the overall rain total and back the result up in the NVM
-                // Do it only if there is new rain to add so that we don't write to NVM unnecessarily
-                if (rain_count)
-                {
-                    wdata.rain_event += rain_count;
-                    wdata.rain_total += rain_count;
-                    wdata.rain_event_cnt = 0; // Restart 'the number of hours since the last rain' counter
-                    pref_set("rain_event", wdata.rain_event);
-                    pref_set("rain_total", wdata.rain_total);
-                    pref_set("rain_event_cnt", wdata.rain_event_cnt);
-                }
-            }
-#ifdef TEST
-            Serial.print(wdata.seconds);
-            Serial.print(": ");
-            Serial.print(wdata.temp_c);
-            Serial.print(" C ");
-            Serial.print(wdata.temp_f);
-            Serial.print(" F ");
-            Serial.print(wdata.pressure);
-            Serial.print(" hPa HUM: ");
-            Serial.print(wdata.humidity);
-            Serial.print(" % PEAK: ");
-            Serial.print(wdata.wind_peak);
-            Serial.print(" mph RT: ");
-            Serial.print(wdata.wind_rt);
-            Serial.print(" mph AVG: ");
-            Serial.print(wdata.wind_avg);
-            Serial.print(" mph DIR: ");
-            Serial.print(wdata.wind_dir_rt);
-            Serial.print(" DIR_AVG: ");
-            Serial.print(wdata.wind_dir_avg);
-            Serial.print(" deg RAIN: ");
-            Serial.print(wdata.rain_rate);
-            Serial.print(" EVENT: ");
-            Serial.print(wdata.rain_event);
-            Serial.print(" TOT: ");
-            Serial.print(wdata.rain_total);
-            Serial.println(" RTEST: ");
-            Serial.print(wdata.rain_test);
-            Serial.println("");
-#endif // TEST
-        }
-        // At the end, preset various response strings that the server should give out. This will happen once a second,
-        // whether we have any new data or not.
-        webserver_set_response();
-    }
+void tick_stats(uint32_t& done_us, uint32_t& jitter_us_max)
+{
+    done_us = tick_done_us;
+    jitter_us_max = tick_jitter_us_max;
+}
+
+void tick_jitter_reset()
+{
+    tick_jitter_us_max = 0;
 }
 
 void setup()
@@ -240,38 +266,46 @@ void setup()
     pinMode(39, INPUT);
     pinMode(32, INPUT);
 
-    // Read the initial rain values stored in the NVM
-    pref.begin("wd", true);
-    wdata.id = pref.getString("id", "");
-    wdata.tag = pref.getString("tag", "");
-    wdata.wind_calib = pref.getFloat("wind_calib", WIND_FACTOR_MPH);
-    wdata.rain_calib = pref.getFloat("rain_calib", RAIN_FACTOR_IN);
-    wdata.rain_event = pref.getUInt("rain_event", 0);
-    wdata.rain_event_max = pref.getUInt("rain_event_max", 24);
-    wdata.rain_event_cnt = pref.getUInt("rain_event_cnt", 0);
-    wdata.rain_total = pref.getUInt("rain_total", 0);
-    wdata.temp_c_calib = pref.getFloat("temp_c_calib", 0.0);
+    // Read the initial values stored in the NVM
+    setup_prefs();
+    if (wdata.vane_adc[0] == 0)
+        memcpy(wdata.vane_adc, vane_default_adc, sizeof(wdata.vane_adc));
 
-    pref.end();
+    wdata_semaphore = xSemaphoreCreateMutex();
+    wdata_publish();
 
     // Exclusive: one or the other (since they maybe share a digital SDA pin)
     using_bme280 = setup_bme280();
     if (!using_bme280)
         using_dht22  = setup_dht22();
+    uint8_t trim[TRACE_TRIM_LEN];
+    if (using_bme280 && bme280_trim_regs(trim))
+        calc.set_bme280_trim(trim);
 
     setup_wind_rain();
     setup_wifi();
     setup_webserver();
+    setup_history();
 
-    // Arduino loop is running on core 1 and priority 1
+    // The raw samples flow from the acquisition task on core 1 to the aggregation task on core 0, the core that also
+    // runs the WiFi stack. Arduino loop is running on core 1 and priority 1, so the acquisition runs above it.
     // https://techtutorialsx.com/2017/05/09/esp32-running-code-on-a-specific-core
+    raw_queue = xQueueCreate(RAW_QUEUE_LEN, sizeof(RawSample));
     xTaskCreatePinnedToCore(
-        vTask_read_sensors, // Task function
-        "task_sensors",     // String with name of the task
-        4096,               // Stack size in bytes
-        &wdata,             // Parameter passed as input to the task is the global weather data struct (not used)
+        vTask_aggregate,    // Task function
+        "task_aggregate",   // String with name of the task
+        6144,               // Stack size in bytes
+        NULL,               // Parameter passed as input to the task (not used)
         1,                  // Priority of the task
         NULL,               // Task handle
+        0);                 // Core where the task should run (protocol core)
+    xTaskCreatePinnedToCore(
+        vTask_acquire,      // Task function
+        "task_acquire",     // String with name of the task
+        3072,               // Stack size in bytes
+        NULL,               // Parameter passed as input to the task (not used)
+        2,                  // Priority of the task
+        NULL,               // Task handle
         1);                 // Core where the task should run (user program core)
 }
 
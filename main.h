@@ -1,5 +1,10 @@
 #include <Arduino.h>
 #include <Wire.h>
+#include "spsc.h"
+#include "pulsecount.h"
+#include "trace.h"
+#include "weatherdata.h"
+#include "histogram.h"
 
 // The version string shown in stats. Nothing depends on it and it is used only to confirm newly flashed firmware.
 #define FIRMWARE_VERSION "1.21"
@@ -16,124 +21,194 @@
 // To simply test the code, define TEST and use a hard-coded ip ending with "99"
 //#define TEST
 
-// Period, in seconds, of one hour; to count when to clear the rain_event
-#define PERIOD_1_HR  (60 * 60)
+// Period, in seconds, to write back the changed [NV] values into the non-volatile memory
+#define PREF_FLUSH_SEC  (5 * 60)
 
-// Period, in seconds, to read sensors; and to calculate wind stats
-#define PERIOD_5_SEC  5
+// The working copy of the weather data, owned by the aggregation task. Any other task that wants to modify it has to
+// hold the wdata lock, and readers should use wdata_snapshot() to get a consistent copy without blocking anyone.
+extern WeatherData wdata;
 
-// "The peak wind is a measurement of a burst or a gust of wind that one feels over a very short period of time.
-//  In the case of the peak wind, the very short period of time is usually three seconds."
-// http://prugarinc.com/weather-events/peak-wind-vs-maximum-wind-whats-the-difference
-#define PERIOD_PEAK_WIND_SEC  3
+// Pulse counter for the anemometer and the rain gauge, counted by the interrupt service routine. The ISR and the
+// acquisition task share no lock: see pulsecount.h.
+class Gauge
+{
+public:
+    void IRAM_ATTR isr();
+    uint32_t get_count() { return counter.get_count(); }
+    uint32_t get_and_clear_count() { return counter.get_and_clear_count(); }
+    void keep_times(bool enable) { counter.keep_times(enable); }
+    bool pop_time(uint32_t& t) { return counter.pop_time(t); } // Get the next tick timestamp, in microseconds
+    uint32_t get_time_drops() { return counter.get_time_drops(); }
 
-// Rain rate calculation is based on a 10-min sliding window
-#define PERIOD_RAIN_RATE  (60 * 10)
-#define RAIN_RATE_MUL      6 // Multiplication factor to publish rain rate, to bring it to "per hour" value
+private:
+    PulseCounter counter;
+};
 
-// This value deals with false rain positives when rain gauge tips due to various extraneous reasons
-// We are going to ignore any rain counts if the relative humidity is below this percentage since any real rain
-// would evaporate before reaching the ground. The reason this is not 100 (%) is to deal with possible corner cases.
-// XXX Quick summer rains can happen even when the humidity is quite low, so this check becomes at best questionable.
-#define CAN_RAIN_HUMIDITY_MIN  10
+extern Gauge anem;
+extern Gauge rain;
 
-#define WIND_FACTOR_MPH 1.492 // Relay tick to mph
-#define RAIN_FACTOR_IN  0.021 // Relay tick to inches of rain (initial best guess calibration value, rain_calib)
+// Decoded values of a history record, in the units the history keeps them
+struct HistoryState
+{
+    int32_t temp;       // Temperature, in 0.1 C
+    int32_t pressure;   // Pressure, in 0.1 hPa
+    int32_t humidity;   // Relative humidity, in 0.5 %
+};
 
-struct WeatherData
+// Position of a /history listing within the history ring buffer
+struct HistoryCursor
 {
-    // Variables marked with [NV] are held in the non-volatile memory using Preferences
-    // The station does not do anything with the id and the tag; clients should use them to identify and name a station
-    String id;          // [NV] Station identification string, held in the non-volatile memory
-    String tag;         // [NV] Station description or a tag, held in the non-volatile memory
-    float temp_c;       // Current temperature in "C"
-    float temp_f;       // Current temperature in "F"
-    float pressure;     // Current pressure in "hPa"
-    float humidity;     // Current relative humidity in "%"
-
-    float wind_calib;   // [NV] Wind calibration factor (ticks to mph)
-    float wind_peak;    // Wind peak maximum value over a 2-min sliding window
-    float wind_rt;      // Wind realtime (5-sec averages)
-    float wind_avg;     // Wind speed average over a 5-sec sliding window
-    int wind_dir_adc;   // Wind direction sensor ADC raw value
-    int wind_dir_rt;    // Wind instantaneous, real time direction measured once every 5 sec
-    int wind_dir_avg;   // Wind direction [0,360) averaged over a 2-min sliding window
-
-    // The station does not do anything with "rain_calib"; clients should use it as a single calbration reference
-    // when converting from the tip counters to inches of rain
-    float rain_calib;        // [NV] Rain calibration factor (ticks to in)
-    uint32_t rain_total;     // [NV] Rain total tip counter
-    uint32_t rain_event;     // [NV] Rain event tip counter
-    uint32_t rain_event_max; // [NV] The number of hours after which the station will reset the rain_event
-    uint32_t rain_event_cnt; // [NV] The number of hours since the last rain, to reset the rain_event
-    uint32_t rain_rate;      // Rain rate, sum of individual new rain tips over a 10-min sliding window times "per hour"
-    uint32_t rain_test;      // Rain test counter, unconditionally increments
-
-    // Misc logging and debug fields
-    uint32_t seconds;     // Uptime seconds counter (shown as "uptime" in web reports)
-    uint32_t anem_count;  // Anemometer count over the last 5 sec
-    uint32_t error;       // Bitfield where a non-zero bit indicates a particular error
-    float temp_c_calib;   // Correction to the temperature reading (some sensors run hot)
-#define ERROR_BME_INIT  0x00000001  // Error initializing BME sensor
-#define ERROR_BME_READ  0x00000002  // Error reading BME sensor value
-#define ERROR_DHT_READ  0x00000004  // Error reading DHT sensor value
-#define ERROR_SEM_1     0x00010000  // Semaphore timed out (location 1)
-#define ERROR_SEM_2     0x00020000  // Semaphore timed out (location 2)
+    uint32_t next_sec;  // Uptime seconds of the next record to list
+    uint32_t to_sec;    // Uptime seconds of the last record to list
+    uint32_t step;      // Listing step, in seconds
+    uint32_t seq;       // Sequence number of the record decoded into the state
+    HistoryState state; // Decoded values of that record
+    bool fine;          // Past the 1-min records, walking the 5-sec ones
+    bool started, done, header;
+    char line[80];      // Line of text being sent out
+    uint8_t line_len, line_pos;
 };
 
-extern WeatherData wdata;
+// Records kept in the history and the time they cover: the 5-sec ones, and the 1-min ones of the last 24 hours
+struct HistoryStats
+{
+    uint32_t count, size, sec;
+    uint32_t coarse_count, coarse_size, coarse_sec;
+};
 
-class Gauge
+// Processing stages that are timed with the CPU cycle counter and listed at /metrics
+enum Stage
 {
-public:
-    Gauge();
-    void IRAM_ATTR isr();
-    uint32_t get_count() { return count; }
-    uint32_t get_and_clear_count()
-    {
-        portENTER_CRITICAL(&lock);
-        uint32_t n = count; count = 0;
-        portEXIT_CRITICAL(&lock);
-        return n;
-    }
-    uint32_t get_and_clear_count2()
-    {
-        portENTER_CRITICAL(&lock);
-        uint32_t n = count2; count2 = 0;
-        portEXIT_CRITICAL(&lock);
-        return n;
-    }
+    STAGE_ACQUIRE,      // Reading the raw inputs of a tick
+    STAGE_VANE,         // Taking the wind vane reading
+    STAGE_BME280,       // Reading the BME280 data registers
+    STAGE_DHT22,        // Decoding the DHT22 frame
+    STAGE_PROCESS,      // Calculating the weather data from a raw sample
+    STAGE_PREF_FLUSH,   // Writing the changed preferences into the NVM
+    STAGE_PUBLISH,      // Publishing the snapshot, pushing it to the subscribers and adding it to the history
+    STAGE_ROOT,         // Answering / (root)
+    STAGE_JSON,         // Answering /json
+    STAGE_BIN,          // Answering /bin
+    STAGE_OTA_WRITE,    // Writing a sector of a firmware update
+    STAGE_COUNT
+};
 
-private:
-    uint32_t last_time; // Used to debounce the reed switch
-    volatile uint32_t count; // Counts the number of ISR ticks
-    volatile uint32_t count2; // Second counter used for wind peak
-    portMUX_TYPE lock;
+// Start of a timed stage. The cycle counters of the two cores are not in sync, so the core is kept as well, and the
+// timing is dropped if the task moved to the other core in between (the web server task is not pinned to a core).
+struct StageTimer
+{
+    uint32_t core;
+    uint32_t cycles;
 };
 
-extern Gauge anem;
-extern Gauge rain;
+static inline StageTimer stage_begin()
+{
+    StageTimer t;
+    t.core = xPortGetCoreID(); // Read the core first: if the task moves before reading the counter, it is dropped
+    t.cycles = ESP.getCycleCount();
+    return t;
+}
+
+// Position of a /metrics listing
+struct MetricsCursor
+{
+    uint8_t family, stage, row;
+    bool done, header, in_header;
+    Histogram hist;     // Copy of the histogram of the stage being listed
+    char line[96];      // Line of text being sent out
+    uint8_t line_len, line_pos;
+};
+
+// Heap and stack telemetry, sampled every 5 sec
+#define MEM_TASKS  5
+struct MemStats
+{
+    uint32_t heap_free;     // Free heap in bytes
+    uint32_t heap_largest;  // Largest free block of the heap in bytes
+    uint32_t heap_min;      // Minimum free heap since boot in bytes
+    uint32_t stack_free[MEM_TASKS]; // Stack high-water mark of each tracked task (unused bytes), see mem_task_name()
+    bool low;               // Low memory: the optional work is being shed
+    uint32_t low_count;     // Number of times the low memory mode was entered
+    uint32_t shed;          // Number of requests refused in the low memory mode
+};
+
+// Result of a firmware update; an image uploaded without its hash is activated, but reported as unverified
+enum OtaResult { OTA_NONE, OTA_UNVERIFIED, OTA_VERIFIED, OTA_BAD_HASH, OTA_FAILED };
+
+struct OtaStats
+{
+    uint32_t bytes;         // Bytes received
+    uint32_t start_ms;      // Start of the upload (millis)
+    uint32_t ms;            // Duration of the upload
+    uint32_t jitter_us_max; // Max deviation of the acquisition tick from its 1-sec cadence during the upload
+    OtaResult result;
+    char sha256[65];        // SHA-256 of the received image, in hex
+};
 
 // From main.cpp
-void pref_set(const char* name, uint32_t value);
-void pref_set(const char* name, float value);
-void pref_set(const char* name, String value);
+bool wdata_lock(TickType_t timeout);
+void wdata_unlock();
+void wdata_publish();
+uint32_t wdata_snapshot(WeatherData& wd);
+uint32_t wdata_generation();
+void pipeline_stats(uint32_t& depth_max, uint32_t& drops, uint32_t& latency_us, uint32_t& latency_us_max);
+void tick_stats(uint32_t& done_us, uint32_t& jitter_us_max);
+void tick_jitter_reset();
+
+// From prefs.cpp
+void setup_prefs();
+void pref_changed(const void *member);
+bool pref_flush();
+void pref_stats(uint32_t& writes, uint32_t& avoided, uint32_t& flush_us, uint32_t& flush_us_max, uint32_t& errors,
+                int32_t& last_err);
 
 // From webserver.cpp
-void webserver_set_response();
+void webserver_push_sample(const WeatherData& wd);
 void setup_wifi();
 void setup_webserver();
 void wifi_check_loop();
 
 // From bme280.cpp
 bool setup_bme280();
-void read_bme280();
+void bme280_start();
+bool read_bme280_raw(uint8_t data[8]);
+uint32_t bme280_recoveries();
+bool bme280_trim_regs(uint8_t regs[32]);
 
 // From dht22.cpp
 bool setup_dht22();
-void read_dht22();
+void dht22_start();
+bool read_dht22_raw(float& temperature, float& humidity);
+
+// From history.cpp
+void setup_history();
+void history_add(const WeatherData& wd, uint32_t rain_count);
+void history_cursor_init(HistoryCursor& cur, uint32_t from, uint32_t to, uint32_t step);
+size_t history_read(HistoryCursor& cur, char *buf, size_t size);
+void history_stats(HistoryStats& s);
+
+// From trace.cpp
+void trace_sample(const RawSample& r, const TraceSetup& setup);
+bool trace_start();
+void trace_stop();
+size_t trace_read(uint8_t *buf, size_t size);
+
+// From metrics.cpp
+void stage_end(Stage stage, const StageTimer& t);
+void metrics_cursor_init(MetricsCursor& cur);
+size_t metrics_read(MetricsCursor& cur, char *buf, size_t size);
+void mem_update();
+void mem_stats(MemStats& m);
+const char *mem_task_name(int i);
+bool mem_low();
+void mem_shed();
+
+// From ota.cpp
+bool ota_begin();
+bool ota_write(const uint8_t *data, size_t len);
+bool ota_end(const char *sha256_hex);
+void ota_stats(OtaStats& s);
 
 // From argent80422.cpp
 void setup_wind_rain();
 int read_wind_dir_adc();
-int wind_calc_dir(int adc);
@@ -0,0 +1,234 @@
+// Timing of the processing stages and their export at /metrics, and the memory telemetry
+// Each stage is timed with the CPU cycle counter and its durations are collected into a fixed-bucket histogram, which
+// is listed in the Prometheus text format together with its p50, p99 and max. The listing is generated one line at a
+// time into the cursor's line buffer, so a scrape needs no buffer for the whole text and no heap allocations.
+#include "main.h"
+#include "textwriter.h"
+#include <esp_heap_caps.h>
+
+// Low memory: below this largest free block the station sheds the optional work (the HTML pages, the streaming
+// responses, extra event subscribers) so that the weather data can still be served. It leaves the degraded mode only
+// once the block is back above the higher mark, so that it does not flip on every check.
+#define MEM_LOW_BLOCK   (16 * 1024)
+#define MEM_OK_BLOCK    (24 * 1024)
+
+static const char *stage_names[STAGE_COUNT] = {
+    "acquire", "vane_read", "bme280_read", "dht22_read", "process", "pref_flush", "publish",
+    "http_root", "http_json", "http_bin", "ota_write" };
+
+static Histogram stage_hist[STAGE_COUNT];
+static uint32_t stage_migrations = 0;   // Samples dropped because the task moved to the other core while being timed
+static portMUX_TYPE metrics_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void stage_end(Stage stage, const StageTimer& t)
+{
+    uint32_t cycles = ESP.getCycleCount() - t.cycles;
+    if (uint32_t(xPortGetCoreID()) != t.core)
+    {
+        stage_migrations++;
+        return;
+    }
+    static uint32_t cpu_mhz = 0;
+    if (!cpu_mhz)
+        cpu_mhz = getCpuFrequencyMhz();
+
+    portENTER_CRITICAL(&metrics_lock);
+    stage_hist[stage].add(cycles / cpu_mhz);
+    portEXIT_CRITICAL(&metrics_lock);
+}
+
+// Metric families, in the order they are listed
+enum { FAMILY_HIST, FAMILY_P50, FAMILY_P99, FAMILY_MAX, FAMILY_MIGRATIONS, FAMILY_COUNT };
+
+static const char *family_header[FAMILY_COUNT] = {
+    "# HELP ws_stage_duration_us Duration of a processing stage in microseconds\n"
+    "# TYPE ws_stage_duration_us histogram\n",
+    "# HELP ws_stage_p50_us Median duration of a processing stage in microseconds (bucket upper bound)\n"
+    "# TYPE ws_stage_p50_us gauge\n",
+    "# HELP ws_stage_p99_us 99th percentile duration of a processing stage in microseconds (bucket upper bound)\n"
+    "# TYPE ws_stage_p99_us gauge\n",
+    "# HELP ws_stage_max_us Longest duration of a processing stage in microseconds\n"
+    "# TYPE ws_stage_max_us gauge\n",
+    "# HELP ws_stage_migrations_total Stage timings dropped because the task moved to the other core\n"
+    "# TYPE ws_stage_migrations_total counter\n" };
+
+static const char *family_name[FAMILY_COUNT] = {
+    "ws_stage_duration_us", "ws_stage_p50_us", "ws_stage_p99_us", "ws_stage_max_us", "ws_stage_migrations_total" };
+
+void metrics_cursor_init(MetricsCursor& cur)
+{
+    cur.family = 0;
+    cur.stage = 0;
+    cur.row = 0;
+    cur.done = false;
+    cur.header = cur.in_header = false;
+    cur.line_len = cur.line_pos = 0;
+}
+
+// Render the next line of the listing into the cursor's line buffer; returns false at the end of the listing.
+// The family headers are longer than the line buffer, so they are sent from their constant strings instead.
+static bool metrics_next(MetricsCursor& cur)
+{
+    if (cur.family == FAMILY_COUNT)
+    {
+        cur.done = true;
+        return false;
+    }
+
+    cur.line_pos = 0;
+    if ((cur.stage == 0) && (cur.row == 0) && !cur.header)
+    {
+        cur.line_len = strlen(family_header[cur.family]);
+        cur.header = cur.in_header = true;
+        return true;
+    }
+
+    // Take a copy of the stage's histogram to list its rows from
+    if (cur.row == 0)
+    {
+        portENTER_CRITICAL(&metrics_lock);
+        cur.hist = stage_hist[cur.stage];
+        portEXIT_CRITICAL(&metrics_lock);
+    }
+
+    TextWriter w(cur.line, sizeof(cur.line));
+    cur.in_header = false;
+    w.str(family_name[cur.family]);
+    uint32_t rows = 1;
+    if (cur.family == FAMILY_MIGRATIONS)
+    {
+        w.str(" ").u32(stage_migrations);
+        cur.stage = STAGE_COUNT - 1; // A single value, not one per stage
+    }
+    else if (cur.family == FAMILY_HIST)
+    {
+        // Cumulative bucket counts, then the sum and the count
+        rows = HIST_BUCKETS + 2;
+        if (cur.row < HIST_BUCKETS)
+        {
+            uint32_t n = 0;
+            for (int i = 0; i <= cur.row; i++)
+                n += cur.hist.get_bucket(i);
+            w.str("_bucket{stage=\"").str(stage_names[cur.stage]).str("\",le=\"");
+            if (Histogram::is_inf(cur.row))
+                w.str("+Inf");
+            else
+                w.u32(Histogram::le(cur.row));
+            w.str("\"} ").u32(n);
+        }
+        else if (cur.row == HIST_BUCKETS)
+        {
+            uint64_t sum = cur.hist.get_sum();
+            w.str("_sum{stage=\"").str(stage_names[cur.stage]).str("\"} ");
+            if (sum >= 1000000000)
+            {
+                // Too long for u32(): print the billions, then the rest with its leading zeros
+                char tmp[10];
+                uint32_t rest = uint32_t(sum % 1000000000);
+                for (int i = 8; i >= 0; i--, rest /= 10)
+                    tmp[i] = '0' + (rest % 10);
+                w.u32(uint32_t(sum / 1000000000)).put(tmp, 9);
+            }
+            else
+                w.u32(uint32_t(sum));
+        }
+        else
+            w.str("_count{stage=\"").str(stage_names[cur.stage]).str("\"} ").u32(cur.hist.get_count());
+    }
+    else
+    {
+        uint32_t v = (cur.family == FAMILY_P50) ? cur.hist.percentile(50)
+                   : (cur.family == FAMILY_P99) ? cur.hist.percentile(99) : cur.hist.get_max();
+        w.str("{stage=\"").str(stage_names[cur.stage]).str("\"} ").u32(v);
+    }
+    w.str("\n");
+    cur.line_len = w.length();
+
+    // Advance to the next row, stage and family
+    if (++cur.row == rows)
+    {
+        cur.row = 0;
+        if (++cur.stage == STAGE_COUNT)
+        {
+            cur.stage = 0;
+            cur.family++;
+            cur.header = false;
+        }
+    }
+    return true;
+}
+
+// Fill the buffer with the next part of the listing; returns the number of bytes, 0 at the end
+size_t metrics_read(MetricsCursor& cur, char *buf, size_t size)
+{
+    size_t len = 0;
+    while (len < size)
+    {
+        if (cur.line_pos < cur.line_len)
+        {
+            size_t n = cur.line_len - cur.line_pos;
+            n = (n < size - len) ? n : size - len;
+            memcpy(buf + len, (cur.in_header ? family_header[cur.family] : cur.line) + cur.line_pos, n);
+            cur.line_pos += n;
+            len += n;
+        }
+        else if (cur.done || !metrics_next(cur))
+            break;
+    }
+    return len;
+}
+
+// Tasks whose stack high-water marks are tracked, looked up by their names
+static const char *mem_task_names[MEM_TASKS] = {
+    "task_acquire", "task_aggregate", "task_vane", "async_tcp", "loopTask" };
+static TaskHandle_t mem_tasks[MEM_TASKS];
+static MemStats mem;
+
+// Sample the heap and the stacks, and enter or leave the low memory mode; called by the aggregation task every 5 sec
+void mem_update()
+{
+    mem.heap_free = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    mem.heap_largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    mem.heap_min = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    for (int i = 0; i < MEM_TASKS; i++)
+    {
+        if (!mem_tasks[i])
+            mem_tasks[i] = xTaskGetHandle(mem_task_names[i]);
+        if (mem_tasks[i])
+            mem.stack_free[i] = uxTaskGetStackHighWaterMark(mem_tasks[i]); // In bytes on the ESP32
+    }
+
+    if (!mem.low && (mem.heap_largest < MEM_LOW_BLOCK))
+    {
+        mem.low = true;
+        mem.low_count++;
+        Serial.printf("Low memory: largest free block %u, free heap %u\n", mem.heap_largest, mem.heap_free);
+    }
+    else if (mem.low && (mem.heap_largest > MEM_OK_BLOCK))
+    {
+        mem.low = false;
+        Serial.printf("Memory recovered: largest free block %u\n", mem.heap_largest);
+    }
+}
+
+// The values are only written by the aggregation task; a reader may see a mix of two updates, which is fine for stats
+void mem_stats(MemStats& m)
+{
+    m = mem;
+}
+
+const char *mem_task_name(int i)
+{
+    return mem_task_names[i];
+}
+
+bool mem_low()
+{
+    return mem.low;
+}
+
+// Count a request that was refused in the low memory mode
+void mem_shed()
+{
+    mem.shed++;
+}
@@ -0,0 +1,139 @@
+// Firmware update streamed in through the /flash upload
+// The upload arrives in TCP chunks of any size. They are collected into a sector buffer and handed to the flash only a
+// whole 4 KB sector at a time, so that each write is a single erase and program. While the flash is being erased or
+// written the caches are off and the other core stalls as well, so a sector is written only when the next 1-sec
+// acquisition tick is far enough away, and the web server task yields after each one. The image is hashed with
+// SHA-256 as it streams; if the client sent the expected hash (/flash?sha256=<hex>), an image that does not match is
+// not activated. Without the hash the image is activated all the same, but the upload is reported as unverified.
+#include "main.h"
+#include <Update.h>
+#include <mbedtls/sha256.h>
+
+#define OTA_SECTOR          4096
+#define OTA_TICK_GUARD_US   100000  // Do not start a sector write closer than this to the next tick (erase + program)
+#define OTA_WAIT_MAX        200     // Give up waiting for a clear window after this many ms (the tick is late)
+
+// mbedtls 2.x has the status returning hash functions under the "_ret" names
+#if MBEDTLS_VERSION_NUMBER < 0x03000000
+#define mbedtls_sha256_starts   mbedtls_sha256_starts_ret
+#define mbedtls_sha256_update   mbedtls_sha256_update_ret
+#define mbedtls_sha256_finish   mbedtls_sha256_finish_ret
+#endif
+
+static uint8_t ota_buf[OTA_SECTOR];     // Sector being collected, only used by the web server task
+static size_t ota_len;                  // Bytes in the sector buffer
+static mbedtls_sha256_context ota_sha;
+static bool ota_active = false;         // An upload is in progress
+static OtaStats ota;                    // Stats of the current or the last upload
+
+// Wait until the flash can be written without delaying the next acquisition tick
+static void ota_wait_clear()
+{
+    for (int ms = 0; ms < OTA_WAIT_MAX; ms++)
+    {
+        uint32_t done_us, jitter_us_max;
+        tick_stats(done_us, jitter_us_max);
+        if (micros() - done_us < 1000000 - OTA_TICK_GUARD_US)
+            return;
+        vTaskDelay(1);
+    }
+}
+
+static bool ota_flush()
+{
+    if (!ota_len)
+        return true;
+    ota_wait_clear();
+    StageTimer t = stage_begin();
+    bool ok = Update.write(ota_buf, ota_len) == ota_len;
+    stage_end(STAGE_OTA_WRITE, t);
+    ota_len = 0;
+    vTaskDelay(1); // Let the other tasks on this core run between the sectors
+    if (!ok)
+        Update.printError(Serial);
+    return ok;
+}
+
+// Start a new upload, abandoning any unfinished one
+bool ota_begin()
+{
+    if (ota_active)
+        Update.abort();
+    ota_len = 0;
+    ota = OtaStats();
+    ota.start_ms = millis();
+    mbedtls_sha256_init(&ota_sha);
+    mbedtls_sha256_starts(&ota_sha, 0);
+    tick_jitter_reset();
+    ota_active = Update.begin(UPDATE_SIZE_UNKNOWN); // Start with max available size
+    if (!ota_active)
+        Update.printError(Serial);
+    return ota_active;
+}
+
+// Add the next chunk of the upload
+bool ota_write(const uint8_t *data, size_t len)
+{
+    if (!ota_active || Update.hasError())
+        return false;
+    mbedtls_sha256_update(&ota_sha, data, len);
+    ota.bytes += len;
+    while (len)
+    {
+        size_t n = (len < OTA_SECTOR - ota_len) ? len : OTA_SECTOR - ota_len;
+        memcpy(ota_buf + ota_len, data, n);
+        ota_len += n;
+        data += n;
+        len -= n;
+        if ((ota_len == OTA_SECTOR) && !ota_flush())
+            return false;
+    }
+    return true;
+}
+
+// Finish the upload: write the last partial sector and verify the hash, if one is given as 64 hex digits.
+// Returns true if the new image is valid and will boot on the next restart.
+bool ota_end(const char *sha256_hex)
+{
+    if (!ota_active)
+        return false;
+    ota_active = false;
+    bool ok = ota_flush();
+
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&ota_sha, digest);
+    mbedtls_sha256_free(&ota_sha);
+    for (int i = 0; i < 32; i++)
+    {
+        ota.sha256[i * 2] = "0123456789abcdef"[digest[i] >> 4];
+        ota.sha256[i * 2 + 1] = "0123456789abcdef"[digest[i] & 0xF];
+    }
+    ota.sha256[64] = 0;
+    if (sha256_hex && *sha256_hex && (strcasecmp(sha256_hex, ota.sha256) != 0))
+    {
+        Serial.printf("OTA: SHA-256 mismatch, got %s\n", ota.sha256);
+        ota.result = OTA_BAD_HASH;
+        Update.abort();
+        ok = false;
+    }
+    else if (!ok || !Update.end(true)) // true to set the size to the current progress
+    {
+        Update.printError(Serial);
+        ota.result = OTA_FAILED;
+        ok = false;
+    }
+    else
+        ota.result = (sha256_hex && *sha256_hex) ? OTA_VERIFIED : OTA_UNVERIFIED;
+
+    uint32_t done_us;
+    ota.ms = millis() - ota.start_ms;
+    tick_stats(done_us, ota.jitter_us_max);
+    Serial.printf("OTA: %u bytes in %u ms (%u B/s), max tick jitter %u us, sha256 %s\n", ota.bytes, ota.ms,
+                  ota.ms ? uint32_t(uint64_t(ota.bytes) * 1000 / ota.ms) : 0, ota.jitter_us_max, ota.sha256);
+    return ok;
+}
+
+void ota_stats(OtaStats& s)
+{
+    s = ota;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <stdint.h>
+
+// Compile-time perfect hashing of a small fixed table of keys, each with a "name" member
+// This header has no dependencies on Arduino, so the table can be checked off-device.
+//
+// The name hash is FNV-1a with a seed in place of its offset basis, and the slot of a name is the top bits of the
+// hash. ph_seed() searches, at compile time, for the first seed that puts every key of the table into its own slot,
+// and ph_slot_key() gives the key in each slot, so that a lookup is one hash, one table read and one string compare.
+// Everything is written as single-return recursive functions to be constexpr in C++11.
+
+#define PH_NONE  0xFF   // Slot with no key
+
+constexpr uint32_t ph_hash(const char *s, uint32_t h)
+{
+    return *s ? ph_hash(s + 1, (h ^ uint8_t(*s)) * 16777619u) : h;
+}
+
+constexpr uint32_t ph_slot(const char *s, uint32_t seed, int bits)
+{
+    return ph_hash(s, seed) >> (32 - bits);
+}
+
+// True if no two keys from i on share a slot
+template<class K>
+constexpr bool ph_unique(const K *keys, uint32_t n, uint32_t seed, int bits, uint32_t i = 0, uint32_t j = 1)
+{
+    return (i + 1 >= n) ? true
+         : (j == n) ? ph_unique(keys, n, seed, bits, i + 1, i + 2)
+         : (ph_slot(keys[i].name, seed, bits) == ph_slot(keys[j].name, seed, bits)) ? false
+         : ph_unique(keys, n, seed, bits, i, j + 1);
+}
+
+// First seed from the FNV offset basis on that makes the table collision-free; gives up after tries seeds
+template<class K>
+constexpr uint32_t ph_seed(const K *keys, uint32_t n, int bits, uint32_t seed = 2166136261u, int tries = 256)
+{
+    return ph_unique(keys, n, seed, bits) ? seed
+         : (tries == 0) ? 0
+         : ph_seed(keys, n, bits, seed + 1, tries - 1);
+}
+
+// Index of the key in the given slot, or PH_NONE
+template<class K>
+constexpr uint8_t ph_slot_key(const K *keys, uint32_t n, uint32_t seed, int bits, uint32_t slot, uint32_t i = 0)
+{
+    return (i == n) ? PH_NONE
+         : (ph_slot(keys[i].name, seed, bits) == slot) ? uint8_t(i)
+         : ph_slot_key(keys, n, seed, bits, slot, i + 1);
+}
@@ -0,0 +1,187 @@
+// Non-volatile preferences: a typed registry binding each [NV] WeatherData member to its NVS key
+// The "wd" namespace is opened once at boot and the handle is kept open. All values are loaded with that single open,
+// and written back through it by a write-back cache: pref_changed() only marks a member dirty, and pref_flush() writes
+// all dirty members and commits them at once. This way a rain storm updating the rain counters every 5 sec does not
+// block the aggregation task on flash writes nor wear out the NVS partition. The cost is that a power loss can lose the
+// updates since the last flush, at most PREF_FLUSH_SEC worth of them.
+// The values are stored the same way the Arduino Preferences library stores them (u32, float as a 4-byte blob, string),
+// so the settings from older firmware are kept. Arrays are stored as blobs and are left as they are if not in the NVM.
+#include "main.h"
+#include <nvs.h>
+
+#define PREF_FLUSH_UPDATES  36        // Flush sooner if this many updates are pending (1 min of steady rain)
+
+enum PrefType { PREF_U32, PREF_FLOAT, PREF_STR, PREF_BLOB };
+
+struct PrefKey
+{
+    const char *name;   // NVS key name (15 characters max)
+    PrefType type;
+    void *value;        // Bound WeatherData member
+    uint32_t def_u32;   // Default value if the key is not in the NVM yet (strings default to empty)
+    float def_float;
+    size_t size;        // Size of a blob
+    bool dirty;         // The value has not been written to the NVM yet
+};
+
+static PrefKey pref_keys[] = {
+    { "id",             PREF_STR,   wdata.id },
+    { "tag",            PREF_STR,   wdata.tag },
+    { "wind_calib",     PREF_FLOAT, &wdata.wind_calib, 0, WIND_FACTOR_MPH },
+    { "rain_calib",     PREF_FLOAT, &wdata.rain_calib, 0, RAIN_FACTOR_IN },
+    { "rain_event",     PREF_U32,   &wdata.rain_event, 0 },
+    { "rain_event_max", PREF_U32,   &wdata.rain_event_max, 24 },
+    { "rain_event_cnt", PREF_U32,   &wdata.rain_event_cnt, 0 },
+    { "rain_total",     PREF_U32,   &wdata.rain_total, 0 },
+    { "temp_c_calib",   PREF_FLOAT, &wdata.temp_c_calib, 0, 0.0 },
+    { "vane_adc",       PREF_BLOB,  wdata.vane_adc, 0, 0.0, sizeof(wdata.vane_adc) },
+};
+#define PREF_KEYS  (sizeof(pref_keys) / sizeof(pref_keys[0]))
+static_assert(PREF_KEYS <= 32, "pref_flush() keeps the written keys in a 32-bit mask");
+
+static nvs_handle pref_handle = 0;    // Persistent handle to the "wd" namespace (0 if it could not be opened)
+static uint32_t pref_pending = 0;     // Number of updates since the last flush
+static uint32_t pref_writes = 0;      // Number of values written to the NVM (for stats)
+static uint32_t pref_avoided = 0;     // Number of updates coalesced in the cache instead of being written (for stats)
+static uint32_t pref_flush_us = 0;    // Duration of the last flush in microseconds (for stats)
+static uint32_t pref_flush_us_max = 0;// Maximum duration of a flush in microseconds (for stats)
+static uint32_t pref_errors = 0;      // Number of flushes that failed to write or commit a value (for stats)
+static int32_t pref_last_err = 0;     // ESP-IDF error code of the last failure (for stats)
+
+// Open the NVS namespace and load all registered members of the weather data, using defaults for the missing ones
+void setup_prefs()
+{
+    esp_err_t err = nvs_open("wd", NVS_READWRITE, &pref_handle);
+    if (err != ESP_OK)
+    {
+        Serial.printf("NVS open failed: %d\n", err);
+        pref_handle = 0;
+    }
+
+    for (uint32_t i = 0; i < PREF_KEYS; i++)
+    {
+        PrefKey& k = pref_keys[i];
+        if (k.type == PREF_U32)
+        {
+            if (!pref_handle || (nvs_get_u32(pref_handle, k.name, (uint32_t *)k.value) != ESP_OK))
+                *(uint32_t *)k.value = k.def_u32;
+        }
+        else if (k.type == PREF_FLOAT)
+        {
+            size_t len = sizeof(float);
+            if (!pref_handle || (nvs_get_blob(pref_handle, k.name, k.value, &len) != ESP_OK) || (len != sizeof(float)))
+                *(float *)k.value = k.def_float;
+        }
+        else if (k.type == PREF_BLOB)
+        {
+            size_t len = k.size;
+            if (pref_handle)
+                nvs_get_blob(pref_handle, k.name, k.value, &len);
+        }
+        else
+        {
+            size_t len = WD_STR_MAX + 1;
+            if (!pref_handle || (nvs_get_str(pref_handle, k.name, (char *)k.value, &len) != ESP_OK))
+                *(char *)k.value = 0;
+        }
+    }
+}
+
+static void pref_mark(PrefKey& k)
+{
+    if (k.dirty)
+        pref_avoided++;
+    k.dirty = true;
+    if (++pref_pending >= PREF_FLUSH_UPDATES)
+        pref_flush();
+}
+
+// Mark a registered member of the weather data as changed, so that it will be written to the NVM with the next flush
+// The caller has to hold the wdata lock, which also serializes the access to the registry
+void pref_changed(const void *member)
+{
+    for (uint32_t i = 0; i < PREF_KEYS; i++)
+    {
+        if (pref_keys[i].value == member)
+            pref_mark(pref_keys[i]);
+    }
+}
+
+// Write all changed members to the NVM and commit them at once; the caller has to hold the wdata lock
+// A member stays dirty until it was both written and committed, so a failed write (the NVS partition is full, the
+// flash is worn out) is retried with the next flush instead of being lost. Returns false if anything is still not
+// saved.
+bool pref_flush()
+{
+    if (pref_pending == 0)
+        return true;
+    if (!pref_handle)
+        return false;
+
+    StageTimer t = stage_begin();
+    uint32_t start = micros();
+    esp_err_t err = ESP_OK;
+    uint32_t written = 0; // Bit mask of the keys written in this flush
+    for (uint32_t i = 0; i < PREF_KEYS; i++)
+    {
+        PrefKey& k = pref_keys[i];
+        if (!k.dirty)
+            continue;
+        esp_err_t e;
+        if (k.type == PREF_U32)
+            e = nvs_set_u32(pref_handle, k.name, *(uint32_t *)k.value);
+        else if (k.type == PREF_FLOAT)
+            e = nvs_set_blob(pref_handle, k.name, k.value, sizeof(float));
+        else if (k.type == PREF_BLOB)
+            e = nvs_set_blob(pref_handle, k.name, k.value, k.size);
+        else
+            e = nvs_set_str(pref_handle, k.name, (const char *)k.value);
+        if (e == ESP_OK)
+            written |= 1u << i;
+        else
+            err = e;
+    }
+    esp_err_t e = nvs_commit(pref_handle);
+    if (e != ESP_OK)
+    {
+        err = e;
+        written = 0;
+    }
+
+    // Keep the failed ones dirty; they count as pending again, so that they are retried with the next scheduled flush
+    // rather than on every update
+    pref_pending = 0;
+    for (uint32_t i = 0; i < PREF_KEYS; i++)
+    {
+        PrefKey& k = pref_keys[i];
+        if (written & (1u << i))
+        {
+            k.dirty = false;
+            pref_writes++;
+        }
+        else if (k.dirty)
+            pref_pending++;
+    }
+    if (err != ESP_OK)
+    {
+        pref_errors++;
+        pref_last_err = err;
+    }
+
+    pref_flush_us = micros() - start;
+    if (pref_flush_us > pref_flush_us_max)
+        pref_flush_us_max = pref_flush_us;
+    stage_end(STAGE_PREF_FLUSH, t);
+    return err == ESP_OK;
+}
+
+void pref_stats(uint32_t& writes, uint32_t& avoided, uint32_t& flush_us, uint32_t& flush_us_max, uint32_t& errors,
+                int32_t& last_err)
+{
+    errors = pref_errors;
+    last_err = pref_last_err;
+    writes = pref_writes;
+    avoided = pref_avoided;
+    flush_us = pref_flush_us;
+    flush_us_max = pref_flush_us_max;
+}
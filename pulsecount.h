@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include "spsc.h"
+
+// Pulse counting of the anemometer and the rain gauge reed switches
+// This header has no dependencies on Arduino, so the counting can be built and checked off-device.
+//
+// edge() is called by the interrupt for every rising edge. A reed switch bounces for up to a millisecond when it
+// closes, so an edge closer than PULSE_DEBOUNCE_US to the last counted one is ignored. Each pulse is timestamped
+// exactly. The PCNT peripheral is not used: its glitch filter is at most 1023 APB cycles (~12.8 us), far shorter than
+// the bounce, and it does not tell when each pulse happened, which the gust and the rain rate need.
+//
+// Only the interrupt calls edge(), and only the acquisition task reads the counter, so no lock is needed: the count is
+// an atomic that the reader exchanges with 0, and the timestamps go through a single-producer single-consumer ring.
+
+#define PULSE_DEBOUNCE_US  1000 // A reed switch would have to open and close 1000 times per second to reach this rate
+
+class PulseCounter
+{
+public:
+    PulseCounter() : count(0), last_edge(0), times_enabled(false) {}
+
+    // A rising edge at the given time; returns true if it was counted
+    inline __attribute__((always_inline)) bool edge(uint32_t t_us)
+    {
+        if (t_us - last_edge <= PULSE_DEBOUNCE_US)
+            return false;
+        last_edge = t_us;
+        count.fetch_add(1, std::memory_order_relaxed);
+        if (times_enabled)
+            times.push(t_us);
+        return true;
+    }
+
+    uint32_t get_count() const { return count.load(std::memory_order_relaxed); }
+    uint32_t get_and_clear_count() { return count.exchange(0, std::memory_order_relaxed); }
+
+    void keep_times(bool enable) { times_enabled = enable; }
+    bool pop_time(uint32_t& t) { return times.pop(t); } // Get the next pulse timestamp, in microseconds
+    uint32_t get_time_drops() { return times.get_drops(); }
+
+private:
+    std::atomic<uint32_t> count; // Pulses counted since the last get_and_clear_count()
+    uint32_t last_edge;          // Time of the last counted edge, to debounce the reed switch; only the ISR uses it
+    bool times_enabled;          // Keep the timestamps of the pulses
+    SpscRing<uint32_t, 128> times; // Timestamps of the pulses, from the interrupt to the acquisition task
+};
@@ -0,0 +1,45 @@
+#pragma once
+#include <stdint.h>
+
+// Instantaneous rain rate estimated from the time interval between the rain gauge tips
+// A new tip updates the rate right away, instead of waiting for it to show up in a sliding window sum. In between the
+// tips, the rate can not be higher than if the next tip happened right now, so when the rain eases off or stops the
+// rate decays with the time since the last tip, and it drops to zero once no tip was seen for the timeout period.
+// Timestamps are in microseconds and may wrap around; the timeout has to be shorter than the wrap period.
+class RainRate
+{
+public:
+    RainRate(uint32_t timeout_us) : timeout_us(timeout_us), last_us(0), interval_us(0), have_last(false) {}
+
+    void tip(uint32_t t_us)
+    {
+        if (have_last)
+            interval_us = t_us - last_us;
+        last_us = t_us;
+        have_last = true;
+    }
+
+    // Returns the rain rate, in tips per hour, at the given time
+    float rate(uint32_t now_us)
+    {
+        if (!have_last)
+            return 0;
+        uint32_t since_us = now_us - last_us;
+        if (since_us > timeout_us)
+        {
+            have_last = false; // The rain has stopped; the next tip starts a new series
+            interval_us = 0;
+            return 0;
+        }
+        if (interval_us == 0)
+            return 0; // A single tip does not tell us the rate yet
+        uint32_t dt = (since_us > interval_us) ? since_us : interval_us;
+        return 3600e6f / dt;
+    }
+
+private:
+    uint32_t timeout_us;  // Time without a tip after which the rate drops to zero
+    uint32_t last_us;     // Time of the last tip
+    uint32_t interval_us; // Interval between the last two tips (0 if unknown)
+    bool have_last;
+};
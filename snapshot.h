@@ -0,0 +1,52 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+// Sequence lock used to publish immutable snapshots of a plain data structure from a single writer to any number of
+// readers. The writer never waits and the readers never block the writer: a reader simply copies the data and retries
+// if the sequence number shows that the writer was in the middle of an update, so it can never see a torn snapshot.
+// Multiple writers must serialize among themselves before calling write().
+// A reader spins while a write is in progress, so the writer must not be preempted by a reader in the middle of a
+// write: a higher priority reader on the same core would spin forever. On FreeRTOS, write inside a critical section;
+// it only takes as long as copying T, and a reader on the other core then waits for that at most.
+template<class T>
+class SeqLock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock data has to be copyable with memcpy");
+
+public:
+    SeqLock() : seq(0), data() {}
+
+    void write(const T& value)
+    {
+        uint32_t s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed); // Odd sequence number: update in progress
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(&data, &value, sizeof(T));
+        seq.store(s + 2, std::memory_order_release); // Even sequence number: the data is consistent
+    }
+
+    // Returns the generation of the last published snapshot, without copying it
+    uint32_t generation() const { return seq.load(std::memory_order_acquire) / 2; }
+
+    // Copies the last published snapshot and returns its generation (the number of writes so far)
+    uint32_t read(T& value) const
+    {
+        for (;;)
+        {
+            uint32_t s1 = seq.load(std::memory_order_acquire);
+            if (s1 & 1)
+                continue; // The writer is in the middle of an update
+            memcpy(&value, &data, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq.load(std::memory_order_relaxed) == s1)
+                return s1 / 2;
+        }
+    }
+
+private:
+    std::atomic<uint32_t> seq;
+    T data;
+};
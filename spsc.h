@@ -0,0 +1,50 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+
+// Lock-free single-producer/single-consumer ring buffer. The producer may be an interrupt service routine and the
+// consumer a task (or the other way around); neither side ever waits for the other. N has to be a power of 2.
+// The producer side is forced inline so that it ends up in the IRAM together with the ISR calling it.
+template<class T, uint32_t N>
+class SpscRing
+{
+    static_assert((N & (N - 1)) == 0, "SpscRing size has to be a power of 2");
+
+public:
+    SpscRing() : head(0), tail(0), drops(0) {}
+
+    // Producer side: returns false, dropping the value, if the ring is full
+    inline __attribute__((always_inline)) bool push(const T& value)
+    {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == N)
+        {
+            drops++;
+            return false;
+        }
+        buf[h & (N - 1)] = value;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: returns false if the ring is empty
+    bool pop(T& value)
+    {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+            return false;
+        value = buf[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint32_t space() const { return N - size(); }
+    uint32_t size() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+    uint32_t get_drops() const { return drops; }
+
+private:
+    std::atomic<uint32_t> head; // Written only by the producer
+    std::atomic<uint32_t> tail; // Written only by the consumer
+    volatile uint32_t drops;    // Number of values dropped because the ring was full
+    T buf[N];
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include <stdio.h>
+#include <math.h>
+#include <string>
+
+// Minimal test harness: each test_*.cpp is its own executable, registered with ctest, that runs its TEST functions in
+// order and exits with the number of failed checks
+
+struct TestCase
+{
+    const char *name;
+    void (*fn)();
+    TestCase *next;
+};
+
+static TestCase *test_first = NULL, **test_last = &test_first;
+static int test_failures = 0;
+
+struct TestRegister
+{
+    TestRegister(TestCase *t) { *test_last = t; test_last = &t->next; }
+};
+
+#define TEST(name) \
+    static void test_##name(); \
+    static TestCase test_case_##name = { #name, test_##name, NULL }; \
+    static TestRegister test_reg_##name(&test_case_##name); \
+    static void test_##name()
+
+#define CHECK(cond) \
+    do { if (!(cond)) { test_failures++; printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); } } while (0)
+
+#define CHECK_EQ(a, b) \
+    do { auto va = (a); auto vb = (b); if (!(va == vb)) { test_failures++; \
+        printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, \
+               (long long)va, (long long)vb); } } while (0)
+
+#define CHECK_NEAR(a, b, eps) \
+    do { double va = (a), vb = (b); if (!(fabs(va - vb) <= (eps))) { test_failures++; \
+        printf("%s:%d: CHECK_NEAR(%s, %s) failed: %g != %g\n", __FILE__, __LINE__, #a, #b, va, vb); } } while (0)
+
+#define CHECK_STR(a, b) \
+    do { std::string va = (a), vb = (b); if (va != vb) { test_failures++; \
+        printf("%s:%d: CHECK_STR(%s, %s) failed:\n  \"%s\"\n  \"%s\"\n", __FILE__, __LINE__, #a, #b, \
+               va.c_str(), vb.c_str()); } } while (0)
+
+int main()
+{
+    for (TestCase *t = test_first; t; t = t->next)
+    {
+        int before = test_failures;
+        t->fn();
+        printf("%s %s\n", (test_failures == before) ? "ok  " : "FAIL", t->name);
+    }
+    return test_failures ? 1 : 0;
+}
@@ -0,0 +1,55 @@
+#include "main.h"
+#include "check.h"
+
+// BME280 register image on the host I2C bus
+static uint8_t regs[256];
+
+static void bme280_image()
+{
+    memset(regs, 0, sizeof(regs));
+    regs[0xD0] = 0x60; // Chip ID
+    for (int i = 0; i < 24; i++)
+        regs[0x88 + i] = uint8_t(i + 1);
+    regs[0xA1] = 25;
+    for (int i = 0; i < 7; i++)
+        regs[0xE1 + i] = uint8_t(26 + i);
+    const uint8_t data[8] = { 0x65, 0x5A, 0xC0, 0x7E, 0xED, 0x00, 0x75, 0x30 };
+    memcpy(regs + 0xF7, data, sizeof(data));
+    host_wire_device(0x76, regs);
+}
+
+TEST(short_trim_read_fails_the_set_up)
+{
+    bme280_image();
+    wdata.error = 0;
+    host_wire_short(2, 6); // The chip ID, then only 6 of the 24 trim bytes at 0x88
+    CHECK(!setup_bme280());
+    CHECK(wdata.error & ERROR_BME_INIT);
+    uint8_t trim[32];
+    CHECK(!bme280_trim_regs(trim));
+}
+
+TEST(trim_registers_are_read_in_order)
+{
+    bme280_image();
+    host_wire_short(0, 0);
+    CHECK(setup_bme280());
+    uint8_t trim[32];
+    CHECK(bme280_trim_regs(trim));
+    for (int i = 0; i < 32; i++)
+        CHECK_EQ(trim[i], i + 1);
+}
+
+TEST(short_data_read_recovers_the_bus)
+{
+    bme280_image();
+    uint8_t data[8];
+    bme280_start();
+    host_wire_short(1, 7);
+    CHECK(!read_bme280_raw(data));
+    uint32_t recoveries = bme280_recoveries();
+    bme280_start(); // Recovers the bus and sets the sensor up again first
+    CHECK_EQ(bme280_recoveries(), recoveries + 1);
+    CHECK(read_bme280_raw(data));
+    CHECK(memcmp(data, regs + 0xF7, 8) == 0);
+}
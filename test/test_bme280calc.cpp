@@ -0,0 +1,55 @@
+#include "bme280calc.h"
+#include "check.h"
+
+// Trimming parameters and readings of the compensation example in the Bosch datasheet (appendix 8.1/8.2)
+static Bme280Trim datasheet_trim()
+{
+    Bme280Trim t = {};
+    t.T1 = 27504; t.T2 = 26435; t.T3 = -1000;
+    t.P1 = 36477; t.P2 = -10685; t.P3 = 3024; t.P4 = 2855; t.P5 = 140; t.P6 = -7; t.P7 = 15500; t.P8 = -14600;
+    t.P9 = 6000;
+    t.H1 = 75; t.H2 = 362; t.H3 = 0; t.H4 = 324; t.H5 = 50; t.H6 = 30;
+    return t;
+}
+
+TEST(datasheet_example)
+{
+    Bme280Trim t = datasheet_trim();
+    int32_t t_fine;
+    CHECK_EQ(bme280_calc_t(t, 519888, t_fine), 2508); // 25.08 C
+    CHECK_EQ(t_fine, 128422);
+    CHECK_NEAR(bme280_calc_p(t, 415148, t_fine), 100653, 5); // 1006.53 hPa; the 32-bit formula is a few Pa off
+}
+
+TEST(humidity_in_range)
+{
+    Bme280Trim t = datasheet_trim();
+    int32_t t_fine;
+    bme280_calc_t(t, 519888, t_fine);
+    uint32_t h0 = bme280_calc_h(t, 0, t_fine), h1 = bme280_calc_h(t, 30000, t_fine);
+    uint32_t h2 = bme280_calc_h(t, 65535, t_fine);
+    CHECK(h0 <= h1);
+    CHECK(h1 <= h2);
+    CHECK(h2 <= 100u * 1024);   // Clamped to 100 %
+}
+
+TEST(parse_registers)
+{
+    uint8_t data[32];
+    for (int i = 0; i < 32; i++)
+        data[i] = uint8_t(i * 17 + 3);
+    Bme280Trim t;
+    bme280_parse_trim(data, t);
+    CHECK_EQ(t.T1, (data[1] << 8) | data[0]);
+    CHECK_EQ(t.P9, int16_t((data[23] << 8) | data[22]));
+    CHECK_EQ(t.H1, int8_t(data[24]));
+    CHECK_EQ(t.H4, int16_t((data[28] << 4) | (data[29] & 0x0F)));
+    CHECK_EQ(t.H5, int16_t((data[30] << 4) | (data[29] >> 4)));
+
+    const uint8_t regs[8] = { 0x65, 0x5A, 0xC0, 0x7E, 0xED, 0x00, 0x6B, 0x4F };
+    Bme280Raw raw;
+    bme280_parse_data(regs, raw);
+    CHECK_EQ(raw.pres, 415148);
+    CHECK_EQ(raw.temp, 519888);
+    CHECK_EQ(raw.hum, 0x6B4F);
+}
@@ -0,0 +1,171 @@
+#include "main.h"
+#include "snapshot.h"
+#include "spsc.h"
+#include "check.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Stress tests of the lock-free structures, with the writer and the readers on their own threads
+
+// A snapshot is consistent if every word holds the same value
+struct Snapshot
+{
+    uint32_t words[64];
+};
+
+TEST(seqlock_readers_never_see_a_torn_snapshot)
+{
+    static SeqLock<Snapshot> lock;
+    std::atomic<bool> done(false);
+    std::atomic<uint32_t> torn(0), reads(0), backwards(0);
+    const uint32_t writes = 200000;
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 3; i++)
+    {
+        readers.push_back(std::thread([&]()
+        {
+            Snapshot s;
+            uint32_t last_gen = 0;
+            while (!done.load())
+            {
+                uint32_t gen = lock.read(s);
+                for (int w = 1; w < 64; w++)
+                {
+                    if (s.words[w] != s.words[0])
+                    {
+                        torn++;
+                        break;
+                    }
+                }
+                if ((gen < last_gen) || (s.words[0] != gen))
+                    backwards++;
+                last_gen = gen;
+                reads++;
+            }
+        }));
+    }
+
+    // With a single CPU the readers would otherwise only run once the writer is done
+    while (reads.load() < 3)
+        std::this_thread::yield();
+
+    Snapshot s;
+    for (uint32_t n = 1; n <= writes; n++)
+    {
+        if (n % 1000 == 0)
+            std::this_thread::yield();
+        for (int w = 0; w < 64; w++)
+            s.words[w] = n;
+        lock.write(s);
+    }
+    done = true;
+    for (auto& t : readers)
+        t.join();
+
+    CHECK_EQ(torn.load(), 0u);
+    CHECK_EQ(backwards.load(), 0u);
+    CHECK(reads.load() > 0);
+    CHECK_EQ(lock.generation(), writes);
+}
+
+// The station's own publishing path: the aggregation task writing the weather data, the web server reading it
+TEST(weather_data_snapshots_are_consistent)
+{
+    std::atomic<bool> done(false);
+    std::atomic<uint32_t> torn(0), reads(0);
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 2; i++)
+    {
+        readers.push_back(std::thread([&]()
+        {
+            WeatherData wd;
+            while (!done.load())
+            {
+                wdata_snapshot(wd);
+                float v = float(wd.seconds);
+                if ((wd.temp_c != v) || (wd.pressure != v) || (wd.rain_total != wd.seconds) ||
+                    (uint32_t(atoi(wd.id)) != wd.seconds))
+                    torn++;
+                reads++;
+            }
+        }));
+    }
+    while (reads.load() < 2)
+        std::this_thread::yield();
+
+    for (uint32_t n = 1; n <= 100000; n++)
+    {
+        wdata.seconds = n;
+        wdata.temp_c = wdata.pressure = float(n);
+        wdata.rain_total = n;
+        snprintf(wdata.id, sizeof(wdata.id), "%u", unsigned(n));
+        wdata_publish();
+        if (n % 1000 == 0)
+            std::this_thread::yield();
+    }
+    done = true;
+    for (auto& t : readers)
+        t.join();
+
+    CHECK_EQ(torn.load(), 0u);
+    CHECK(reads.load() > 0);
+}
+
+TEST(spsc_keeps_order_and_loses_nothing)
+{
+    static SpscRing<uint32_t, 128> ring;
+    const uint32_t count = 2000000;
+    std::atomic<uint32_t> errors(0);
+
+    std::thread consumer([&]()
+    {
+        uint32_t expected = 0, v;
+        while (expected < count)
+        {
+            if (ring.pop(v))
+            {
+                if (v != expected)
+                    errors++;
+                expected = v + 1;
+            }
+            else
+                std::this_thread::yield();
+        }
+    });
+
+    uint32_t rejected = 0;
+    for (uint32_t n = 0; n < count; )
+    {
+        if (ring.push(n))
+            n++;
+        else
+        {
+            rejected++;
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+
+    CHECK_EQ(errors.load(), 0u);
+    CHECK_EQ(ring.get_drops(), rejected); // Every refused push is counted as a drop
+    CHECK_EQ(ring.size(), 0u);
+}
+
+TEST(spsc_full_and_empty)
+{
+    SpscRing<uint8_t, 4> ring;
+    uint8_t v;
+    CHECK(!ring.pop(v));
+    for (int i = 0; i < 4; i++)
+        CHECK(ring.push(uint8_t(i)));
+    CHECK(!ring.push(9));
+    CHECK_EQ(ring.space(), 0u);
+    CHECK(ring.pop(v) && (v == 0));
+    CHECK(ring.push(4));
+    for (int i = 1; i <= 4; i++)
+        CHECK(ring.pop(v) && (v == i));
+    CHECK_EQ(ring.get_drops(), 1u);
+}
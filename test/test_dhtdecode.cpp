@@ -0,0 +1,71 @@
+#include "dhtdecode.h"
+#include "check.h"
+#include <string.h>
+
+// Build the pulses of a frame as the RMT captures them: the tail of the start signal, the response, then 40 bits
+static size_t make_frame(DhtPulse *p, const uint8_t data[5], int jitter = 0)
+{
+    size_t n = 0;
+    p[n++] = { 1, 30 };     // Host releasing the line
+    p[n++] = { 0, 80 };     // Response low
+    p[n++] = { 1, 80 };     // Response high
+    for (int bit = 0; bit < 40; bit++)
+    {
+        int j = jitter ? (bit * 7 % (2 * jitter + 1)) - jitter : 0;
+        p[n++] = { 0, uint16_t(50 + j) };
+        p[n++] = { 1, uint16_t(((data[bit / 8] >> (7 - bit % 8)) & 1) ? 70 + j : 26 + j) };
+    }
+    p[n++] = { 0, 50 };     // Sensor releasing the line
+    return n;
+}
+
+static void checksum(uint8_t data[5])
+{
+    data[4] = uint8_t(data[0] + data[1] + data[2] + data[3]);
+}
+
+TEST(decodes_positive)
+{
+    uint8_t frame[5] = { 0x02, 0x8C, 0x01, 0x5F }; // 65.2 %, 35.1 C
+    checksum(frame);
+    DhtPulse p[96];
+    size_t n = make_frame(p, frame);
+    uint8_t data[5] = {};
+    CHECK_EQ(dht_decode(p, n, data), DHT_OK);
+    CHECK(memcmp(data, frame, 5) == 0);
+    CHECK_NEAR(dht_humidity(data), 65.2, 1e-4);
+    CHECK_NEAR(dht_temperature(data), 35.1, 1e-4);
+}
+
+TEST(decodes_negative_with_jitter)
+{
+    uint8_t frame[5] = { 0x03, 0xE8, 0x80, 0x65 }; // 100.0 %, -10.1 C
+    checksum(frame);
+    DhtPulse p[96];
+    size_t n = make_frame(p, frame, 8);
+    uint8_t data[5] = {};
+    CHECK_EQ(dht_decode(p, n, data), DHT_OK);
+    CHECK_NEAR(dht_humidity(data), 100.0, 1e-4);
+    CHECK_NEAR(dht_temperature(data), -10.1, 1e-4);
+}
+
+TEST(errors)
+{
+    uint8_t frame[5] = { 0x01, 0x90, 0x00, 0xC8 };
+    checksum(frame);
+    DhtPulse p[96];
+    uint8_t data[5] = {};
+    size_t n = make_frame(p, frame);
+
+    CHECK_EQ(dht_decode(p, 1, data), DHT_NO_RESPONSE);
+    CHECK_EQ(dht_decode(p, n - 10, data), DHT_SHORT);
+
+    DhtPulse bad[96];
+    memcpy(bad, p, sizeof(p));
+    bad[20].us = 300; // A pulse far too long
+    CHECK_EQ(dht_decode(bad, n, data), DHT_BAD_PULSE);
+
+    frame[4]++;
+    n = make_frame(p, frame);
+    CHECK_EQ(dht_decode(p, n, data), DHT_CHECKSUM);
+}
@@ -0,0 +1,60 @@
+#include "histogram.h"
+#include "check.h"
+
+TEST(buckets_are_le_bounds)
+{
+    Histogram h;
+    h.add(0);
+    h.add(1);       // Bucket 0: <= 1
+    h.add(2);       // Bucket 1: <= 2
+    h.add(3);       // Bucket 2: <= 4
+    h.add(4);
+    h.add(5);       // Bucket 3: <= 8
+    h.add(1024);    // Bucket 10
+    h.add(1025);    // Bucket 11
+    CHECK_EQ(h.get_bucket(0), 2u);
+    CHECK_EQ(h.get_bucket(1), 1u);
+    CHECK_EQ(h.get_bucket(2), 2u);
+    CHECK_EQ(h.get_bucket(3), 1u);
+    CHECK_EQ(h.get_bucket(10), 1u);
+    CHECK_EQ(h.get_bucket(11), 1u);
+    CHECK_EQ(h.get_count(), 8u);
+    CHECK_EQ(h.get_sum(), uint64_t(2064));
+    CHECK_EQ(h.get_max(), 1025u);
+}
+
+TEST(last_bucket_is_inf)
+{
+    Histogram h;
+    h.add(Histogram::le(HIST_BUCKETS - 2));
+    h.add(Histogram::le(HIST_BUCKETS - 2) + 1);
+    h.add(0xFFFFFFFFu);
+    CHECK(Histogram::is_inf(HIST_BUCKETS - 1));
+    CHECK_EQ(h.get_bucket(HIST_BUCKETS - 2), 1u);
+    CHECK_EQ(h.get_bucket(HIST_BUCKETS - 1), 2u);
+    CHECK_EQ(h.get_sum(), uint64_t(2) * Histogram::le(HIST_BUCKETS - 2) + 1 + 0xFFFFFFFFu);
+}
+
+TEST(percentiles)
+{
+    Histogram h;
+    CHECK_EQ(h.percentile(50), 0u);
+    for (int i = 0; i < 98; i++)
+        h.add(100);         // Bucket <= 128
+    h.add(3000);            // Bucket <= 4096
+    h.add(5000);            // Bucket <= 8192
+    CHECK_EQ(h.percentile(50), 128u);
+    CHECK_EQ(h.percentile(98), 128u);
+    CHECK_EQ(h.percentile(99), 4096u);
+    CHECK_EQ(h.percentile(100), 5000u); // Never above the max
+}
+
+TEST(clear)
+{
+    Histogram h;
+    h.add(10);
+    h.clear();
+    CHECK_EQ(h.get_count(), 0u);
+    CHECK_EQ(h.get_max(), 0u);
+    CHECK_EQ(h.get_bucket(4), 0u);
+}
@@ -0,0 +1,150 @@
+#include "main.h"
+#include <esp_heap_caps.h>
+#include "check.h"
+#include <string>
+#include <vector>
+
+// The in-RAM history, listed the way /history does
+
+static void add(uint32_t seconds, float temp_c)
+{
+    WeatherData wd = {};
+    wd.seconds = seconds;
+    wd.temp_c = temp_c;
+    wd.pressure = 1000.0f;
+    wd.humidity = 50.0f;
+    history_add(wd, 0);
+}
+
+// The listed records as (uptime, temperature) pairs
+static std::vector<std::pair<uint32_t, float>> list(uint32_t from = 0, uint32_t to = 0xFFFFFFFF, uint32_t step = 0)
+{
+    HistoryCursor cur;
+    history_cursor_init(cur, from, to, step);
+    std::string csv;
+    char buf[100];
+    for (size_t n; (n = history_read(cur, buf, sizeof(buf))) != 0; )
+        csv.append(buf, n);
+
+    std::vector<std::pair<uint32_t, float>> records;
+    size_t pos = csv.find('\n') + 1; // Skip the header
+    while (pos < csv.size())
+    {
+        unsigned sec;
+        float temp;
+        if (sscanf(csv.c_str() + pos, "%u,%f", &sec, &temp) == 2)
+            records.push_back(std::make_pair(uint32_t(sec), temp));
+        pos = csv.find('\n', pos) + 1;
+    }
+    return records;
+}
+
+TEST(missed_samples_do_not_shift_the_older_records)
+{
+    host_heap(200 * 1024, 110 * 1024);
+    setup_history();
+    for (uint32_t i = 1; i <= 10; i++)
+        add(i * PERIOD_5_SEC, 20.0f + i / 10.0f);
+    add(80, 30.0f); // Samples were missed between 50 and 80, and between 85 and 100
+    add(85, 30.1f);
+    add(100, 30.2f);
+
+    auto r = list();
+    CHECK_EQ(r.size(), 13u);
+    CHECK_EQ(r[0].first, 5u);
+    CHECK_NEAR(r[0].second, 20.1f, 0.01f);
+    CHECK_EQ(r[9].first, 50u);
+    CHECK_NEAR(r[9].second, 21.0f, 0.01f);
+    CHECK_EQ(r[10].first, 80u);
+    CHECK_EQ(r[11].first, 85u);
+    CHECK_EQ(r[12].first, 100u);
+    CHECK_NEAR(r[12].second, 30.2f, 0.01f);
+
+    // The range and the step still go by the time of the records
+    r = list(40, 85, 20);
+    CHECK_EQ(r.size(), 2u);
+    CHECK_EQ(r[0].first, 40u);
+    CHECK_EQ(r[1].first, 80u);
+
+    HistoryStats st;
+    history_stats(st);
+    CHECK_EQ(st.count, 13u);
+    CHECK_EQ(st.sec, 100u);
+}
+
+// Room for the 24 hours of 1-min records (46 blocks of 32) and just two blocks of 5-sec records
+static void setup_small_history()
+{
+    host_heap(200 * 1024, 64 * 1024 + (46 + 2) * (32 * 6 + 8));
+    setup_history();
+}
+
+TEST(overwritten_blocks_keep_the_values_and_times)
+{
+    setup_small_history();
+    HistoryStats st;
+    history_stats(st);
+    CHECK_EQ(st.size, 64u);
+    CHECK_EQ(st.coarse_size, 1472u);
+
+    // Every 20th sample is missed, so that most blocks end early
+    uint32_t sec = 0;
+    float temp = 10.0f;
+    for (int i = 1; i <= 200; i++)
+    {
+        sec += (i % 20) ? PERIOD_5_SEC : 3 * PERIOD_5_SEC;
+        temp += 0.1f;
+        add(sec, temp);
+    }
+
+    // The 5-sec records are the last ones listed
+    auto r = list();
+    history_stats(st);
+    CHECK_EQ(st.count, 21u); // The two newest blocks: samples 180 to 199, and 200 after the last missed one
+    CHECK(r.size() > st.count);
+    size_t fine = r.size() - st.count;
+    CHECK_EQ(r.back().first, sec);
+    CHECK_NEAR(r.back().second, temp, 0.05f);
+    for (size_t i = fine + 1; i < r.size(); i++)
+    {
+        // Consecutive samples are 5 seconds and 0.1 C apart, the missed ones 15 seconds and still 0.1 C
+        uint32_t dt = r[i].first - r[i - 1].first;
+        CHECK((dt == PERIOD_5_SEC) || (dt == 3 * PERIOD_5_SEC));
+        CHECK_NEAR(r[i].second - r[i - 1].second, 0.1f, 0.01f);
+    }
+
+    // Before them, the 1-min records with the values at the end of each minute
+    CHECK_EQ(r[0].first, 60u);
+    CHECK_NEAR(r[0].second, 11.2f, 0.01f);
+    for (size_t i = 1; i < fine; i++)
+    {
+        CHECK_EQ(r[i].first - r[i - 1].first, 60u);
+        CHECK(r[i].second > r[i - 1].second);
+    }
+    CHECK(r[fine - 1].first < r[fine].first);
+}
+
+TEST(the_last_24_hours_are_kept_at_1_min)
+{
+    setup_small_history();
+    uint32_t sec;
+    for (sec = PERIOD_5_SEC; sec <= 25 * PERIOD_1_HR; sec += PERIOD_5_SEC)
+        add(sec, 20.0f + (sec / 60 % 100) / 10.0f);
+    sec -= PERIOD_5_SEC;
+
+    HistoryStats st;
+    history_stats(st);
+    CHECK(st.coarse_count > 1440u);
+    CHECK_EQ(st.coarse_sec, st.coarse_count * 60);
+    CHECK_EQ(st.sec, st.count * PERIOD_5_SEC);
+    CHECK(st.sec < PERIOD_1_HR);
+
+    // Listed at 1 min, the 1-min records and then the 5-sec ones make up the last 24 hours without a gap
+    auto r = list(0, 0xFFFFFFFF, 60);
+    CHECK(r.front().first <= sec - 24 * PERIOD_1_HR + 60);
+    CHECK_EQ(r.back().first, sec);
+    for (size_t i = 1; i < r.size(); i++)
+        CHECK_EQ(r[i].first - r[i - 1].first, 60u);
+    for (auto& rec : r)
+        CHECK_NEAR(rec.second, 20.0f + (rec.first / 60 % 100) / 10.0f, 0.01f);
+}
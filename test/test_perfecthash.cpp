@@ -0,0 +1,61 @@
+#include "perfecthash.h"
+#include "check.h"
+#include <string.h>
+
+struct Key
+{
+    const char *name;
+};
+
+static constexpr Key keys[] = {
+    { "id" }, { "tag" }, { "wind_calib" }, { "rain_calib" }, { "rain_event" }, { "rain_event_max" },
+    { "rain_event_cnt" }, { "rain_total" }, { "error" }, { "temp_c_calib" }, { "vane_cal" } };
+#define KEYS  (sizeof(keys) / sizeof(keys[0]))
+#define BITS  4
+
+static constexpr uint32_t seed = ph_seed(keys, KEYS, BITS);
+static_assert(seed != 0, "No seed found");
+static_assert(ph_unique(keys, KEYS, seed, BITS), "Seed is not collision-free");
+
+TEST(fnv1a)
+{
+    // FNV-1a test vectors, with the standard offset basis as the seed
+    CHECK_EQ(ph_hash("", 2166136261u), 0x811c9dc5u);
+    CHECK_EQ(ph_hash("a", 2166136261u), 0xe40c292cu);
+    CHECK_EQ(ph_hash("foobar", 2166136261u), 0xbf9cf968u);
+}
+
+TEST(every_key_in_its_own_slot)
+{
+    int found[KEYS] = {};
+    for (uint32_t slot = 0; slot < (1u << BITS); slot++)
+    {
+        uint8_t i = ph_slot_key(keys, KEYS, seed, BITS, slot);
+        if (i == PH_NONE)
+            continue;
+        CHECK(i < KEYS);
+        CHECK_EQ(ph_slot(keys[i].name, seed, BITS), slot);
+        found[i]++;
+    }
+    for (uint32_t i = 0; i < KEYS; i++)
+        CHECK_EQ(found[i], 1);
+}
+
+TEST(unknown_names)
+{
+    // An unknown name lands in some slot; the lookup has to compare the name to reject it
+    const char *unknown[] = { "", "_", "ID", "rain", "rain_event_maxx", "wind_calib " };
+    for (const char *name : unknown)
+    {
+        uint8_t i = ph_slot_key(keys, KEYS, seed, BITS, ph_slot(name, seed, BITS));
+        CHECK((i == PH_NONE) || (strcmp(keys[i].name, name) != 0));
+    }
+}
+
+TEST(no_seed_when_impossible)
+{
+    // Three keys can never fit into two slots
+    static constexpr Key three[] = { { "a" }, { "b" }, { "c" } };
+    static_assert(ph_seed(three, 3, 1, 2166136261u, 16) == 0, "Found a seed for an impossible table");
+    CHECK(true);
+}
@@ -0,0 +1,47 @@
+#include "main.h"
+#include <nvs.h>
+#include "check.h"
+
+// The preferences bound to the weather data, written back through the host NVS
+TEST(failed_writes_stay_dirty_and_are_retried)
+{
+    host_nvs_clear();
+    setup_prefs();
+    uint32_t writes, avoided, flush_us, flush_us_max, errors;
+    int32_t last_err;
+
+    wdata.rain_total = 17;
+    pref_changed(&wdata.rain_total);
+    wdata.wind_calib = 1.75f;
+    pref_changed(&wdata.wind_calib);
+    host_nvs_fail(1, 0); // The first of the two writes fails
+    CHECK(!pref_flush());
+    pref_stats(writes, avoided, flush_us, flush_us_max, errors, last_err);
+    CHECK_EQ(errors, 1u);
+    CHECK_EQ(last_err, ESP_ERR_NVS_NOT_ENOUGH_SPACE);
+    CHECK_EQ(writes, 1u);
+
+    // The failed one is written with the next flush, and only that one
+    uint32_t sets = host_nvs_sets();
+    CHECK(pref_flush());
+    CHECK_EQ(host_nvs_sets(), sets + 1);
+    CHECK(pref_flush()); // Nothing left to write
+    CHECK_EQ(host_nvs_sets(), sets + 1);
+
+    // A failed commit keeps every key of the flush dirty
+    wdata.rain_total = 18;
+    pref_changed(&wdata.rain_total);
+    host_nvs_fail(0, 1);
+    CHECK(!pref_flush());
+    CHECK(pref_flush());
+    pref_stats(writes, avoided, flush_us, flush_us_max, errors, last_err);
+    CHECK_EQ(errors, 2u);
+    CHECK_EQ(writes, 3u);
+
+    // What was saved is loaded again
+    wdata.rain_total = 0;
+    wdata.wind_calib = 0;
+    setup_prefs();
+    CHECK_EQ(wdata.rain_total, 18u);
+    CHECK_NEAR(wdata.wind_calib, 1.75, 1e-6);
+}
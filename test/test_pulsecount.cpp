@@ -0,0 +1,73 @@
+#include "main.h"
+#include "check.h"
+#include <atomic>
+#include <thread>
+
+// A reed switch closing at the given time: the contact bounces for 0.8 ms, each bounce a 20 us high pulse
+static const uint32_t bounce_us[] = { 0, 60, 250, 500, 800 };
+#define BOUNCES  (sizeof(bounce_us) / sizeof(bounce_us[0]))
+
+TEST(edges_are_debounced)
+{
+    PulseCounter c;
+    c.keep_times(true);
+    for (int closure = 0; closure < 10; closure++)
+    {
+        for (uint32_t b : bounce_us)
+            c.edge(100000 + closure * 30000 + b);
+    }
+    CHECK_EQ(c.get_count(), 10u);
+    uint32_t t;
+    for (int closure = 0; closure < 10; closure++)
+        CHECK(c.pop_time(t) && (t == 100000u + closure * 30000));
+    CHECK(!c.pop_time(t));
+}
+
+TEST(edges_across_the_micros_wrap)
+{
+    PulseCounter c;
+    c.edge(0xFFFFF000u);
+    CHECK(!c.edge(0xFFFFF000u + 900));  // Bounce
+    CHECK(c.edge(0xFFFFF000u + 20000)); // Next pulse, after micros() wrapped
+    CHECK_EQ(c.get_and_clear_count(), 2u);
+    CHECK_EQ(c.get_count(), 0u);
+}
+
+// The Gauge, driven the way the GPIO interrupt would
+TEST(gauge_counts_each_closure_once)
+{
+    static Gauge g;
+    g.keep_times(true);
+    for (int closure = 0; closure < 5; closure++)
+    {
+        host_advance_us(50000);
+        uint32_t last = 0;
+        for (uint32_t b : bounce_us)
+        {
+            host_advance_us(b - last);
+            last = b;
+            g.isr();
+        }
+    }
+    CHECK_EQ(g.get_and_clear_count(), 5u);
+}
+
+// The acquisition task clearing the count while the interrupt keeps counting: no pulse is lost or counted twice
+TEST(count_is_cleared_without_losing_pulses)
+{
+    static PulseCounter c;
+    const uint32_t PULSES = 200000;
+    std::atomic<bool> done(false);
+    std::thread isr([&]()
+    {
+        for (uint32_t i = 1; i <= PULSES; i++)
+            c.edge(i * (PULSE_DEBOUNCE_US + 1));
+        done = true;
+    });
+    uint32_t total = 0;
+    while (!done)
+        total += c.get_and_clear_count();
+    isr.join();
+    total += c.get_and_clear_count();
+    CHECK_EQ(total, PULSES);
+}
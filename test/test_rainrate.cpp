@@ -0,0 +1,41 @@
+#include "rainrate.h"
+#include "check.h"
+
+#define TIMEOUT_US  (600 * 1000000u)
+
+TEST(no_rate_before_two_tips)
+{
+    RainRate r(TIMEOUT_US);
+    CHECK_EQ(r.rate(1000), 0.0f);
+    r.tip(1000);
+    CHECK_EQ(r.rate(2000), 0.0f);
+}
+
+TEST(rate_from_tip_interval)
+{
+    RainRate r(TIMEOUT_US);
+    r.tip(0);
+    r.tip(36000000); // 36 s apart: 100 tips per hour
+    CHECK_NEAR(r.rate(36000000), 100, 1e-3);
+    CHECK_NEAR(r.rate(50000000), 100, 1e-3); // Not slower than the interval yet
+}
+
+TEST(rate_decays_and_times_out)
+{
+    RainRate r(TIMEOUT_US);
+    r.tip(0);
+    r.tip(36000000);
+    CHECK_NEAR(r.rate(36000000 + 72000000), 50, 1e-3); // As if the next tip were now
+    CHECK_EQ(r.rate(36000000 + TIMEOUT_US + 1), 0.0f);
+    r.tip(36000000 + TIMEOUT_US + 2000000); // A new series
+    CHECK_EQ(r.rate(36000000 + TIMEOUT_US + 3000000), 0.0f);
+}
+
+TEST(rate_across_micros_wrap)
+{
+    RainRate r(TIMEOUT_US);
+    uint32_t t = 0xFFFFFFFFu - 10000000u;
+    r.tip(t);
+    r.tip(t + 18000000u); // Wraps
+    CHECK_NEAR(r.rate(t + 18000000u), 200, 1e-3);
+}
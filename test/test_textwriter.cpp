@@ -0,0 +1,46 @@
+#include "textwriter.h"
+#include "check.h"
+#include <string>
+
+static std::string fixed(float v, int decimals = 2)
+{
+    char buf[64];
+    TextWriter w(buf, sizeof(buf));
+    w.fixed(v, decimals);
+    return w.c_str();
+}
+
+TEST(integers)
+{
+    char buf[64];
+    TextWriter w(buf, sizeof(buf));
+    w.u32(0).str(" ").u32(4294967295u).str(" ").i32(-2147483647 - 1).str(" ").hex(0).str(" ").hex(0xdeadBEEF);
+    CHECK_STR(w.c_str(), "0 4294967295 -2147483648 0 deadbeef");
+}
+
+TEST(fixed_point)
+{
+    CHECK_STR(fixed(0), "0.00");
+    CHECK_STR(fixed(21.256f), "21.26");
+    CHECK_STR(fixed(21.254f), "21.25");
+    CHECK_STR(fixed(-3.14159f, 4), "-3.1416");
+    CHECK_STR(fixed(-0.001f), "0.00");      // No negative zero
+    CHECK_STR(fixed(1013.25f, 0), "1013");
+    CHECK_STR(fixed(0.0f / 0.0f), "nan");
+    CHECK_STR(fixed(1e12f, 1), "999999995904.0"); // Past the integer fast path
+}
+
+TEST(truncates_and_reports_overflow)
+{
+    char buf[8];
+    TextWriter w(buf, sizeof(buf));
+    w.str("12345");
+    CHECK(!w.overflow());
+    w.str("6789");
+    CHECK(w.overflow());
+    CHECK_STR(w.c_str(), "1234567");
+    CHECK_EQ(w.length(), size_t(7));
+    w.clear();
+    CHECK_EQ(w.length(), size_t(0));
+    CHECK(!w.overflow());
+}
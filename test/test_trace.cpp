@@ -0,0 +1,209 @@
+#include "main.h"
+#include "check.h"
+#include <vector>
+
+static RawSample sample(uint32_t seconds, int pulses, bool sensors)
+{
+    RawSample r = {};
+    r.seconds = seconds;
+    r.time = seconds * 1000000u + 17;
+    r.flags = sensors ? (RAW_SENSORS | RAW_BME | RAW_BME_OK) : 0;
+    r.anem_count = pulses;
+    r.anem_n = pulses;
+    for (int i = 0; i < pulses; i++)
+        r.anem_times[i] = r.time - 1000000u + i * (1000000u / (pulses + 1));
+    r.rain_count = r.rain_n = 1;
+    r.rain_times[0] = r.time - 400000;
+    r.wind_dir_adc = 2978;
+    for (int i = 0; i < 8; i++)
+        r.bme[i] = uint8_t(i * 31);
+    r.dht_temp = 21.5f;
+    r.dht_hum = 40.0f;
+    return r;
+}
+
+static bool same(const RawSample& a, const RawSample& b)
+{
+    bool ok = (a.seconds == b.seconds) && (a.time == b.time) && (a.flags == b.flags) &&
+              (a.anem_count == b.anem_count) && (a.rain_count == b.rain_count) && (a.anem_n == b.anem_n) &&
+              (a.rain_n == b.rain_n) && (a.wind_dir_adc == b.wind_dir_adc);
+    for (int i = 0; ok && (i < a.anem_n); i++)
+        ok = a.anem_times[i] == b.anem_times[i];
+    for (int i = 0; ok && (i < a.rain_n); i++)
+        ok = a.rain_times[i] == b.rain_times[i];
+    if (ok && (a.flags & RAW_SENSORS))
+        ok = (memcmp(a.bme, b.bme, 8) == 0) && (a.dht_temp == b.dht_temp) && (a.dht_hum == b.dht_hum);
+    return ok;
+}
+
+// A trace of samples with a gap record and a record of an unknown type in between
+static std::vector<uint8_t> make_trace(std::vector<RawSample>& samples)
+{
+    std::vector<uint8_t> t(TRACE_HDR_LEN);
+    trace_header(t.data());
+    uint8_t rec[TRACE_REC_MAX];
+    for (uint32_t s = 1; s <= 20; s++)
+    {
+        samples.push_back(sample(s, (s * 13) % (RAW_ANEM_MAX + 1), s % 5 == 0));
+        size_t len = trace_encode(rec, samples.back());
+        t.insert(t.end(), rec, rec + len);
+        if (s == 7)
+        {
+            len = trace_encode_gap(rec, 1234);
+            t.insert(t.end(), rec, rec + len);
+            const uint8_t unknown[] = { 0x7F, 2, 0, 0xAB, 0xCD };
+            t.insert(t.end(), unknown, unknown + sizeof(unknown));
+        }
+    }
+    return t;
+}
+
+TEST(header)
+{
+    uint8_t h[TRACE_HDR_LEN];
+    trace_header(h);
+    CHECK(trace_check_header(h, sizeof(h)));
+    CHECK(!trace_check_header(h, sizeof(h) - 1));
+    h[4]++;
+    CHECK(!trace_check_header(h, sizeof(h)));
+}
+
+TEST(round_trip_skipping_other_records)
+{
+    std::vector<RawSample> samples;
+    std::vector<uint8_t> t = make_trace(samples);
+    size_t pos = TRACE_HDR_LEN;
+    RawSample r;
+    for (const RawSample& s : samples)
+    {
+        CHECK_EQ(trace_decode(t.data(), t.size(), pos, r), 1);
+        CHECK(same(r, s));
+    }
+    CHECK_EQ(trace_decode(t.data(), t.size(), pos, r), 0);
+    CHECK_EQ(pos, t.size());
+}
+
+TEST(longest_record_fits)
+{
+    RawSample r = sample(5, RAW_ANEM_MAX, true);
+    r.rain_n = RAW_RAIN_MAX;
+    for (int i = 0; i < r.rain_n; i++)
+        r.rain_times[i] = r.time - 0xFFFFFFF0u; // Longest varints
+    for (int i = 0; i < r.anem_n; i++)
+        r.anem_times[i] = r.time - 0xFFFFFFF0u;
+    uint8_t rec[TRACE_REC_MAX];
+    CHECK_EQ(trace_encode(rec, r), size_t(TRACE_REC_MAX));
+}
+
+TEST(cut_off_at_any_point)
+{
+    // A trace cut off anywhere decodes up to its last complete record and asks for more
+    std::vector<RawSample> samples;
+    std::vector<uint8_t> t = make_trace(samples);
+    for (size_t len = TRACE_HDR_LEN; len < t.size(); len += 3)
+    {
+        size_t pos = TRACE_HDR_LEN;
+        RawSample r;
+        int n = 0, rc;
+        while ((rc = trace_decode(t.data(), len, pos, r)) == 1)
+            CHECK(same(r, samples[n++]));
+        CHECK_EQ(rc, 0);
+        CHECK(pos <= len);
+    }
+}
+
+TEST(rejects_corrupt_sample)
+{
+    std::vector<RawSample> samples;
+    std::vector<uint8_t> t = make_trace(samples);
+    t[TRACE_HDR_LEN + 3 + 17] = RAW_ANEM_MAX + 1; // anem_n of the first sample
+    size_t pos = TRACE_HDR_LEN;
+    RawSample r;
+    CHECK_EQ(trace_decode(t.data(), t.size(), pos, r), -1);
+}
+
+TEST(merge_keeps_the_counts_and_the_sensor_readings)
+{
+    // A 5-sec sample that could not be handed over, then two more ticks merged into it
+    RawSample r = sample(5, 10, true);
+    RawSample t6 = sample(6, 20, false), t7 = sample(7, 120, false);
+    t7.bme[0] = 0xEE; // Not read this tick, must not replace the 5-sec reading
+    raw_merge(r, t6);
+    raw_merge(r, t7);
+    CHECK_EQ(r.seconds, 7u);
+    CHECK_EQ(r.time, t7.time);
+    CHECK_EQ(r.anem_count, 150u);
+    CHECK_EQ(r.rain_count, 3u);
+    CHECK_EQ(r.anem_n, RAW_ANEM_MAX);  // The times that do not fit are dropped, their count is kept
+    CHECK_EQ(r.anem_times[10], t6.anem_times[0]);
+    CHECK_EQ(r.anem_times[30], t7.anem_times[0]);
+    CHECK_EQ(r.rain_n, 3);
+    CHECK_EQ(r.rain_times[2], t7.rain_times[0]);
+    CHECK(r.flags & RAW_SENSORS);
+    CHECK_EQ(r.bme[0], 0);
+
+    // A newer sensor reading replaces the kept one, including its result
+    RawSample t10 = sample(10, 0, true);
+    t10.flags = RAW_SENSORS | RAW_BME;
+    raw_merge(r, t10);
+    CHECK_EQ(r.flags, RAW_SENSORS | RAW_BME);
+    CHECK_EQ(r.seconds, 10u);
+}
+
+// Records of a trace read from the station, after its header
+static std::vector<int> read_records(uint8_t *buf, size_t len, std::vector<RawSample>& samples)
+{
+    std::vector<int> types;
+    size_t pos = TRACE_HDR_LEN;
+    RawSample r;
+    TraceSetup setup;
+    int rc;
+    while ((rc = trace_decode(buf, len, pos, r, &setup)) > 0)
+    {
+        types.push_back(rc);
+        if (rc == 1)
+            samples.push_back(r);
+    }
+    CHECK_EQ(rc, 0);
+    CHECK_EQ(pos, len);
+    return types;
+}
+
+TEST(session_starts_clean_after_an_overrun)
+{
+    static uint8_t buf[8192];
+    TraceSetup setup = {};
+    setup.wind_calib = 1.5f;
+
+    // The first client overruns the ring and disconnects with bytes lost and the ring full
+    CHECK(trace_start());
+    CHECK_EQ(trace_read(buf, sizeof(buf)), 0u); // The aggregation task has not switched to the client yet
+    trace_sample(sample(1, 5, false), setup);
+    CHECK_EQ(trace_read(buf, sizeof(buf)), size_t(TRACE_HDR_LEN));
+    for (uint32_t s = 2; s < 40; s++)
+        trace_sample(sample(s, RAW_ANEM_MAX, true), setup);
+    trace_stop();
+
+    // The next client gets the header, the setup and its samples; no tail of the last trace and no gap record
+    CHECK(trace_start());
+    CHECK(!trace_start());
+    CHECK_EQ(trace_read(buf, sizeof(buf)), 0u);
+    trace_sample(sample(40, 3, false), setup);
+    CHECK_EQ(trace_read(buf, sizeof(buf)), size_t(TRACE_HDR_LEN));
+    CHECK(trace_check_header(buf, TRACE_HDR_LEN));
+    RawSample s41 = sample(41, 3, false), s42 = sample(42, 4, false), s43 = sample(43, 5, true);
+    trace_sample(s41, setup);
+    trace_sample(s42, setup);
+    setup.vane_adc[2] = 100; // A new setup goes before the next sample
+    trace_sample(s43, setup);
+    size_t len = trace_read(buf + TRACE_HDR_LEN, sizeof(buf) - TRACE_HDR_LEN) + TRACE_HDR_LEN;
+    std::vector<RawSample> samples;
+    std::vector<int> types = read_records(buf, len, samples);
+    CHECK_EQ(types.size(), 5u);
+    if (types.size() == 5)
+    {
+        CHECK(types[0] == TRACE_SETUP && types[1] == 1 && types[2] == 1 && types[3] == TRACE_SETUP && types[4] == 1);
+        CHECK(same(samples[0], s41) && same(samples[1], s42) && same(samples[2], s43));
+    }
+    trace_stop();
+}
@@ -0,0 +1,188 @@
+#include "weathercalc.h"
+#include "check.h"
+#include <vector>
+
+// [NV] members the calculation reported as changed
+static std::vector<const void *> changes;
+static void changed(const void *member) { changes.push_back(member); }
+
+static void station_defaults(WeatherData& wd)
+{
+    wd = WeatherData();
+    wd.wind_calib = WIND_FACTOR_MPH;
+    wd.rain_event_max = 24;
+    wd.humidity = 50;
+    memcpy(wd.vane_adc, vane_default_adc, sizeof(wd.vane_adc));
+}
+
+// One tick with evenly spaced anemometer pulses, the vane pointing to the given direction
+static RawSample tick(uint32_t seconds, int pulses, int dir)
+{
+    RawSample r = {};
+    r.seconds = seconds;
+    r.time = seconds * 1000000u;
+    r.flags = (seconds % PERIOD_5_SEC == 0) ? RAW_SENSORS : 0;
+    r.anem_count = r.anem_n = pulses;
+    for (int i = 0; i < pulses; i++)
+        r.anem_times[i] = r.time - 1000000u + (i + 1) * (1000000u / pulses);
+    r.wind_dir_adc = vane_default_adc[dir];
+    return r;
+}
+
+static void put16(uint8_t *p, int v)
+{
+    p[0] = uint8_t(v);
+    p[1] = uint8_t(v >> 8);
+}
+
+TEST(wind_speed_and_direction)
+{
+    static WeatherCalc calc;
+    WeatherData wd;
+    station_defaults(wd);
+    for (uint32_t s = 1; s <= 4; s++)
+        CHECK_EQ(calc.process(tick(s, 10, 4), wd), -1);
+    CHECK_EQ(calc.process(tick(5, 10, 4), wd), 0);
+    CHECK_EQ(wd.anem_count, 50u);
+    CHECK_NEAR(wd.wind_rt, 10 * WIND_FACTOR_MPH, 1e-4);
+    CHECK_NEAR(wd.wind_avg, 10 * WIND_FACTOR_MPH / (120 / PERIOD_5_SEC), 1e-4); // The 2-min window starts out calm
+    CHECK_NEAR(wd.wind_peak, 10 * WIND_FACTOR_MPH, WIND_FACTOR_MPH); // Sampled 4 times a second
+    CHECK_EQ(wd.wind_dir_rt, 4);
+    CHECK_EQ(wd.wind_dir_avg, 90);
+
+    // The direction average is weighted by the speed of each second
+    for (uint32_t s = 6; s <= 10; s++)
+        calc.process(tick(s, 10, 8), wd);
+    CHECK_EQ(wd.wind_dir_rt, 8);
+    CHECK_NEAR(wd.wind_dir_avg, 135, 1);
+}
+
+TEST(bme280_readings_with_the_trim)
+{
+    // The compensation example of the Bosch datasheet (see test_bme280calc.cpp), as the registers
+    uint8_t regs[TRACE_TRIM_LEN] = {};
+    const int tp[12] = { 27504, 26435, -1000, 36477, -10685, 3024, 2855, 140, -7, 15500, -14600, 6000 };
+    for (int i = 0; i < 12; i++)
+        put16(regs + 2 * i, tp[i]);
+    regs[24] = 75;      // H1
+    put16(regs + 25, 362);
+    regs[28] = 324 >> 4; // H4 and H5 share a nibble
+    regs[29] = (324 & 0x0F) | ((50 & 0x0F) << 4);
+    regs[30] = 50 >> 4;
+    regs[31] = 30;
+
+    static WeatherCalc calc;
+    WeatherData wd;
+    station_defaults(wd);
+    wd.temp_c_calib = -1.5f;
+    calc.set_bme280_trim(regs);
+    RawSample r = tick(5, 0, 0);
+    r.flags |= RAW_BME | RAW_BME_OK;
+    const uint8_t data[8] = { 0x65, 0x5A, 0xC0, 0x7E, 0xED, 0x00, 0x75, 0x30 };
+    memcpy(r.bme, data, sizeof(data));
+    calc.process(r, wd);
+    CHECK_NEAR(wd.temp_c, 25.08 - 1.5, 1e-4);
+    CHECK_NEAR(wd.temp_f, (25.08 - 1.5) * 9 / 5 + 32, 1e-3);
+    CHECK_NEAR(wd.pressure, 1006.53, 0.05);
+    CHECK_EQ(wd.error, 0u);
+
+    // A failed read keeps the last values and flags the error
+    r = tick(10, 0, 0);
+    r.flags |= RAW_BME;
+    calc.process(r, wd);
+    CHECK_NEAR(wd.temp_c, 25.08 - 1.5, 1e-4);
+    CHECK_EQ(wd.error, uint32_t(ERROR_BME_READ));
+}
+
+TEST(rain_and_the_hourly_event_reset)
+{
+    static WeatherCalc calc(changed);
+    WeatherData wd;
+    station_defaults(wd);
+    wd.rain_event_max = 2;
+    wd.seconds = PERIOD_1_HR - 5;
+    changes.clear();
+
+    RawSample r = tick(PERIOD_1_HR - 1, 0, 0);
+    r.rain_count = r.rain_n = 2;
+    r.rain_times[0] = r.time - 600000;
+    r.rain_times[1] = r.time - 300000;
+    CHECK_EQ(calc.process(r, wd), -1);
+    CHECK_EQ(calc.process(tick(PERIOD_1_HR, 0, 0), wd), 2);
+    CHECK_EQ(wd.rain_event, 2u);
+    CHECK_EQ(wd.rain_total, 2u);
+    CHECK_EQ(wd.rain_test, 2u);
+    CHECK(wd.rain_rate > 0);
+    CHECK_EQ(wd.rain_event_cnt, 0u); // The new hour counted first, then the rain restarted it
+    CHECK_EQ(changes.size(), 4u);
+
+    // Two hours without rain reset the event, but not the total
+    calc.process(tick(2 * PERIOD_1_HR, 0, 0), wd);
+    CHECK_EQ(wd.rain_event_cnt, 1u);
+    CHECK_EQ(wd.rain_event, 2u);
+    calc.process(tick(3 * PERIOD_1_HR, 0, 0), wd);
+    CHECK_EQ(wd.rain_event_cnt, 2u);
+    CHECK_EQ(wd.rain_event, 0u);
+    CHECK_EQ(wd.rain_total, 2u);
+    CHECK(changes.back() == &wd.rain_event);
+
+    // Too dry for rain: the tips only count as a test
+    wd.humidity = CAN_RAIN_HUMIDITY_MIN - 1;
+    r = tick(3 * PERIOD_1_HR + 5, 0, 0);
+    r.rain_count = 3;
+    CHECK_EQ(calc.process(r, wd), 0);
+    CHECK_EQ(wd.rain_total, 2u);
+    CHECK_EQ(wd.rain_test, 5u);
+}
+
+TEST(vane_follows_the_stored_calibration)
+{
+    static WeatherCalc calc;
+    WeatherData wd;
+    station_defaults(wd);
+    RawSample r = tick(1, 0, 0);
+    r.wind_dir_adc = vane_default_adc[3];
+    calc.process(r, wd);
+    CHECK_EQ(wd.wind_dir_rt, 3);
+
+    // Someone else (a /set, a replayed setup) swapped the calibration of two directions
+    wd.vane_adc[3] = vane_default_adc[5];
+    wd.vane_adc[5] = vane_default_adc[3];
+    calc.process(r, wd);
+    CHECK_EQ(wd.wind_dir_rt, 5);
+}
+
+TEST(setup_round_trip)
+{
+    static WeatherCalc a, b;
+    WeatherData wa, wb;
+    station_defaults(wa);
+    station_defaults(wb);
+    uint8_t regs[TRACE_TRIM_LEN];
+    for (int i = 0; i < TRACE_TRIM_LEN; i++)
+        regs[i] = uint8_t(i * 7 + 1);
+    a.set_bme280_trim(regs);
+    wa.wind_calib = 1.25f;
+    wa.temp_c_calib = 0.5f;
+    wa.rain_event_max = 12;
+    wa.vane_adc[7] = 1234;
+
+    TraceSetup sa, sb;
+    a.get_setup(wa, sa);
+    CHECK_EQ(sa.flags, TRACE_SETUP_BME);
+    b.get_setup(wb, sb);
+    CHECK_EQ(sb.flags, 0);
+    CHECK(memcmp(&sa, &sb, sizeof(sa)) != 0);
+
+    // Through a trace record and back
+    uint8_t rec[TRACE_REC_MAX];
+    size_t len = trace_encode_setup(rec, sa);
+    CHECK_EQ(len, size_t(3 + TRACE_SETUP_LEN));
+    size_t pos = 0;
+    RawSample r;
+    TraceSetup decoded;
+    CHECK_EQ(trace_decode(rec, len, pos, r, &decoded), TRACE_SETUP);
+    b.set_setup(decoded, wb);
+    b.get_setup(wb, sb);
+    CHECK(memcmp(&sa, &sb, sizeof(sa)) == 0);
+}
@@ -0,0 +1,236 @@
+#include "main.h"
+#include <nvs.h>
+#include "check.h"
+#include <ESPAsyncWebSrv.h>
+#include <Update.h>
+#include "webassets.h"
+
+void setup();
+
+static void firmware_setup()
+{
+    static bool done = false;
+    if (!done)
+        setup();
+    done = true;
+}
+
+// Change the weather data and push it, the way the aggregation task does after a 5-sec calculation
+static void push(float temp_c)
+{
+    wdata_lock(portMAX_DELAY);
+    wdata.seconds += PERIOD_5_SEC;
+    wdata.temp_c = temp_c;
+    wdata_publish();
+    webserver_push_sample(wdata);
+    wdata_unlock();
+}
+
+static bool has(const HostResponse& r, const char *text)
+{
+    return r.body.find(text) != std::string::npos;
+}
+
+TEST(events_start_with_a_sample_then_deltas)
+{
+    firmware_setup();
+    push(10.0f);
+    HostResponse r = host_http(HTTP_GET, "/events");
+    CHECK_EQ(r.code, 200);
+    CHECK_STR(r.type.c_str(), "text/event-stream");
+    CHECK(has(r, "event: sample\ndata: {"));
+    CHECK(has(r, "\"temp_c\":10.0"));
+    CHECK(r.body.compare(r.body.size() - 2, 2, "\n\n") == 0);
+
+    r.body.clear();
+    push(12.5f);
+    CHECK(r.more() > 0);
+    CHECK(has(r, "event: delta\ndata: {"));
+    CHECK(has(r, "\"temp_c\":12.5"));
+    CHECK(!has(r, "\"tag\""));
+    CHECK_EQ(r.more(), 0u);
+    CHECK(!r.ended);
+    r.disconnect();
+}
+
+TEST(set_changes_are_pushed)
+{
+    firmware_setup();
+    HostResponse r = host_http(HTTP_GET, "/events");
+    r.body.clear();
+    CHECK_EQ(host_http(HTTP_GET, "/set?tag=Roof&temp_c_calib=-1.5").code, 200);
+    r.more();
+    CHECK(has(r, "\"tag\":\"Roof\""));
+    CHECK(has(r, "\"temp_c_calib\":-1.50"));
+    r.disconnect();
+}
+
+// The wind calibration is shown with the same 4 decimals everywhere
+TEST(wind_calib_has_4_decimals_everywhere)
+{
+    firmware_setup();
+    HostResponse r = host_http(HTTP_GET, "/events");
+    r.body.clear();
+    CHECK_EQ(host_http(HTTP_GET, "/set?wind_calib=1.4925").code, 200);
+    r.more();
+    CHECK(has(r, "\"wind_calib\":1.4925"));
+    r.disconnect();
+    CHECK(has(host_http(HTTP_GET, "/json"), "\"wind_calib\":1.4925"));
+    CHECK(has(host_http(HTTP_GET, "/"), "wind_calib = 1.4925"));
+    r = host_http(HTTP_GET, "/events");
+    CHECK(has(r, "\"wind_calib\":1.4925"));
+    r.disconnect();
+}
+
+TEST(only_the_slow_subscriber_is_closed)
+{
+    firmware_setup();
+    HostResponse fast = host_http(HTTP_GET, "/events"), slow = host_http(HTTP_GET, "/events");
+    for (int i = 0; i <= 4; i++)
+    {
+        push(20.0f + i);
+        fast.more();
+    }
+    CHECK(fast.more() == 0 && !fast.ended);
+    CHECK(slow.more() == 0 && slow.ended);
+    slow.disconnect();
+
+    fast.body.clear();
+    push(30.0f);
+    fast.more();
+    CHECK(has(fast, "\"temp_c\":30.0"));
+    CHECK(has(host_http(HTTP_GET, "/"), "sse_drops = 1"));
+    fast.disconnect();
+}
+
+TEST(subscribers_are_limited)
+{
+    firmware_setup();
+    std::vector<HostResponse> subs;
+    for (int i = 0; i < 4; i++)
+    {
+        subs.push_back(host_http(HTTP_GET, "/events"));
+        CHECK_EQ(subs.back().code, 200);
+    }
+    CHECK_EQ(host_http(HTTP_GET, "/events").code, 503);
+    subs.back().disconnect();
+    HostResponse r = host_http(HTTP_GET, "/events");
+    CHECK_EQ(r.code, 200);
+    r.disconnect();
+    for (int i = 0; i < 3; i++)
+        subs[i].disconnect();
+}
+
+TEST(set_applies_all_keys_or_none)
+{
+    firmware_setup();
+    HostResponse r = host_http(HTTP_GET, "/set?wind_calib=1.25&rain_event_max=12");
+    CHECK_EQ(r.code, 200);
+    CHECK_STR(r.body.c_str(), "OK wind_calib=1.25 rain_event_max=12");
+    CHECK_EQ(host_http(HTTP_GET, "/set?wind_calib=2&rain_event_max=0").code, 400); // Out of range
+    CHECK_NEAR(wdata.wind_calib, 1.25, 1e-6);
+    CHECK_EQ(wdata.rain_event_max, 12u);
+    CHECK_EQ(host_http(HTTP_GET, "/set?nothing=1").code, 400);
+}
+
+TEST(set_ignores_other_arguments_and_empty_values)
+{
+    firmware_setup();
+    strcpy(wdata.id, "station");
+    HostResponse r = host_http(HTTP_GET, "/set?_=1700000000&tag=%20Garden%20&id=");
+    CHECK_EQ(r.code, 200);
+    CHECK_STR(r.body.c_str(), "OK Garden");
+    CHECK_STR(wdata.tag, "Garden");
+    CHECK_STR(wdata.id, "station");
+    CHECK_EQ(host_http(HTTP_GET, "/set?tag=").code, 400);
+    CHECK_STR(wdata.tag, "Garden");
+}
+
+TEST(set_reports_a_failed_write_back)
+{
+    firmware_setup();
+    host_nvs_fail(0, 1);
+    HostResponse r = host_http(HTTP_GET, "/set?rain_event_max=6");
+    CHECK_EQ(r.code, 200);
+    CHECK_STR(r.body.c_str(), "OK 6 (not saved yet)");
+    CHECK(has(host_http(HTTP_GET, "/"), "nvs_errors = 1"));
+}
+
+TEST(root_and_json_answer_304_until_the_data_changes)
+{
+    firmware_setup();
+    push(15.0f);
+    for (const char *url : { "/", "/json" })
+    {
+        HostResponse r = host_http(HTTP_GET, url);
+        CHECK_EQ(r.code, 200);
+        CHECK(r.header("ETag") != NULL);
+        std::string etag = r.header("ETag");
+
+        r = host_http(HTTP_GET, url, { { "If-None-Match", etag } });
+        CHECK_EQ(r.code, 304);
+        CHECK(r.body.empty());
+        CHECK_STR(r.header("ETag"), etag.c_str());
+
+        push(15.5f); // A new generation of the weather data
+        r = host_http(HTTP_GET, url, { { "If-None-Match", etag } });
+        CHECK_EQ(r.code, 200);
+        CHECK(has(r, "15.5"));
+        CHECK(etag != r.header("ETag"));
+    }
+}
+
+TEST(pages_are_revalidated_with_their_etag)
+{
+    firmware_setup();
+    HostResponse r = host_http(HTTP_GET, "/dashboard");
+    CHECK_EQ(r.code, 200);
+    CHECK_STR(r.header("Cache-Control"), "no-cache");
+    CHECK(r.header("ETag") != NULL);
+    std::string etag = r.header("ETag");
+    r = host_http(HTTP_GET, "/dashboard", { { "If-None-Match", etag } });
+    CHECK_EQ(r.code, 304);
+    CHECK(r.body.empty());
+}
+
+TEST(assets_are_served_under_their_hash_and_never_revalidated)
+{
+    firmware_setup();
+    int immutable = 0;
+    for (size_t i = 0; i < WEB_ASSETS; i++)
+    {
+        const WebAsset& a = web_assets[i];
+        HostResponse r = host_http(HTTP_GET, a.path);
+        CHECK_EQ(r.code, 200);
+        CHECK_STR(r.header("Content-Encoding"), "gzip");
+        if (!a.immutable)
+        {
+            CHECK_STR(r.header("Cache-Control"), "no-cache");
+            continue;
+        }
+        immutable++;
+        CHECK_STR(r.header("Cache-Control"), "public, max-age=31536000, immutable");
+        std::string hash(a.etag + 1, strlen(a.etag) - 2); // Without the quotes
+        CHECK(strncmp(a.path, "/assets/", 8) == 0);
+        CHECK(strstr(a.path, ("." + hash + ".").c_str()) != NULL);
+    }
+    CHECK_EQ(immutable, 3);
+}
+
+TEST(flash_reports_an_upload_without_a_hash_as_unverified)
+{
+    firmware_setup();
+    std::string image(10000, '\x5A');
+    HostResponse r = host_http(HTTP_POST, "/flash", {}, image);
+    CHECK_EQ(r.body.compare(0, 18, "UNVERIFIED, sha256"), 0);
+    CHECK(Update.done);
+
+    const char *sha256 = strchr(r.body.c_str(), ' ') + 8;
+    std::string url = std::string("/flash?sha256=") + sha256;
+    r = host_http(HTTP_POST, url.c_str(), {}, image);
+    CHECK_STR(r.body.c_str(), "OK");
+
+    image[0] = 0;
+    r = host_http(HTTP_POST, url.c_str(), {}, image);
+    CHECK_STR(r.body.c_str(), "FAIL");
+}
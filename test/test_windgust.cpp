@@ -0,0 +1,63 @@
+#include "windgust.h"
+#include "check.h"
+
+// 0.25-sec samples and a 3-sec running mean, as the station uses
+#define SAMPLE_US   250000
+#define TIMEOUT_US  5000000
+typedef GustMeter<12> Meter;
+
+// Feed pulses at a constant frequency from start to end
+static void pulses(Meter& m, uint32_t start, uint32_t end, float hz)
+{
+    uint32_t period = uint32_t(1e6f / hz);
+    for (uint32_t t = start; int32_t(end - t) > 0; t += period)
+        m.pulse(t);
+    m.update(end);
+}
+
+TEST(calm_is_zero)
+{
+    Meter m(SAMPLE_US, TIMEOUT_US);
+    m.update(0);
+    m.update(10000000);
+    CHECK_EQ(m.get_and_clear_gust(), 0.0f);
+}
+
+TEST(steady_wind_frequency)
+{
+    Meter m(SAMPLE_US, TIMEOUT_US);
+    pulses(m, 0, 10000000, 8);
+    CHECK_NEAR(m.get_last(), 8, 0.01);
+    CHECK_NEAR(m.get_and_clear_gust(), 8, 0.1);
+    CHECK_EQ(m.get_and_clear_gust(), 0.0f); // Cleared
+}
+
+TEST(resolves_a_short_gust)
+{
+    // 2 Hz with a 3-sec burst at 20 Hz: the 3-sec mean reaches the burst frequency, which counting pulses over a
+    // 5-sec period would average down to about 13 Hz
+    Meter m(SAMPLE_US, TIMEOUT_US);
+    pulses(m, 0, 10000000, 2);
+    pulses(m, 10000000, 13000000, 20);
+    pulses(m, 13000000, 20000000, 2);
+    CHECK_NEAR(m.get_and_clear_gust(), 20, 1.5);
+}
+
+TEST(slow_pulses_decay_to_zero)
+{
+    Meter m(SAMPLE_US, TIMEOUT_US);
+    pulses(m, 0, 4000000, 4);
+    m.update(4000000 + 2000000);
+    CHECK(m.get_last() < 4);    // Stretched to the time since the last pulse
+    CHECK(m.get_last() > 0);
+    m.update(4000000 + TIMEOUT_US + SAMPLE_US);
+    CHECK_EQ(m.get_last(), 0.0f);
+}
+
+TEST(across_micros_wrap)
+{
+    Meter m(SAMPLE_US, TIMEOUT_US);
+    uint32_t start = 0xFFFFFFFFu - 3000000u;
+    pulses(m, start, start + 6000000u, 10);
+    CHECK_NEAR(m.get_last(), 10, 0.05);
+}
@@ -0,0 +1,81 @@
+#include "window.h"
+#include "check.h"
+#include <stdlib.h>
+
+// Both windows checked against a rescan of the last N samples, the way the aggregates were calculated before
+
+TEST(sum_starts_with_zero_samples)
+{
+    WindowSum<uint8_t, 8, uint32_t> w;
+    CHECK_EQ(w.get_sum(), 0u);
+    w.push(200);
+    w.push(200);
+    CHECK_EQ(w.get_sum(), 400u); // Summed in the wider type
+    CHECK_EQ(w.get_avg(), 50u);
+}
+
+TEST(sum_matches_rescan)
+{
+    const int N = 24;
+    WindowSum<int32_t, N> w;
+    int32_t samples[1000] = {};
+    srand(1);
+    for (int i = 0; i < 1000; i++)
+    {
+        samples[i] = rand() % 2001 - 1000;
+        w.push(samples[i]);
+        int32_t sum = 0;
+        for (int j = i; (j >= 0) && (j > i - N); j--)
+            sum += samples[j];
+        CHECK_EQ(w.get_sum(), sum);
+    }
+}
+
+TEST(float_sum_does_not_drift)
+{
+    // A million add/subtract pairs of values of very different magnitudes; the re-sum keeps the error bounded
+    WindowSum<float, 24> w;
+    srand(2);
+    for (int i = 0; i < 1000000; i++)
+        w.push((i % 7 == 0) ? 1e4f : float(rand() % 100) / 100);
+    // Once the window has turned over to new samples, it is back to what a rescan gives
+    for (int i = 0; i < 48 - 1000000 % 24; i++)
+        w.push(0.1f);
+    CHECK_NEAR(w.get_avg(), 0.1, 1e-6);
+}
+
+TEST(max_matches_rescan)
+{
+    const int N = 17;
+    WindowMax<float, N> w;
+    float samples[2000] = {};
+    srand(3);
+    for (int i = 0; i < 2000; i++)
+    {
+        // Runs of rising, falling and equal values exercise the deque in all directions
+        samples[i] = (i % 300 < 100) ? float(i % 100) : (i % 300 < 200) ? float(100 - i % 100) : float(rand() % 50);
+        w.push(samples[i]);
+        float max = 0; // The window starts out filled with zero samples
+        for (int j = i; j > i - N; j--)
+        {
+            float v = (j >= 0) ? samples[j] : 0;
+            if (v > max)
+                max = v;
+        }
+        CHECK_EQ(w.get_max(), max);
+    }
+}
+
+TEST(max_expires_old_peak)
+{
+    WindowMax<int, 4> w;
+    w.push(9);
+    w.push(1);
+    w.push(2);
+    w.push(3);
+    CHECK_EQ(w.get_max(), 9);
+    w.push(0);
+    CHECK_EQ(w.get_max(), 3);
+    w.clear();
+    CHECK_EQ(w.get_max(), 0);
+}
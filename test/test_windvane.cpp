@@ -0,0 +1,59 @@
+#include "windvane.h"
+#include "check.h"
+
+// Deterministic noise in [-amp, amp]
+static int noise(uint32_t& seed, int amp)
+{
+    seed = seed * 1103515245u + 12345u;
+    return int((seed >> 16) % uint32_t(2 * amp + 1)) - amp;
+}
+
+TEST(default_calibration_maps_each_centroid)
+{
+    WindVane vane;
+    for (int d = 0; d < VANE_DIRS; d++)
+        CHECK_EQ(vane.dir(vane_default_adc[d]), d);
+    CHECK_EQ(vane.dir(-5), 5);      // Clamped to the lowest reading, 112.5 deg
+    CHECK_EQ(vane.dir(5000), 12);   // Clamped to the highest reading, 270 deg
+}
+
+// The measured ADC ranges of the vane are a few counts wide; the closest centroid has to win well beyond that, up to
+// about a third of the way to the nearest other direction (the 143/176 pair is the closest at 33 counts)
+TEST(noisy_readings_keep_their_direction)
+{
+    WindVane vane;
+    uint32_t seed = 1;
+    int wrong = 0;
+    for (int i = 0; i < 16000; i++)
+    {
+        int d = i % VANE_DIRS;
+        if (vane.dir(vane_default_adc[d] + noise(seed, 12)) != d)
+            wrong++;
+    }
+    CHECK_EQ(wrong, 0);
+}
+
+// Each reading is learned as the direction it is closest to, so the shift has to stay within half the distance between
+// two directions; the running mean then ends up close to the new value
+TEST(calibration_learns_shifted_centroids)
+{
+    // A vane with a different pullup: every reading is 2% lower than the default table, and noisy
+    WindVane vane;
+    vane.cal_start();
+    uint32_t seed = 7;
+    bool done = false;
+    for (int i = 0; (i < 100000) && !done; i++)
+    {
+        int d = i % VANE_DIRS;
+        done = vane.cal_sample(vane_default_adc[d] * 98 / 100 + noise(seed, 3));
+    }
+    CHECK(done);
+    CHECK(!vane.cal_running());
+    for (int d = 0; d < VANE_DIRS; d++)
+    {
+        int expected = vane_default_adc[d] * 98 / 100;
+        int got = vane.get_calibration()[d];
+        CHECK((got >= expected - 10) && (got <= expected + 10));
+        CHECK_EQ(vane.dir(expected), d);
+    }
+}
@@ -0,0 +1,209 @@
+#include "main.h"
+#include "wsbin.h"
+#include "check.h"
+#include <ESPAsyncWebSrv.h>
+#include <string.h>
+#include <map>
+#include <string>
+
+void setup();
+
+static WsBinSample sample()
+{
+    WsBinSample s = {};
+    s.flags = WSBIN_FLAG_VALID;
+    s.generation = 1234;
+    s.uptime = 86400;
+    s.temp_c_calib = -0.5f;
+    s.temp_c = 21.25f;
+    s.temp_f = 70.25f;
+    s.pressure = 1013.2f;
+    s.humidity = 45.5f;
+    s.wind_peak = 30.1f;
+    s.wind_rt = 12.5f;
+    s.wind_avg = 10.0f;
+    s.wind_dir_rt = 7;
+    s.wind_dir_avg = 270;
+    s.rain_calib = 0.021f;
+    s.rain_rate = 100;
+    s.rain_event = 5;
+    s.rain_event_cnt = 2;
+    s.rain_total = 100000;
+    s.wind_calib = 1.492f;
+    s.rain_event_max = 24;
+    s.heap_free = 150000;
+    s.heap_largest = 110000;
+    s.heap_min = 90000;
+    for (int i = 0; i < WSBIN_STACKS; i++)
+        s.stack_free[i] = 1000 + i;
+    strcpy(s.id, "station-1");
+    strcpy(s.tag, "Back yard");
+    return s;
+}
+
+TEST(round_trip)
+{
+    WsBinSample s = sample(), d;
+    uint8_t buf[WSBIN_MAX_LEN];
+    size_t len = wsbin_encode(buf, sizeof(buf), s);
+    CHECK_EQ(len, size_t(WSBIN_FIXED_LEN + 1 + 9 + 1 + 9));
+    CHECK(wsbin_decode(buf, len, d));
+    CHECK_EQ(d.generation, s.generation);
+    CHECK_EQ(d.uptime, s.uptime);
+    CHECK_EQ(d.temp_c, s.temp_c);
+    CHECK_EQ(d.pressure, s.pressure);
+    CHECK_EQ(d.wind_dir_avg, s.wind_dir_avg);
+    CHECK_EQ(d.rain_total, s.rain_total);
+    CHECK_EQ(d.wind_calib, s.wind_calib);
+    CHECK_EQ(d.rain_event_max, s.rain_event_max);
+    CHECK_EQ(d.heap_min, s.heap_min);
+    CHECK_EQ(d.stack_free[WSBIN_STACKS - 1], s.stack_free[WSBIN_STACKS - 1]);
+    CHECK_STR(d.id, s.id);
+    CHECK_STR(d.tag, s.tag);
+}
+
+TEST(decodes_version_1)
+{
+    // A version 1 station sends the fixed part up to rain_total
+    WsBinSample s = sample(), d;
+    uint8_t buf[WSBIN_MAX_LEN], tmp[WSBIN_MAX_LEN];
+    size_t len = wsbin_encode(tmp, sizeof(tmp), s);
+    size_t strings = len - WSBIN_FIXED_LEN;
+    memcpy(buf, tmp, WSBIN_FIXED_LEN_V1);
+    memcpy(buf + WSBIN_FIXED_LEN_V1, tmp + WSBIN_FIXED_LEN, strings);
+    buf[2] = 1;
+    wsbin_put16(buf + 4, WSBIN_FIXED_LEN_V1 + strings);
+    wsbin_put16(buf + 6, WSBIN_FIXED_LEN_V1);
+    CHECK(wsbin_decode(buf, WSBIN_FIXED_LEN_V1 + strings, d));
+    CHECK_EQ(d.rain_total, s.rain_total);
+    CHECK_EQ(d.wind_calib, 0.0f);
+    CHECK_EQ(d.heap_free, 0u);
+    CHECK_STR(d.tag, s.tag);
+}
+
+TEST(little_endian_layout)
+{
+    WsBinSample s = sample();
+    uint8_t buf[WSBIN_MAX_LEN];
+    wsbin_encode(buf, sizeof(buf), s);
+    CHECK(buf[0] == 'W' && buf[1] == 'S' && buf[2] == WSBIN_VERSION);
+    CHECK_EQ(buf[12], 0x80); // 86400 = 0x15180
+    CHECK_EQ(buf[13], 0x51);
+    CHECK_EQ(buf[14], 0x01);
+}
+
+TEST(newer_version_with_longer_fixed_part)
+{
+    // A newer station appends a field: an old decoder still reads what it knows
+    WsBinSample s = sample(), d;
+    uint8_t buf[WSBIN_MAX_LEN + 4], tmp[WSBIN_MAX_LEN];
+    size_t len = wsbin_encode(tmp, sizeof(tmp), s);
+    memcpy(buf, tmp, WSBIN_FIXED_LEN);
+    memset(buf + WSBIN_FIXED_LEN, 0xAA, 4);
+    memcpy(buf + WSBIN_FIXED_LEN + 4, tmp + WSBIN_FIXED_LEN, len - WSBIN_FIXED_LEN);
+    buf[2] = WSBIN_VERSION + 1;
+    wsbin_put16(buf + 4, len + 4);
+    wsbin_put16(buf + 6, WSBIN_FIXED_LEN + 4);
+    CHECK(wsbin_decode(buf, len + 4, d));
+    CHECK_EQ(d.rain_total, s.rain_total);
+    CHECK_STR(d.tag, s.tag);
+}
+
+TEST(rejects_invalid)
+{
+    WsBinSample s = sample(), d;
+    uint8_t buf[WSBIN_MAX_LEN];
+    size_t len = wsbin_encode(buf, sizeof(buf), s);
+    CHECK(!wsbin_decode(buf, len - 1, d));      // Truncated
+    CHECK(!wsbin_decode(buf, 4, d));
+    uint8_t bad[WSBIN_MAX_LEN];
+    memcpy(bad, buf, len);
+    bad[0] = 'X';
+    CHECK(!wsbin_decode(bad, len, d));
+    memcpy(bad, buf, len);
+    bad[WSBIN_FIXED_LEN] = 200;                 // String longer than the message
+    CHECK(!wsbin_decode(bad, len, d));
+    CHECK_EQ(wsbin_encode(buf, WSBIN_MAX_LEN - 1, s), size_t(0));
+}
+
+// Every field of /json, top level and in stack_free, by name
+static std::map<std::string, double> json_fields(const std::string& json)
+{
+    std::map<std::string, double> fields;
+    std::string prefix;
+    for (size_t pos = 0; (pos = json.find('"', pos)) != std::string::npos; )
+    {
+        size_t end = json.find('"', pos + 1);
+        std::string name = json.substr(pos + 1, end - pos - 1);
+        pos = end + 1;
+        if (json[pos] != ':')
+            continue;
+        char c = json[pos + 1];
+        if (c == '{')
+        {
+            prefix = name + ".";
+            continue;
+        }
+        if (c == '"')
+        {
+            fields[prefix + name] = 0; // id and tag, compared as strings
+            pos = json.find('"', pos + 2) + 1;
+        }
+        else
+            fields[prefix + name] = (c == 't') ? 1 : (c == 'f') ? 0 : strtod(&json[pos + 1], NULL);
+        if (json[json.find_first_of(",}", pos)] == '}')
+            prefix.clear();
+    }
+    return fields;
+}
+
+TEST(bin_carries_every_json_field)
+{
+    setup();
+    wdata_lock(portMAX_DELAY);
+    wdata.seconds = 3600;
+    wdata.temp_c = 21.37f;
+    wdata.pressure = 1002.5f;
+    wdata.wind_calib = 1.4925f;
+    wdata.rain_calib = 0.0123f;
+    wdata.rain_event_max = 36;
+    wdata.rain_total = 4321;
+    strcpy(wdata.id, "station-7");
+    wdata_publish();
+    wdata_unlock();
+    mem_update();
+
+    HostResponse json = host_http(HTTP_GET, "/json"), bin = host_http(HTTP_GET, "/bin");
+    WsBinSample d;
+    CHECK(wsbin_decode((const uint8_t *)bin.body.data(), bin.body.size(), d));
+    CHECK(d.flags & WSBIN_FLAG_VALID);
+
+    std::map<std::string, double> decoded = {
+        { "id", 0 }, { "tag", 0 }, { "uptime", d.uptime }, { "heap_free", d.heap_free },
+        { "heap_largest", d.heap_largest }, { "heap_min", d.heap_min },
+        { "mem_low", (d.flags & WSBIN_FLAG_MEM_LOW) ? 1 : 0 }, { "temp_c_calib", d.temp_c_calib },
+        { "temp_c", d.temp_c }, { "temp_f", d.temp_f }, { "pressure", d.pressure }, { "humidity", d.humidity },
+        { "wind_calib", d.wind_calib }, { "wind_peak", d.wind_peak }, { "wind_rt", d.wind_rt },
+        { "wind_avg", d.wind_avg }, { "wind_dir_rt", d.wind_dir_rt }, { "wind_dir_avg", d.wind_dir_avg },
+        { "rain_calib", d.rain_calib }, { "rain_rate", d.rain_rate }, { "rain_event", d.rain_event },
+        { "rain_event_max", d.rain_event_max }, { "rain_event_cnt", d.rain_event_cnt },
+        { "rain_total", d.rain_total } };
+    for (int i = 0; i < WSBIN_STACKS; i++)
+        decoded[std::string("stack_free.") + mem_task_name(i)] = d.stack_free[i];
+
+    // The same fields, and the same values to the precision of /json
+    std::map<std::string, double> fields = json_fields(json.body);
+    CHECK_EQ(fields.size(), decoded.size());
+    for (auto& f : fields)
+    {
+        if (!decoded.count(f.first))
+        {
+            printf("/bin is missing %s\n", f.first.c_str());
+            CHECK(false);
+        }
+        else
+            CHECK_NEAR(decoded[f.first], f.second, 0.006);
+    }
+    CHECK_STR(d.id, "station-7");
+    CHECK(json.body.find(std::string("\"tag\":\"") + d.tag + "\"") != std::string::npos);
+}
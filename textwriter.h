@@ -0,0 +1,104 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Text serializer writing into a caller-provided (static) buffer, without any heap allocation. The output is always
+// zero-terminated; if the buffer fills up, the output is truncated and overflow() returns true.
+class TextWriter
+{
+public:
+    TextWriter(char *buffer, size_t size) : buf(buffer), size(size), len(0), ovf(false) { buf[0] = 0; }
+
+    void clear() { len = 0; ovf = false; buf[0] = 0; }
+    const char *c_str() const { return buf; }
+    size_t length() const { return len; }
+    bool overflow() const { return ovf; }
+
+    TextWriter& str(const char *s) { return put(s, strlen(s)); }
+
+    TextWriter& put(const char *s, size_t n)
+    {
+        if (len + n >= size)
+        {
+            n = size - 1 - len;
+            ovf = true;
+        }
+        memcpy(buf + len, s, n);
+        len += n;
+        buf[len] = 0;
+        return *this;
+    }
+
+    TextWriter& u32(uint32_t value)
+    {
+        char tmp[10];
+        int i = sizeof(tmp);
+        do
+        {
+            tmp[--i] = '0' + (value % 10);
+            value /= 10;
+        } while (value);
+        return put(tmp + i, sizeof(tmp) - i);
+    }
+
+    TextWriter& i32(int32_t value)
+    {
+        if (value < 0)
+        {
+            put("-", 1);
+            return u32(uint32_t(0) - uint32_t(value));
+        }
+        return u32(uint32_t(value));
+    }
+
+    // Lowercase hex without leading zeros, the same as String(value, HEX)
+    TextWriter& hex(uint32_t value)
+    {
+        char tmp[8];
+        int i = sizeof(tmp);
+        do
+        {
+            tmp[--i] = "0123456789abcdef"[value & 0xF];
+            value >>= 4;
+        } while (value);
+        return put(tmp + i, sizeof(tmp) - i);
+    }
+
+    // Fixed-point float formatting with the given number of decimal places (max 6), rounded the same way as
+    // String(value, decimals). Values too large for the integer fast path fall back to snprintf on the stack.
+    TextWriter& fixed(float value, int decimals = 2)
+    {
+        static const uint32_t scale[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+        if (value != value)
+            return put("nan", 3);
+        bool neg = value < 0;
+        double v = (neg ? -double(value) : double(value)) * scale[decimals] + 0.5;
+        if (v >= 4294967295.0)
+        {
+            char tmp[48];
+            int n = snprintf(tmp, sizeof(tmp), "%.*f", decimals, double(value));
+            return put(tmp, (n <= 0) ? 0 : (size_t(n) < sizeof(tmp)) ? size_t(n) : sizeof(tmp) - 1);
+        }
+        uint32_t n = uint32_t(v);
+        if (neg && n)
+            put("-", 1);
+        u32(n / scale[decimals]);
+        if (decimals)
+        {
+            char tmp[7];
+            uint32_t frac = n % scale[decimals];
+            for (int i = decimals - 1; i >= 0; i--, frac /= 10)
+                tmp[i] = '0' + (frac % 10);
+            put(".", 1);
+            put(tmp, decimals);
+        }
+        return *this;
+    }
+
+private:
+    char *buf;
+    size_t size;
+    size_t len;
+    bool ovf;
+};
@@ -0,0 +1,81 @@
+// Replay a recorded trace (see trace.h) through the weather calculation, off-device and as fast as the host can run it
+//   replay storm.wst        print the weather data of every 5-sec period as CSV
+//   replay -q storm.wst     print only the summary
+// The calculation is the very same code the station runs (weathercalc.cpp), set up with the configuration recorded in
+// the trace, so a storm can be replayed to check a change to the calculation against what the station saw.
+#include "weathercalc.h"
+#include "windvane.h"
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+    bool quiet = (argc == 3) && (strcmp(argv[1], "-q") == 0);
+    if (argc != 2 + quiet)
+    {
+        fprintf(stderr, "Usage: %s [-q] <trace.wst>\n", argv[0]);
+        return 2;
+    }
+    FILE *f = fopen(argv[1 + quiet], "rb");
+    if (!f)
+    {
+        perror(argv[1 + quiet]);
+        return 1;
+    }
+    std::vector<uint8_t> t;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+        t.insert(t.end(), chunk, chunk + n);
+    fclose(f);
+    if (!trace_check_header(t.data(), t.size()))
+    {
+        fprintf(stderr, "%s: not a trace of version %d\n", argv[1 + quiet], TRACE_VERSION);
+        return 1;
+    }
+
+    // The defaults of a station that was never configured, for a trace without a setup record
+    static WeatherCalc calc;
+    static WeatherData wd = {};
+    wd.wind_calib = WIND_FACTOR_MPH;
+    wd.rain_event_max = 24;
+    memcpy(wd.vane_adc, vane_default_adc, sizeof(wd.vane_adc));
+
+    if (!quiet)
+        printf("seconds,temp_c,pressure,humidity,wind_rt,wind_avg,wind_peak,wind_dir_rt,wind_dir_avg,rain_rate,"
+               "rain_event,rain_total\n");
+    static RawSample r;
+    TraceSetup setup;
+    size_t pos = TRACE_HDR_LEN;
+    uint32_t samples = 0, setups = 0, first = 0;
+    int rc;
+    auto start = std::chrono::steady_clock::now();
+    while ((rc = trace_decode(t.data(), t.size(), pos, r, &setup)) > 0)
+    {
+        if (rc == TRACE_SETUP)
+        {
+            calc.set_setup(setup, wd);
+            setups++;
+            continue;
+        }
+        if (samples++ == 0)
+        {
+            first = r.seconds;
+            wd.seconds = r.seconds; // Not an hour boundary
+        }
+        if ((calc.process(r, wd) >= 0) && !quiet)
+            printf("%u,%.2f,%.2f,%.1f,%.2f,%.2f,%.2f,%d,%d,%u,%u,%u\n", wd.seconds, wd.temp_c, wd.pressure,
+                   wd.humidity, wd.wind_rt, wd.wind_avg, wd.wind_peak, wd.wind_dir_rt, wd.wind_dir_avg, wd.rain_rate,
+                   wd.rain_event, wd.rain_total);
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (rc < 0)
+        fprintf(stderr, "Trace is not valid at byte %zu\n", pos);
+
+    uint32_t span = samples ? wd.seconds - first + 1 : 0;
+    fprintf(stderr, "%u samples (%u s of the station) and %u setups replayed in %.3f s, %.0fx real time\n",
+            samples, span, setups, sec, (sec > 0) ? span / sec : 0.0);
+    return (rc < 0);
+}
@@ -0,0 +1,116 @@
+// Recording of the raw sensor inputs, streamed out to a single client at /trace
+// The aggregation task appends the encoded samples into a lock-free ring and the web server drains it into the response
+// as the client reads it, so a slow client never blocks the aggregation task. When the ring is full, the samples are
+// dropped and a gap record tells how many bytes were lost. Nothing is recorded while no client is connected.
+#include "main.h"
+#include <atomic>
+
+#define TRACE_RING_SIZE  4096 // About half a minute of samples in a storm
+
+// A client starts a new session. The ring is drained for it only once the aggregation task has acknowledged the
+// session: it acknowledges between two samples, so by then the last record of the previous client is complete and the
+// drain can not leave half of it for the new client. The aggregation task then waits for the drain before appending.
+static SpscRing<uint8_t, TRACE_RING_SIZE> trace_ring;
+static volatile bool trace_on = false;  // A client is connected
+static std::atomic<uint32_t> trace_session(0); // Session of the connected client, set by the web server
+static std::atomic<uint32_t> trace_acked(0);   // Session the aggregation task appends to
+static std::atomic<uint32_t> trace_drained(0); // Session the ring was drained for, set by the web server
+static bool trace_hdr_sent;             // The header has been sent to the client, only used by the web server
+static uint32_t trace_lost = 0;         // Bytes lost since the last gap record, only used by the aggregation task
+static bool trace_setup_sent;           // The setup record was appended in this session, only used by aggregation
+static TraceSetup trace_setup;          // Last setup appended, only used by the aggregation task
+static uint8_t trace_rec[TRACE_REC_MAX];// Record being appended, only used by the aggregation task
+
+static bool trace_append(const uint8_t *buf, size_t len)
+{
+    if (trace_ring.space() < len)
+        return false;
+    for (size_t i = 0; i < len; i++)
+        trace_ring.push(buf[i]);
+    return true;
+}
+
+// Append a record, or count it as lost if it does not fit; a gap record goes first if anything was lost before
+static void trace_record(size_t len)
+{
+    if (trace_lost)
+    {
+        uint8_t gap[8];
+        if (!trace_append(gap, trace_encode_gap(gap, trace_lost)))
+        {
+            trace_lost += len;
+            return;
+        }
+        trace_lost = 0;
+    }
+    if (!trace_append(trace_rec, len))
+        trace_lost += len;
+}
+
+// Append a sample to the trace, preceded by the setup when it changed; called by the aggregation task every tick
+void trace_sample(const RawSample& r, const TraceSetup& setup)
+{
+    if (!trace_on)
+        return;
+    uint32_t session = trace_session.load(std::memory_order_acquire);
+    if (trace_acked.load(std::memory_order_relaxed) != session)
+    {
+        // A new client: nothing lost so far and the setup goes first, once the ring was drained for it
+        trace_lost = 0;
+        trace_setup_sent = false;
+        trace_acked.store(session, std::memory_order_release);
+        return;
+    }
+    if (trace_drained.load(std::memory_order_acquire) != session)
+        return;
+
+    if (!trace_setup_sent || memcmp(&setup, &trace_setup, sizeof(setup)))
+    {
+        trace_setup = setup;
+        trace_setup_sent = true;
+        trace_record(trace_encode_setup(trace_rec, setup));
+    }
+    trace_record(trace_encode(trace_rec, r));
+}
+
+// Start streaming the trace; returns false if another client is already reading it
+bool trace_start()
+{
+    if (trace_on)
+        return false;
+    trace_session.fetch_add(1, std::memory_order_release);
+    trace_hdr_sent = false;
+    trace_on = true;
+    return true;
+}
+
+void trace_stop()
+{
+    trace_on = false;
+}
+
+// Fill the buffer with the next part of the trace; returns 0 if there is nothing new to send yet
+size_t trace_read(uint8_t *buf, size_t size)
+{
+    uint32_t session = trace_session.load(std::memory_order_relaxed);
+    if (trace_drained.load(std::memory_order_relaxed) != session)
+    {
+        if (trace_acked.load(std::memory_order_acquire) != session)
+            return 0; // The aggregation task may still be appending for the previous client
+        uint8_t b;
+        while (trace_ring.pop(b))
+            ; // Discard the tail of the previous trace
+        trace_drained.store(session, std::memory_order_release);
+    }
+
+    size_t len = 0;
+    if (!trace_hdr_sent && (size >= TRACE_HDR_LEN))
+    {
+        trace_header(buf);
+        trace_hdr_sent = true;
+        len = TRACE_HDR_LEN;
+    }
+    while ((len < size) && trace_ring.pop(buf[len]))
+        len++;
+    return len;
+}
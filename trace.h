@@ -0,0 +1,266 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Raw inputs of the weather calculation and their trace format
+// The acquisition task reads all inputs of one 1-sec tick into a RawSample and the aggregation task derives the weather
+// data only from that, so a recorded trace of the samples can be fed through the same calculation again. This header
+// has no dependencies on Arduino, so the trace can be decoded off-device.
+//
+// A trace is a stream of bytes that is only ever appended to: a 5-byte header followed by records. All values are
+// little-endian. Each record starts with a type byte and a 2-byte payload length, so a reader can skip the record
+// types it does not know about, and a trace cut off at any point is still valid up to its last complete record.
+//
+//  Header:  "WSTR", version (TRACE_VERSION)
+//  Record:  type (TRACE_*), payload length (u16), payload
+//
+//  TRACE_SAMPLE payload:
+//   u32 seconds, u32 time (micros), u8 flags (RAW_*), u32 anem_count, u32 rain_count,
+//   u8 anem_n, u8 rain_n, then anem_n + rain_n pulse times, each as a varint of (time - pulse time), u16 wind_dir_adc
+//   If RAW_SENSORS is set: 8 bytes bme, f32 dht_temp, f32 dht_hum
+//  TRACE_GAP payload:
+//   u32 number of bytes lost because the trace could not be sent out fast enough
+//  TRACE_SETUP payload, written at the start of a trace and whenever the configuration changes:
+//   u8 flags (TRACE_SETUP_*), 32 bytes BME280 trim registers, f32 wind_calib, f32 temp_c_calib, u32 rain_event_max,
+//   16 x u16 vane_adc
+
+#define TRACE_VERSION   2
+#define TRACE_HDR_LEN   5
+#define TRACE_SAMPLE    1
+#define TRACE_GAP       2
+#define TRACE_SETUP     3
+#define TRACE_TRIM_LEN  32   // BME280 trim registers 0x88-0x9F, 0xA1 and 0xE1-0xE7
+#define TRACE_SETUP_LEN (1 + TRACE_TRIM_LEN + 12 + 2 * 16)
+#define TRACE_SETUP_BME 0x01 // The BME280 trim registers are valid
+
+#define RAW_ANEM_MAX    128 // Max anemometer pulse times in one tick
+#define RAW_RAIN_MAX    16  // Max rain gauge tip times in one tick
+#define TRACE_REC_MAX   (3 + 19 + 5 * (RAW_ANEM_MAX + RAW_RAIN_MAX) + 2 + 16) // Longest record
+
+#define RAW_SENSORS     0x01 // 5-sec tick: the sensors below were read
+#define RAW_BME         0x02 // BME280 is used
+#define RAW_BME_OK      0x04 // BME280 data registers were read
+#define RAW_DHT         0x08 // DHT22 is used
+#define RAW_DHT_OK      0x10 // DHT22 was read
+
+struct RawSample
+{
+    uint32_t seconds;       // Uptime seconds of the tick
+    uint32_t time;          // Time of the tick in microseconds; all pulses before it are in this sample
+    uint8_t flags;
+    uint32_t anem_count;    // Anemometer pulses counted since the last tick
+    uint32_t rain_count;    // Rain gauge tips counted since the last tick
+    uint8_t anem_n;         // Number of anemometer pulse times
+    uint8_t rain_n;         // Number of rain gauge tip times
+    uint32_t anem_times[RAW_ANEM_MAX];
+    uint32_t rain_times[RAW_RAIN_MAX];
+    uint16_t wind_dir_adc;  // Wind vane ADC value, filtered over the last second
+    uint8_t bme[8];         // BME280 burst read of the data registers 0xF7-0xFE
+    float dht_temp;         // DHT22 temperature
+    float dht_hum;          // DHT22 humidity
+};
+
+// Configuration of the calculation that goes with the samples: a replay needs it to get the same results
+struct TraceSetup
+{
+    uint8_t flags;
+    uint8_t bme_trim[TRACE_TRIM_LEN];
+    float wind_calib;
+    float temp_c_calib;
+    uint32_t rain_event_max;
+    uint16_t vane_adc[16];
+};
+
+// Merge the next tick into a sample that could not be handed over, so that its pulses are not lost: the counts add up,
+// the pulse times are appended (as many as fit) and the sensor readings of a 5-sec tick are kept until newer ones
+static inline void raw_merge(RawSample& r, const RawSample& next)
+{
+    r.seconds = next.seconds;
+    r.time = next.time;
+    r.anem_count += next.anem_count;
+    r.rain_count += next.rain_count;
+    for (int i = 0; (i < next.anem_n) && (r.anem_n < RAW_ANEM_MAX); i++)
+        r.anem_times[r.anem_n++] = next.anem_times[i];
+    for (int i = 0; (i < next.rain_n) && (r.rain_n < RAW_RAIN_MAX); i++)
+        r.rain_times[r.rain_n++] = next.rain_times[i];
+    r.wind_dir_adc = next.wind_dir_adc;
+    if (next.flags & RAW_SENSORS)
+    {
+        r.flags = next.flags;
+        memcpy(r.bme, next.bme, sizeof(r.bme));
+        r.dht_temp = next.dht_temp;
+        r.dht_hum = next.dht_hum;
+    }
+}
+
+static inline void trace_header(uint8_t *buf)
+{
+    memcpy(buf, "WSTR", 4);
+    buf[4] = TRACE_VERSION;
+}
+
+static inline size_t trace_put_varint(uint8_t *p, uint32_t v)
+{
+    size_t n = 0;
+    while (v >= 0x80)
+    {
+        p[n++] = uint8_t(v) | 0x80;
+        v >>= 7;
+    }
+    p[n++] = uint8_t(v);
+    return n;
+}
+
+static inline size_t trace_put32(uint8_t *p, uint32_t v)
+{
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+    return 4;
+}
+
+static inline uint32_t trace_get32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24);
+}
+
+static inline bool trace_check_header(const uint8_t *buf, size_t len)
+{
+    return (len >= TRACE_HDR_LEN) && (memcmp(buf, "WSTR", 4) == 0) && (buf[4] == TRACE_VERSION);
+}
+
+// Encode a record; returns its length. The buffer should be at least TRACE_REC_MAX bytes.
+static inline size_t trace_encode_gap(uint8_t *buf, uint32_t lost)
+{
+    buf[0] = TRACE_GAP;
+    buf[1] = 4;
+    buf[2] = 0;
+    return 3 + trace_put32(buf + 3, lost);
+}
+
+static inline size_t trace_encode_setup(uint8_t *buf, const TraceSetup& s)
+{
+    size_t n = 3;
+    buf[n++] = s.flags;
+    memcpy(buf + n, s.bme_trim, TRACE_TRIM_LEN);
+    n += TRACE_TRIM_LEN;
+    memcpy(buf + n, &s.wind_calib, 4);
+    memcpy(buf + n + 4, &s.temp_c_calib, 4);
+    n += 8;
+    n += trace_put32(buf + n, s.rain_event_max);
+    for (int i = 0; i < 16; i++)
+    {
+        buf[n++] = s.vane_adc[i];
+        buf[n++] = s.vane_adc[i] >> 8;
+    }
+    buf[0] = TRACE_SETUP;
+    buf[1] = (n - 3);
+    buf[2] = (n - 3) >> 8;
+    return n;
+}
+
+static inline size_t trace_encode(uint8_t *buf, const RawSample& r)
+{
+    size_t n = 3;
+    n += trace_put32(buf + n, r.seconds);
+    n += trace_put32(buf + n, r.time);
+    buf[n++] = r.flags;
+    n += trace_put32(buf + n, r.anem_count);
+    n += trace_put32(buf + n, r.rain_count);
+    buf[n++] = r.anem_n;
+    buf[n++] = r.rain_n;
+    for (int i = 0; i < r.anem_n; i++)
+        n += trace_put_varint(buf + n, r.time - r.anem_times[i]);
+    for (int i = 0; i < r.rain_n; i++)
+        n += trace_put_varint(buf + n, r.time - r.rain_times[i]);
+    buf[n++] = r.wind_dir_adc;
+    buf[n++] = r.wind_dir_adc >> 8;
+    if (r.flags & RAW_SENSORS)
+    {
+        memcpy(buf + n, r.bme, 8);
+        n += 8;
+        memcpy(buf + n, &r.dht_temp, 4);
+        memcpy(buf + n + 4, &r.dht_hum, 4);
+        n += 8;
+    }
+    buf[0] = TRACE_SAMPLE;
+    buf[1] = (n - 3);
+    buf[2] = (n - 3) >> 8;
+    return n;
+}
+
+// Decode the next sample from the trace, starting at pos past the header. Records other than samples are skipped,
+// except the setup records if the caller asks for them. Returns 1 and advances pos if a sample was decoded, TRACE_SETUP
+// if a setup was decoded, 0 if more data is needed, or -1 if the trace is not valid.
+static inline int trace_decode(const uint8_t *buf, size_t len, size_t& pos, RawSample& r, TraceSetup *setup = NULL)
+{
+    for (;;)
+    {
+        if (pos + 3 > len)
+            return 0;
+        size_t plen = buf[pos + 1] | (buf[pos + 2] << 8);
+        if (pos + 3 + plen > len)
+            return 0;
+        const uint8_t *p = buf + pos + 3, *end = p + plen;
+        uint8_t type = buf[pos];
+        pos += 3 + plen;
+        if ((type == TRACE_SETUP) && setup)
+        {
+            if (plen < TRACE_SETUP_LEN)
+                return -1;
+            setup->flags = p[0];
+            memcpy(setup->bme_trim, p + 1, TRACE_TRIM_LEN);
+            p += 1 + TRACE_TRIM_LEN;
+            memcpy(&setup->wind_calib, p, 4);
+            memcpy(&setup->temp_c_calib, p + 4, 4);
+            setup->rain_event_max = trace_get32(p + 8);
+            p += 12;
+            for (int i = 0; i < 16; i++)
+                setup->vane_adc[i] = p[2 * i] | (p[2 * i + 1] << 8);
+            return TRACE_SETUP;
+        }
+        if (type != TRACE_SAMPLE)
+            continue;
+
+        if (plen < 19)
+            return -1;
+        r.seconds = trace_get32(p);
+        r.time = trace_get32(p + 4);
+        r.flags = p[8];
+        r.anem_count = trace_get32(p + 9);
+        r.rain_count = trace_get32(p + 13);
+        r.anem_n = p[17];
+        r.rain_n = p[18];
+        p += 19;
+        if ((r.anem_n > RAW_ANEM_MAX) || (r.rain_n > RAW_RAIN_MAX))
+            return -1;
+        for (int i = 0; i < r.anem_n + r.rain_n; i++)
+        {
+            uint32_t v = 0;
+            for (int shift = 0; ; shift += 7)
+            {
+                if ((p == end) || (shift > 28))
+                    return -1;
+                v |= uint32_t(*p & 0x7F) << shift;
+                if (!(*p++ & 0x80))
+                    break;
+            }
+            if (i < r.anem_n)
+                r.anem_times[i] = r.time - v;
+            else
+                r.rain_times[i - r.anem_n] = r.time - v;
+        }
+        if (end - p < 2)
+            return -1;
+        r.wind_dir_adc = p[0] | (p[1] << 8);
+        p += 2;
+        if (r.flags & RAW_SENSORS)
+        {
+            if (end - p < 16)
+                return -1;
+            memcpy(r.bme, p, 8);
+            memcpy(&r.dht_temp, p + 8, 4);
+            memcpy(&r.dht_hum, p + 12, 4);
+        }
+        return 1;
+    }
+}
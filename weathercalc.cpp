@@ -0,0 +1,218 @@
+#include "weathercalc.h"
+#include <math.h>
+#include <string.h>
+
+#ifndef RAD_TO_DEG
+#define RAD_TO_DEG  57.295779513082320876798154814105
+#endif
+
+// Time without an anemometer pulse that is considered calm
+#define GUST_TIMEOUT_US  (5 * 1000000UL)
+
+// Look up tables for wind direction polar system transformation, we only read 16 directions from the wind vane
+static const float tbl_sin[16] = {
+     0.000000, 0.382683, 0.707107, 0.923880, 1.000000, 0.923880, 0.707107, 0.382683,
+     0.000000,-0.382683,-0.707107,-0.923879,-1.000000,-0.923879,-0.707107,-0.382683 };
+static const float tbl_cos[16] = {
+     1.000000, 0.923880, 0.707107, 0.382683, 0.000000,-0.382683,-0.707107,-0.923880,
+    -1.000000,-0.923880,-0.707107,-0.382684, 0.000000, 0.382684, 0.707107, 0.923880 };
+
+WeatherCalc::WeatherCalc(ChangedFn changed) :
+    changed_fn(changed), have_trim(false), anem_count(0), rain_count(0), gust(GUST_SAMPLE_US, GUST_TIMEOUT_US),
+    rain_rate(PERIOD_RAIN_RATE * 1000000UL)
+{
+    memset(trim_regs, 0, sizeof(trim_regs));
+    memset(&trim, 0, sizeof(trim));
+}
+
+void WeatherCalc::set_bme280_trim(const uint8_t regs[TRACE_TRIM_LEN])
+{
+    memcpy(trim_regs, regs, TRACE_TRIM_LEN);
+    bme280_parse_trim(trim_regs, trim);
+    have_trim = true;
+}
+
+void WeatherCalc::get_setup(const WeatherData& wd, TraceSetup& s) const
+{
+    memset(&s, 0, sizeof(s)); // The setups are compared with memcmp, so the padding has to be clear as well
+    s.flags = have_trim ? TRACE_SETUP_BME : 0;
+    memcpy(s.bme_trim, trim_regs, TRACE_TRIM_LEN);
+    s.wind_calib = wd.wind_calib;
+    s.temp_c_calib = wd.temp_c_calib;
+    s.rain_event_max = wd.rain_event_max;
+    memcpy(s.vane_adc, wd.vane_adc, sizeof(s.vane_adc));
+}
+
+void WeatherCalc::set_setup(const TraceSetup& s, WeatherData& wd)
+{
+    if (s.flags & TRACE_SETUP_BME)
+        set_bme280_trim(s.bme_trim);
+    wd.wind_calib = s.wind_calib;
+    wd.temp_c_calib = s.temp_c_calib;
+    wd.rain_event_max = s.rain_event_max;
+    memcpy(wd.vane_adc, s.vane_adc, sizeof(wd.vane_adc));
+}
+
+// If the relative humidity was less than a cutoff value, a rain tip is a false rain positive and will be ignored
+// However, if the BME humidity sensor could not be read, ignore that check
+bool WeatherCalc::can_rain(const WeatherData& wd) const
+{
+    return (wd.error & ERROR_BME_READ) || (uint32_t(wd.humidity) >= CAN_RAIN_HUMIDITY_MIN);
+}
+
+int WeatherCalc::process(const RawSample& r, WeatherData& wd)
+{
+    float hz, mph;
+
+    // A sample may cover more than one tick when the acquisition had to merge them, so look for the hour boundary
+    // between the last sample and this one instead of at a given second
+    bool new_hour = (r.seconds / PERIOD_1_HR) != (wd.seconds / PERIOD_1_HR);
+    wd.seconds = r.seconds;
+    anem_count += r.anem_count;
+    rain_count += r.rain_count;
+
+    // Once an hour, adjust rain event counters and possibly reset rain_event value
+    if (new_hour)
+    {
+        wd.rain_event_cnt += 1; // Increment the counter by one hour and make sure it is safely stored in the NVM
+        changed(&wd.rain_event_cnt);
+        // Reset the rain_event only when the time since the last rain equals the reset limit. The counter will keep
+        // incrementing showing the number of hours since the last rain even after it had zeroed out the rain_event
+        if (wd.rain_event_cnt == wd.rain_event_max)
+        {
+            wd.rain_event = 0;
+            changed(&wd.rain_event);
+        }
+    }
+
+    // Every second, feed the anemometer pulses into the gust meter and store the highest 3-sec gust into its
+    // sliding window
+    for (int i = 0; i < r.anem_n; i++)
+        gust.pulse(r.anem_times[i]);
+    gust.update(r.time);
+    rt_peak.push(gust.get_and_clear_gust() * wd.wind_calib);
+
+    // Every second, feed the rain gauge tips into the rain rate estimator. The rain rate reacts to each new tip, and
+    // decays with the time since the last one.
+    for (int i = 0; (i < r.rain_n) && can_rain(wd); i++)
+        rain_rate.tip(r.rain_times[i]);
+
+    // Run the wind vane auto-calibration if the client asked for it. When it has learned all directions, the new
+    // calibration is stored in the NVM; if it is cancelled, go back to the stored calibration. Otherwise the vane
+    // follows the stored calibration, whoever changed it.
+    if (wd.vane_cal && !vane.cal_running())
+        vane.cal_start();
+    else if (!wd.vane_cal && vane.cal_running())
+        vane.cal_stop();
+    if (!vane.cal_running() && memcmp(vane.get_calibration(), wd.vane_adc, sizeof(wd.vane_adc)))
+        vane.set_calibration(wd.vane_adc);
+    if (vane.cal_sample(r.wind_dir_adc))
+    {
+        memcpy(wd.vane_adc, vane.get_calibration(), sizeof(wd.vane_adc));
+        changed(wd.vane_adc);
+        wd.vane_cal = 0;
+    }
+    wd.vane_cal_dirs = vane.cal_progress();
+
+    // Get and store wind vane direction
+    wd.wind_dir_adc = r.wind_dir_adc;
+    wd.wind_dir_rt = vane.dir(wd.wind_dir_adc);
+
+    // Make a wind vane vector from (direction, wind speed of this second)
+    uint32_t wdir = wd.wind_dir_rt;
+    float wrt = r.anem_count * wd.wind_calib;
+
+    // Store the new 1-sec wind direction into its sliding windows
+    rt_wdir_ew.push(wrt * tbl_sin[wdir]);
+    rt_wdir_ns.push(wrt * tbl_cos[wdir]);
+
+    // Once every 5 seconds, recalculate relevant data
+    if (!(r.flags & RAW_SENSORS))
+        return -1;
+
+    // Fill up WeatherData fields with the sensors' (and computed) data
+
+    // Temperature, humidity and pressure sensor
+    if (r.flags & RAW_BME)
+    {
+        if (r.flags & RAW_BME_OK)
+        {
+            Bme280Raw raw;
+            bme280_parse_data(r.bme, raw);
+
+            int32_t t_fine;
+            int32_t temp_cal = bme280_calc_t(trim, raw.temp, t_fine);
+            uint32_t press_cal = bme280_calc_p(trim, raw.pres, t_fine);
+            uint32_t hum_cal = bme280_calc_h(trim, raw.hum, t_fine);
+
+            wd.temp_c = float(temp_cal) / 100.0;
+            wd.temp_c += wd.temp_c_calib; // Apply calibration value
+            wd.temp_f = wd.temp_c * 9.0 / 5.0 + 32.0;
+            wd.pressure = float(press_cal) / 100.0;
+            wd.humidity = float(hum_cal) / 1024.0;
+        }
+        else
+            wd.error |= ERROR_BME_READ;
+    }
+    if (r.flags & RAW_DHT)
+    {
+        if (r.flags & RAW_DHT_OK)
+        {
+            wd.temp_c = r.dht_temp;
+            wd.temp_c += wd.temp_c_calib; // Apply calibration value
+            wd.temp_f = wd.temp_c * 9.0 / 5.0 + 32.0;
+            wd.pressure = 0;
+            wd.humidity = r.dht_hum;
+        }
+        else
+            wd.error |= ERROR_DHT_READ;
+    }
+
+    // The max peak wind over a 2-minute sliding window
+    wd.wind_peak = rt_peak.get_max();
+
+    // Calculate wind realitime, average over a 5-sec sampling period
+    wd.anem_count = anem_count;
+    hz = float(anem_count) / PERIOD_5_SEC;
+    mph = hz * wd.wind_calib;
+    wd.wind_rt = mph;
+    anem_count = 0;
+
+    // Store the new 5-sec real-time wind and get the average wind speed over a 2-minute sliding window
+    rt_avg.push(wd.wind_rt);
+    wd.wind_avg = rt_avg.get_avg();
+
+    // Calculate the average of wind directional vectors, a 2-minute sliding window
+    // http://www.webmet.com/met_monitoring/622.html
+    float wdir_ew = rt_wdir_ew.get_avg();
+    float wdir_ns = rt_wdir_ns.get_avg();
+    // From the (x,y) that is (ew,ns), compute the vector angle of the final average wind direction
+    float angle = atan2(wdir_ew, wdir_ns) * RAD_TO_DEG;
+    if (angle < 0)
+        angle = angle + 360;
+    wd.wind_dir_avg = int(angle) % 360;
+
+    // The rain gauge tips accumulated in the last 5-sec interval
+    wd.rain_test += rain_count; // Always increment the test counter
+    uint32_t rain_new = 0;
+    wd.rain_rate = lroundf(rain_rate.rate(r.time));
+    if (can_rain(wd))
+    {
+        rain_new = rain_count;
+
+        // Add the new rain volume to the current rain_event and the overall rain total and back the result up in the
+        // NVM. Do it only if there is new rain to add so that we don't write to NVM unnecessarily
+        if (rain_count)
+        {
+            wd.rain_event += rain_count;
+            wd.rain_total += rain_count;
+            wd.rain_event_cnt = 0; // Restart 'the number of hours since the last rain' counter
+            changed(&wd.rain_event);
+            changed(&wd.rain_total);
+            changed(&wd.rain_event_cnt);
+        }
+    }
+
+    rain_count = 0;
+    return rain_new;
+}
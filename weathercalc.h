@@ -0,0 +1,64 @@
+#pragma once
+#include <stdint.h>
+#include "weatherdata.h"
+#include "trace.h"
+#include "window.h"
+#include "rainrate.h"
+#include "windgust.h"
+#include "windvane.h"
+#include "bme280calc.h"
+
+// Calculation of the weather data from the raw inputs of each tick
+// This unit has no dependencies on Arduino: its state is all in the object, it works only on the raw sample and the
+// weather data it is given, and it reports the [NV] members it changes through a callback. The station runs it in the
+// aggregation task; a replay (see tools/replay.cpp) feeds a recorded trace through the very same code off-device.
+class WeatherCalc
+{
+public:
+    typedef void (*ChangedFn)(const void *member); // An [NV] member of the weather data changed
+
+    WeatherCalc(ChangedFn changed = 0);
+
+    // BME280 trimming parameters read from the sensor, as the registers (see bme280_parse_trim)
+    void set_bme280_trim(const uint8_t regs[TRACE_TRIM_LEN]);
+
+    // Calculate the weather data from the raw inputs of one tick. Returns the number of new rain tips when the 5-sec
+    // data was recalculated, or -1 otherwise.
+    int process(const RawSample& r, WeatherData& wd);
+
+    // The configuration that goes with the samples into a trace, and applying it again when replaying one
+    void get_setup(const WeatherData& wd, TraceSetup& s) const;
+    void set_setup(const TraceSetup& s, WeatherData& wd);
+
+private:
+    void changed(const void *member) { if (changed_fn) changed_fn(member); }
+    bool can_rain(const WeatherData& wd) const;
+
+    ChangedFn changed_fn;
+    bool have_trim;
+    uint8_t trim_regs[TRACE_TRIM_LEN];
+    Bme280Trim trim;
+
+    uint32_t anem_count;    // Anemometer pulses over the current 5-sec period
+    uint32_t rain_count;    // Rain gauge tips over the current 5-sec period
+
+    // Sliding window to calculate the average wind speed over a period of two minutes
+    static const int RT_AVG_MAX = 120 / PERIOD_5_SEC;
+    WindowSum<float, RT_AVG_MAX> rt_avg;
+
+    // Gust meter fed with the timestamps of the anemometer pulses
+    static const int GUST_SAMPLES = PERIOD_PEAK_WIND_SEC * 1000000 / GUST_SAMPLE_US;
+    GustMeter<GUST_SAMPLES> gust;
+
+    // Sliding window to keep the highest gust of each second over a period of two minutes
+    static const int RT_PEAK_MAX = 120;
+    WindowMax<float, RT_PEAK_MAX> rt_peak;
+
+    // Sliding window to calculate the average wind direction over a period of two minutes, from the 1-sec directions
+    static const int RT_WDIR_MAX = 120;
+    WindowSum<float, RT_WDIR_MAX> rt_wdir_ew; // Wind direction: East-West coordinate
+    WindowSum<float, RT_WDIR_MAX> rt_wdir_ns; // Wind direction: North-South coordinate
+
+    RainRate rain_rate;     // Rain rate estimator fed with the timestamps of the rain gauge tips
+    WindVane vane;          // Wind vane direction lookup, built from its calibration
+};
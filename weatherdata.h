@@ -0,0 +1,76 @@
+#pragma once
+#include <stdint.h>
+
+// The weather data the station calculates and serves, and the constants of its calculation
+// This header has no dependencies on Arduino, so the calculation (weathercalc.h) can be built and run off-device.
+
+// Period, in seconds, of one hour; to count when to clear the rain_event
+#define PERIOD_1_HR  (60 * 60)
+
+// Period, in seconds, to read sensors; and to calculate wind stats
+#define PERIOD_5_SEC  5
+
+// "The peak wind is a measurement of a burst or a gust of wind that one feels over a very short period of time.
+//  In the case of the peak wind, the very short period of time is usually three seconds."
+// http://prugarinc.com/weather-events/peak-wind-vs-maximum-wind-whats-the-difference
+// The anemometer speed is sampled 4 times a second and the peak is the max of the 3-sec running mean of those samples
+#define PERIOD_PEAK_WIND_SEC  3
+#define GUST_SAMPLE_US        250000
+
+// Rain rate is calculated from the interval between the rain gauge tips; it drops to zero after 10 min without a tip
+#define PERIOD_RAIN_RATE  (60 * 10)
+
+// This value deals with false rain positives when rain gauge tips due to various extraneous reasons
+// We are going to ignore any rain counts if the relative humidity is below this percentage since any real rain
+// would evaporate before reaching the ground. The reason this is not 100 (%) is to deal with possible corner cases.
+// XXX Quick summer rains can happen even when the humidity is quite low, so this check becomes at best questionable.
+#define CAN_RAIN_HUMIDITY_MIN  10
+
+#define WIND_FACTOR_MPH 1.492 // Relay tick to mph
+#define RAIN_FACTOR_IN  0.021 // Relay tick to inches of rain (initial best guess calibration value, rain_calib)
+
+// Maximum length of the station id and tag strings
+#define WD_STR_MAX  64
+
+// Weather data is a plain structure (no String members) so that it can be published as a snapshot by a simple copy
+struct WeatherData
+{
+    // Variables marked with [NV] are held in the non-volatile memory using Preferences
+    // The station does not do anything with the id and the tag; clients should use them to identify and name a station
+    char id[WD_STR_MAX + 1];  // [NV] Station identification string, held in the non-volatile memory
+    char tag[WD_STR_MAX + 1]; // [NV] Station description or a tag, held in the non-volatile memory
+    float temp_c;       // Current temperature in "C"
+    float temp_f;       // Current temperature in "F"
+    float pressure;     // Current pressure in "hPa"
+    float humidity;     // Current relative humidity in "%"
+
+    float wind_calib;   // [NV] Wind calibration factor (ticks to mph)
+    float wind_peak;    // Wind peak maximum value (max 3-sec gust) over a 2-min sliding window
+    float wind_rt;      // Wind realtime (5-sec averages)
+    float wind_avg;     // Wind speed average over a 5-sec sliding window
+    int wind_dir_adc;   // Wind direction sensor ADC value (median over the last second)
+    int wind_dir_rt;    // Wind real time direction, the median over the last second
+    int wind_dir_avg;   // Wind direction [0,360) averaged over a 2-min sliding window
+    uint16_t vane_adc[16];  // [NV] Wind vane calibration: ADC value of each direction
+    uint32_t vane_cal;      // Set to 1 to start the wind vane auto-calibration, reads 0 once it is done
+    uint32_t vane_cal_dirs; // Number of directions the auto-calibration has learned so far
+
+    // The station does not do anything with "rain_calib"; clients should use it as a single calbration reference
+    // when converting from the tip counters to inches of rain
+    float rain_calib;        // [NV] Rain calibration factor (ticks to in)
+    uint32_t rain_total;     // [NV] Rain total tip counter
+    uint32_t rain_event;     // [NV] Rain event tip counter
+    uint32_t rain_event_max; // [NV] The number of hours after which the station will reset the rain_event
+    uint32_t rain_event_cnt; // [NV] The number of hours since the last rain, to reset the rain_event
+    uint32_t rain_rate;      // Rain rate in tips "per hour", from the interval between the last rain tips
+    uint32_t rain_test;      // Rain test counter, unconditionally increments
+
+    // Misc logging and debug fields
+    uint32_t seconds;     // Uptime seconds counter (shown as "uptime" in web reports)
+    uint32_t anem_count;  // Anemometer count over the last 5 sec
+    uint32_t error;       // Bitfield where a non-zero bit indicates a particular error
+    float temp_c_calib;   // Correction to the temperature reading (some sensors run hot)
+#define ERROR_BME_INIT  0x00000001  // Error initializing BME sensor
+#define ERROR_BME_READ  0x00000002  // Error reading BME sensor value
+#define ERROR_DHT_READ  0x00000004  // Error reading DHT sensor value
+};
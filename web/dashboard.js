@@ -0,0 +1,34 @@
+// The page is static and cached by the browser; the data comes from the /events stream: a full "sample" on connect,
+// followed by "delta" messages with only the changed fields. A field may have a conversion from the value sent.
+var fields = [
+  ['temp_c', 'Temperature', '°C'], ['temp_f', 'Temperature', '°F'], ['pressure', 'Pressure', 'hPa'],
+  ['humidity', 'Humidity', '%'], ['wind_rt', 'Wind', 'mph'], ['wind_avg', 'Wind avg (2 min)', 'mph'],
+  ['wind_peak', 'Wind peak (2 min)', 'mph'],
+  ['wind_dir_rt', 'Direction', '°', function (v) { return v * 22.5; }], // Sent as the vane's 16 directions, 0-15
+  ['wind_dir_avg', 'Direction avg (2 min)', '°'], ['rain_rate', 'Rain rate', 'tips/h'],
+  ['rain_event', 'Rain event', 'tips'], ['rain_total', 'Rain total', 'tips'], ['uptime', 'Uptime', 's']];
+var table = document.getElementById('data');
+var cells = {}, convert = {};
+fields.forEach(function (f) {
+  var row = table.insertRow();
+  row.insertCell().textContent = f[1];
+  cells[f[0]] = row.insertCell();
+  row.insertCell().textContent = f[2];
+  if (f[3])
+    convert[f[0]] = f[3];
+});
+
+function update(e) {
+  var d = JSON.parse(e.data);
+  for (var k in d)
+    if (cells[k])
+      cells[k].textContent = convert[k] ? convert[k](d[k]) : d[k];
+  if (d.id !== undefined)
+    document.getElementById('title').textContent = d.id + (d.tag ? ' - ' + d.tag : '');
+  document.getElementById('status').textContent = 'Updated ' + new Date().toLocaleTimeString();
+}
+
+var es = new EventSource('/events');
+es.addEventListener('sample', update);
+es.addEventListener('delta', update);
+es.onerror = function () { document.getElementById('status').textContent = 'Reconnecting...'; };
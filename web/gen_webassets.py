@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+# Compress the static web pages into gzipped PROGMEM byte arrays in webassets.h
+# Run it after changing any of the pages: python3 web/gen_webassets.py
+# The assets are served as they are stored, with "Content-Encoding: gzip" and an ETag of their content.
+# The scripts and style sheets are served under a URL with the hash of their content, /assets/<name>.<hash>.<ext>, and
+# cached for a year without revalidation; a changed file gets a new URL. The pages refer to them as /assets/<file>, and
+# that reference is replaced with the hashed URL here. The pages themselves are the entry points with fixed URLs, so
+# they are sent with "no-cache": the browser revalidates them with a cheap 304, and picks up the new asset URLs after a
+# firmware update.
+import gzip
+import hashlib
+import os
+
+# Source file, URL path and content type of each asset; a path of None serves it under its hashed URL in /assets/
+# The pages come after the assets they refer to, so that their references can be replaced with the hashed URLs.
+ASSETS = [
+    ('dashboard.css', None, 'text/css'),
+    ('dashboard.js', None, 'application/javascript'),
+    ('upload.js', None, 'application/javascript'),
+    ('upload.html', '/upload', 'text/html'),
+    ('dashboard.html', '/dashboard', 'text/html'),
+]
+
+WEB_DIR = os.path.dirname(os.path.abspath(__file__))
+OUT = os.path.join(WEB_DIR, '..', 'webassets.h')
+
+
+def main():
+    out = []
+    out.append('// Generated by web/gen_webassets.py from the pages in web/, do not edit')
+    out.append('#pragma once')
+    out.append('#include <stdint.h>')
+    out.append('#include <pgmspace.h>')
+    out.append('')
+    out.append('struct WebAsset')
+    out.append('{')
+    out.append('    const char *path;       // URL path the asset is served at')
+    out.append('    const char *type;       // Content type')
+    out.append('    const uint8_t *data;    // Gzipped content, in flash')
+    out.append('    uint32_t len;')
+    out.append('    const char *etag;       // Hash of the content')
+    out.append('    bool immutable;         // Served under its hashed URL, and never revalidated')
+    out.append('};')
+    table = []
+    hashed = {}  # /assets/<file> to its hashed URL
+    for src, path, ctype in ASSETS:
+        with open(os.path.join(WEB_DIR, src), 'rb') as f:
+            raw = f.read()
+        for ref, url in hashed.items():
+            raw = raw.replace(ref.encode(), url.encode())
+        # mtime=0 keeps the output the same for the same input
+        data = gzip.compress(raw, compresslevel=9, mtime=0)
+        name = 'webasset_' + src.replace('.', '_').replace('-', '_')
+        etag = hashlib.sha256(raw).hexdigest()[:16]
+        immutable = path is None
+        if immutable:
+            stem, ext = os.path.splitext(src)
+            path = '/assets/%s.%s%s' % (stem, etag, ext)
+            hashed['/assets/' + src] = path
+        out.append('')
+        out.append('// %s: %u bytes, %u gzipped' % (src, len(raw), len(data)))
+        out.append('static const uint8_t %s[] PROGMEM = {' % name)
+        for i in range(0, len(data), 16):
+            out.append('    ' + ' '.join('0x%02x,' % b for b in data[i:i + 16]))
+        out.append('};')
+        table.append('    { "%s", "%s", %s, sizeof(%s), "\\"%s\\"", %s },' %
+                     (path, ctype, name, name, etag, 'true' if immutable else 'false'))
+    out.append('')
+    out.append('static const WebAsset web_assets[] = {')
+    out.extend(table)
+    out.append('};')
+    out.append('#define WEB_ASSETS  (sizeof(web_assets) / sizeof(web_assets[0]))')
+    with open(OUT, 'w', newline='\n') as f:
+        f.write('\n'.join(out) + '\n')
+    print('Wrote', os.path.normpath(OUT))
+
+
+if __name__ == '__main__':
+    main()
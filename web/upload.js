@@ -0,0 +1,18 @@
+document.getElementById('form').onsubmit = function (e) {
+  e.preventDefault();
+  var file = document.getElementById('file').files[0];
+  var prg = document.getElementById('prg');
+  if (!file)
+    return;
+  var data = new FormData();
+  data.append('update', file);
+  var xhr = new XMLHttpRequest();
+  xhr.open('POST', '/flash?sha256=' + encodeURIComponent(document.getElementById('sha256').value.trim()));
+  xhr.upload.onprogress = function (evt) {
+    if (evt.lengthComputable)
+      prg.textContent = 'Progress: ' + Math.round(evt.loaded / evt.total * 100) + '%';
+  };
+  xhr.onload = function () { prg.textContent = xhr.responseText; };
+  xhr.onerror = function () { prg.textContent = 'Upload failed'; };
+  xhr.send(data);
+};
@@ -0,0 +1,169 @@
+// Generated by web/gen_webassets.py from the pages in web/, do not edit
+#pragma once
+#include <stdint.h>
+#include <pgmspace.h>
+
+struct WebAsset
+{
+    const char *path;       // URL path the asset is served at
+    const char *type;       // Content type
+    const uint8_t *data;    // Gzipped content, in flash
+    uint32_t len;
+    const char *etag;       // Hash of the content
+    bool immutable;         // Served under its hashed URL, and never revalidated
+};
+
+// dashboard.css: 165 bytes, 147 gzipped
+static const uint8_t webasset_dashboard_css[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x2d, 0x8d, 0x4b, 0x0a, 0xc3, 0x30,
+    0x10, 0x43, 0xf7, 0x3d, 0xc5, 0x40, 0x36, 0xed, 0xc2, 0x25, 0xcd, 0xca, 0xd8, 0xa7, 0x99, 0xc4,
+    0xbf, 0x01, 0x7f, 0x8a, 0x3d, 0x25, 0x0d, 0xa5, 0x77, 0xaf, 0x4d, 0xba, 0x93, 0xd0, 0x93, 0xb4,
+    0x16, 0x73, 0xc0, 0x07, 0x5c, 0xc9, 0x2c, 0x1c, 0x26, 0x8a, 0x87, 0x82, 0x86, 0xb9, 0x89, 0x66,
+    0x2b, 0x39, 0x0d, 0x09, 0xab, 0xa7, 0xac, 0xe0, 0x61, 0x93, 0x86, 0xef, 0x85, 0x4d, 0x87, 0x9f,
+    0x68, 0x0c, 0x65, 0xaf, 0x60, 0xbe, 0x2f, 0x36, 0x8d, 0xe8, 0xaf, 0xe6, 0x13, 0x51, 0x99, 0x83,
+    0xd8, 0x02, 0x45, 0x73, 0x5d, 0x6e, 0x9d, 0x67, 0xfb, 0x66, 0x81, 0x91, 0x7c, 0xdf, 0xa9, 0xe4,
+    0x03, 0xeb, 0xf3, 0x6f, 0xb7, 0xc3, 0x28, 0x58, 0x4b, 0x34, 0xa3, 0x39, 0x35, 0x46, 0x7e, 0xb5,
+    0xde, 0xd8, 0x4a, 0x2c, 0x55, 0xc1, 0x24, 0xa5, 0x1c, 0xc1, 0x0f, 0x5f, 0xed, 0x58, 0x86, 0xa5,
+    0x00, 0x00, 0x00,
+};
+
+// dashboard.js: 1675 bytes, 783 gzipped
+static const uint8_t webasset_dashboard_js[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x95, 0x55, 0xdd, 0x6e, 0xd3, 0x30,
+    0x14, 0xbe, 0xcf, 0x53, 0x1c, 0x2a, 0xa1, 0xa4, 0xac, 0x4b, 0xb7, 0xa2, 0x71, 0xb1, 0xaa, 0x42,
+    0xb0, 0x0d, 0x01, 0x9a, 0x60, 0x5a, 0x87, 0xb8, 0xa8, 0xa2, 0xc9, 0x8b, 0x4f, 0x1a, 0xab, 0x89,
+    0x13, 0xd9, 0x4e, 0x4a, 0x35, 0xf5, 0x9d, 0x78, 0x06, 0x9e, 0x8c, 0x63, 0xe7, 0xa7, 0xa5, 0x30,
+    0x04, 0x17, 0x6d, 0xcf, 0xb1, 0x3f, 0x7f, 0xdf, 0xf9, 0xb3, 0x3b, 0x1e, 0xc3, 0x5d, 0x8a, 0x50,
+    0xb2, 0x25, 0x82, 0xd0, 0xa0, 0x0d, 0x33, 0x22, 0x06, 0x26, 0x39, 0xc4, 0x2c, 0x4e, 0x91, 0xc3,
+    0xc3, 0x06, 0x0c, 0x01, 0x1e, 0x54, 0xb1, 0xd6, 0xa8, 0xa6, 0xce, 0xe1, 0xcc, 0x30, 0x88, 0x8b,
+    0x1c, 0x35, 0x24, 0xaa, 0xc8, 0xdd, 0xda, 0x18, 0x6b, 0x94, 0xc6, 0x32, 0x28, 0x64, 0xf9, 0x39,
+    0x30, 0x48, 0xaa, 0x2c, 0x83, 0x81, 0x66, 0x79, 0x99, 0xe1, 0x00, 0x0a, 0x49, 0x27, 0xa4, 0xc4,
+    0xd8, 0x8c, 0xbc, 0xf1, 0x18, 0x92, 0x22, 0xcb, 0x8a, 0x75, 0xc3, 0x3f, 0xe0, 0x98, 0x19, 0x36,
+    0x00, 0xe2, 0xd3, 0x14, 0x87, 0x86, 0xb5, 0x30, 0x29, 0x1d, 0xc8, 0x1a, 0xe9, 0x38, 0x65, 0x72,
+    0x49, 0xc8, 0x44, 0x60, 0xc6, 0x75, 0x08, 0x6f, 0x1a, 0x0b, 0x72, 0xb6, 0x81, 0x94, 0xd5, 0x08,
+    0x36, 0x16, 0x59, 0xa3, 0xd2, 0x82, 0x44, 0xfa, 0x80, 0x6a, 0x96, 0x55, 0x08, 0x9a, 0x82, 0x0a,
+    0xbd, 0x9a, 0xa9, 0xf6, 0x38, 0xcc, 0x60, 0xe1, 0x01, 0x2c, 0x7c, 0x83, 0x79, 0x79, 0x1f, 0xfb,
+    0x23, 0xf0, 0xef, 0xc8, 0x42, 0xc5, 0x4c, 0xa5, 0xd0, 0xba, 0x3f, 0xbe, 0x5f, 0xf8, 0xd1, 0xa8,
+    0x43, 0x24, 0x7f, 0x44, 0xbc, 0x6b, 0x10, 0xa5, 0xa2, 0x88, 0xdb, 0xc5, 0x9b, 0x3d, 0x3b, 0xbd,
+    0x61, 0x04, 0x70, 0x32, 0x69, 0x95, 0x0b, 0x2e, 0xcc, 0xc6, 0x2e, 0xbf, 0xdf, 0xb3, 0x9f, 0x37,
+    0x0c, 0x6b, 0x21, 0xf9, 0xbd, 0x32, 0x76, 0xe5, 0x2b, 0x99, 0xf6, 0x37, 0x2f, 0xd3, 0xbd, 0x3d,
+    0x56, 0x2f, 0xbb, 0x4d, 0x20, 0x1b, 0x82, 0x09, 0xe4, 0x42, 0x0e, 0x77, 0x40, 0xa7, 0xe2, 0xa0,
+    0x25, 0xb2, 0x55, 0x8f, 0xb5, 0xce, 0xdf, 0xc0, 0x5c, 0xa8, 0x56, 0xf7, 0x52, 0x28, 0x6a, 0x0a,
+    0x95, 0xae, 0x49, 0x8d, 0xbe, 0x93, 0x4a, 0xba, 0x05, 0x08, 0xea, 0x21, 0x3c, 0x82, 0x42, 0x4a,
+    0x5c, 0x42, 0x0d, 0x2f, 0x60, 0x32, 0x09, 0xcf, 0xa6, 0xb0, 0xa5, 0xf0, 0xa8, 0x85, 0x73, 0x2a,
+    0x2d, 0x30, 0xdd, 0x16, 0x5b, 0xa2, 0xaf, 0xe1, 0xf4, 0x15, 0xf0, 0x8e, 0x4e, 0x8f, 0xe0, 0xe4,
+    0xf8, 0xf4, 0xec, 0x57, 0xc9, 0x36, 0x9d, 0x5e, 0xf3, 0x30, 0x27, 0xd2, 0x77, 0xb9, 0x2b, 0x26,
+    0xe4, 0x3d, 0x55, 0xdc, 0x95, 0xf3, 0x96, 0x1c, 0xe8, 0x1c, 0x23, 0x4a, 0x3d, 0xee, 0x73, 0x71,
+    0x38, 0x37, 0x79, 0x3d, 0xb0, 0xf7, 0x2c, 0x72, 0x8f, 0xcd, 0x14, 0x86, 0x65, 0x3d, 0xaa, 0xf7,
+    0x76, 0xa8, 0xaa, 0x34, 0x22, 0x77, 0x1a, 0x5f, 0x7a, 0x8b, 0xb6, 0xa2, 0xa9, 0x1b, 0x1f, 0xc3,
+    0x1e, 0x32, 0xa4, 0xe9, 0xe1, 0x45, 0x5c, 0xe5, 0x76, 0xa8, 0x96, 0x68, 0xae, 0x32, 0xb4, 0xe6,
+    0xdb, 0xcd, 0x07, 0x1e, 0xf8, 0xf6, 0x52, 0xf8, 0xc3, 0x06, 0x1c, 0x63, 0x96, 0xd9, 0x51, 0x7b,
+    0xdc, 0x8e, 0xda, 0xd9, 0x34, 0xce, 0x9b, 0x7a, 0xed, 0x10, 0x27, 0x85, 0xba, 0xa2, 0xfb, 0x15,
+    0xec, 0x4a, 0x9d, 0x50, 0xa9, 0x29, 0x25, 0x7b, 0x9a, 0xae, 0x1a, 0xa1, 0x9d, 0x60, 0x28, 0x24,
+    0xdd, 0x3a, 0x73, 0x5b, 0xac, 0x03, 0xa2, 0x06, 0xbb, 0xd5, 0x2e, 0x5d, 0x90, 0x44, 0x30, 0x0c,
+    0x0d, 0x7e, 0x33, 0x17, 0x85, 0x34, 0xb6, 0x17, 0x33, 0x48, 0x16, 0xa7, 0x91, 0x85, 0x39, 0xfd,
+    0x45, 0xb2, 0x38, 0x89, 0x22, 0x5a, 0x3d, 0x3c, 0xf4, 0x4f, 0x44, 0x13, 0x47, 0x24, 0x12, 0x8a,
+    0x6c, 0xf1, 0x32, 0x1a, 0x92, 0x0d, 0x5d, 0x2a, 0x3d, 0xb1, 0xdd, 0x99, 0x7a, 0x5b, 0x22, 0xf4,
+    0xfa, 0x44, 0xaa, 0x92, 0x0a, 0x81, 0x01, 0xee, 0xd2, 0xe1, 0x84, 0xfc, 0x38, 0xff, 0xfc, 0x29,
+    0x2c, 0x99, 0xd2, 0xb4, 0x13, 0xda, 0x4a, 0xb9, 0x20, 0xa8, 0x0a, 0x34, 0x63, 0x04, 0x59, 0x01,
+    0xb5, 0x84, 0x37, 0x22, 0x56, 0xb2, 0x89, 0x7f, 0xd5, 0xca, 0x76, 0xf9, 0xac, 0xa2, 0x83, 0x28,
+    0xbb, 0x78, 0x56, 0x11, 0xbc, 0xde, 0x73, 0x02, 0x6e, 0x8f, 0xc2, 0x39, 0xd8, 0xdf, 0x2e, 0x0b,
+    0x1e, 0x0a, 0x0e, 0xcf, 0x66, 0x33, 0xa8, 0x24, 0xc7, 0x44, 0x48, 0x6c, 0xe5, 0x9e, 0xec, 0xa7,
+    0x11, 0x26, 0x43, 0xff, 0xb0, 0x30, 0x8e, 0xe6, 0xc8, 0xd2, 0x19, 0xb6, 0x24, 0x55, 0x1f, 0x8e,
+    0xe9, 0x73, 0x04, 0x8d, 0x7f, 0x0e, 0xbe, 0xef, 0x32, 0x7b, 0x92, 0xd5, 0x3e, 0xb0, 0x95, 0xfe,
+    0x8d, 0x96, 0x46, 0xce, 0x96, 0x8d, 0x3b, 0x2e, 0x89, 0x6b, 0xb8, 0xb4, 0x45, 0x24, 0x54, 0x71,
+    0x5d, 0xc4, 0x2c, 0xc3, 0x3b, 0x9a, 0xc7, 0xb9, 0x51, 0x42, 0x2e, 0x6d, 0xfb, 0xb6, 0x9e, 0x9b,
+    0x32, 0xb4, 0x23, 0x66, 0xc1, 0x57, 0x76, 0xe4, 0xe7, 0x45, 0xa5, 0x62, 0x0c, 0xfc, 0xf6, 0x21,
+    0xb6, 0x71, 0xa0, 0x0e, 0x19, 0xe7, 0x6e, 0xf7, 0x5a, 0x68, 0x92, 0x42, 0x45, 0x11, 0xb8, 0x07,
+    0x99, 0x86, 0xbb, 0xe9, 0xd4, 0x53, 0x30, 0xf7, 0x26, 0x1f, 0xa0, 0x0a, 0xda, 0x51, 0xd4, 0xb3,
+    0xd9, 0xde, 0x13, 0x61, 0x5f, 0x88, 0xff, 0xce, 0xf6, 0x16, 0xdb, 0xff, 0x02, 0x4a, 0x28, 0x0c,
+    0x43, 0x9f, 0xde, 0x94, 0xa9, 0xf7, 0x13, 0xeb, 0x26, 0x8d, 0x90, 0x8b, 0x06, 0x00, 0x00,
+};
+
+// upload.js: 727 bytes, 392 gzipped
+static const uint8_t webasset_upload_js[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x8d, 0x51, 0x4b, 0x4b, 0x03, 0x31,
+    0x10, 0xbe, 0xfb, 0x2b, 0xc6, 0x83, 0x64, 0x57, 0x25, 0xad, 0x82, 0x1e, 0x2c, 0x45, 0xb0, 0x55,
+    0x2c, 0x58, 0x2c, 0xb5, 0x05, 0x41, 0x3c, 0xa4, 0xdd, 0xd9, 0xee, 0xc2, 0x6e, 0x12, 0x93, 0x49,
+    0xad, 0x88, 0xff, 0xdd, 0x49, 0x5f, 0x54, 0xb0, 0xe2, 0x69, 0x77, 0x32, 0xf3, 0x3d, 0xe6, 0x9b,
+    0xcc, 0x4c, 0x43, 0x8d, 0x9a, 0xe4, 0x0c, 0xe9, 0xb6, 0xc2, 0xf8, 0x7b, 0xf3, 0xd1, 0xcb, 0x12,
+    0x91, 0x1b, 0x57, 0x8b, 0x54, 0x1a, 0xed, 0xc3, 0xa4, 0x2e, 0x09, 0xda, 0x90, 0x07, 0x3d, 0xa5,
+    0xd2, 0x68, 0x48, 0x30, 0x85, 0xcf, 0x03, 0x00, 0x94, 0xd6, 0xe1, 0x9c, 0x11, 0x5d, 0xcc, 0x55,
+    0xa8, 0x28, 0x49, 0x5b, 0xfc, 0x3a, 0x57, 0x0e, 0xf2, 0xb2, 0x42, 0x46, 0x64, 0x7b, 0xc9, 0xb9,
+    0xcf, 0xe4, 0xf1, 0xe3, 0x5f, 0x9a, 0xaf, 0x1b, 0x98, 0x75, 0xb3, 0xbf, 0x50, 0xdc, 0x16, 0x4b,
+    0x89, 0x32, 0x87, 0xe4, 0x30, 0x82, 0x53, 0x2e, 0x00, 0x1c, 0x52, 0x70, 0x7a, 0x43, 0x92, 0x29,
+    0x52, 0xcc, 0xa2, 0xf1, 0x1d, 0xee, 0x78, 0x87, 0x2e, 0x97, 0x2b, 0x63, 0xb1, 0x21, 0x95, 0xb5,
+    0xa8, 0x99, 0x2b, 0x58, 0x2e, 0x51, 0x9c, 0x2e, 0xad, 0x6e, 0x7d, 0x2f, 0x0a, 0xb7, 0x86, 0x3e,
+    0xf7, 0x1f, 0xee, 0x89, 0xec, 0x10, 0xdf, 0x02, 0xfa, 0xf5, 0x66, 0xdc, 0x95, 0x86, 0xe1, 0x89,
+    0x18, 0x3c, 0x3e, 0x8d, 0x18, 0x2b, 0x1a, 0x79, 0xa5, 0x7c, 0x71, 0xed, 0x0b, 0x75, 0x7e, 0x71,
+    0xd9, 0x16, 0x70, 0x02, 0xa8, 0xa7, 0x26, 0xc3, 0xf1, 0xb0, 0xd7, 0x31, 0xb5, 0x35, 0x9a, 0xbd,
+    0x27, 0x7b, 0xf7, 0x59, 0xc1, 0x38, 0x87, 0xb9, 0xaa, 0x02, 0x4a, 0x72, 0x65, 0x9d, 0xa4, 0xe9,
+    0x56, 0x2a, 0xd8, 0xca, 0xa8, 0x8c, 0x2f, 0x60, 0x9d, 0x99, 0x39, 0xf4, 0xfe, 0xe7, 0x0d, 0xe6,
+    0xb4, 0xba, 0xc2, 0x2a, 0x0e, 0x2e, 0x65, 0x85, 0x7a, 0x46, 0x45, 0x14, 0x0e, 0xa4, 0x26, 0x9b,
+    0x74, 0x20, 0xc6, 0x2a, 0x09, 0x17, 0xd4, 0x31, 0x9a, 0x58, 0x9c, 0x69, 0xc4, 0x60, 0x4d, 0x79,
+    0x05, 0xd1, 0x74, 0x5f, 0x51, 0x21, 0x9d, 0x09, 0x1c, 0xcc, 0x92, 0x87, 0x65, 0x31, 0x83, 0x06,
+    0xc4, 0x82, 0x0c, 0xa9, 0x0a, 0x8e, 0xe1, 0xac, 0xd9, 0x4c, 0x79, 0x54, 0x1c, 0x89, 0xe8, 0xef,
+    0x6b, 0x9b, 0x87, 0x8e, 0xd3, 0x3f, 0x9c, 0xb1, 0xad, 0x5f, 0x24, 0xe3, 0x30, 0x2b, 0x72, 0x26,
+    0x1e, 0x47, 0xdc, 0x69, 0xed, 0x72, 0xa0, 0x73, 0xc6, 0xfd, 0x83, 0x44, 0x8c, 0x97, 0x99, 0x40,
+    0xae, 0xf8, 0x6a, 0x99, 0xd8, 0xe1, 0xf0, 0xf1, 0xaa, 0xf1, 0xc2, 0x1c, 0x1f, 0x3f, 0x7e, 0x03,
+    0xf5, 0xde, 0x39, 0x49, 0xd7, 0x02, 0x00, 0x00,
+};
+
+// upload.html: 468 bytes, 321 gzipped
+static const uint8_t webasset_upload_html[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x55, 0x51, 0xcb, 0x4e, 0xc3, 0x30,
+    0x10, 0xbc, 0xf7, 0x2b, 0x8c, 0x25, 0x24, 0x90, 0x48, 0x5d, 0xe8, 0x83, 0xaa, 0x72, 0x22, 0x21,
+    0x1e, 0xe2, 0x46, 0x25, 0xe0, 0xc0, 0xd1, 0xb5, 0xb7, 0xcd, 0x22, 0x27, 0xb6, 0xec, 0x4d, 0x4a,
+    0xf9, 0x7a, 0x9c, 0xa4, 0x95, 0xe8, 0x69, 0x76, 0xd7, 0x33, 0xe3, 0xf1, 0x5a, 0x5e, 0x3c, 0xbd,
+    0x3d, 0x7e, 0x7c, 0xad, 0x9f, 0x59, 0x49, 0x95, 0x2d, 0x46, 0xf2, 0x04, 0xa0, 0x4c, 0x82, 0x0a,
+    0x48, 0x31, 0x5d, 0xaa, 0x10, 0x81, 0x72, 0xde, 0xd0, 0x36, 0x5b, 0xf2, 0xd3, 0xb8, 0x56, 0x15,
+    0xe4, 0xbc, 0x45, 0xd8, 0x7b, 0x17, 0x88, 0x33, 0xed, 0x6a, 0x82, 0x3a, 0xd1, 0xf6, 0x68, 0xa8,
+    0xcc, 0x0d, 0xb4, 0xa8, 0x21, 0xeb, 0x9b, 0x1b, 0x86, 0x35, 0x12, 0x2a, 0x9b, 0x45, 0xad, 0x2c,
+    0xe4, 0xb7, 0x9d, 0x09, 0x21, 0x59, 0x28, 0x5e, 0x30, 0x54, 0x7b, 0x15, 0x80, 0x35, 0xde, 0x28,
+    0x02, 0x29, 0x86, 0xf1, 0x48, 0x8a, 0x63, 0x84, 0x8d, 0x33, 0x87, 0x04, 0x5b, 0x17, 0x2a, 0x86,
+    0x26, 0xe7, 0x5d, 0x91, 0xe4, 0x4c, 0xfa, 0x42, 0x62, 0xed, 0x1b, 0x62, 0x74, 0xf0, 0x29, 0xc8,
+    0x16, 0x2d, 0xf0, 0x81, 0xd1, 0x57, 0x4a, 0x6b, 0xf0, 0x29, 0xcd, 0x78, 0x83, 0x35, 0x2f, 0xa4,
+    0xf0, 0x83, 0xe6, 0xfd, 0xf5, 0x21, 0xbb, 0x9b, 0x2f, 0xd8, 0x95, 0xf3, 0x84, 0xae, 0x56, 0xf6,
+    0x7a, 0xc5, 0xce, 0x7c, 0x08, 0x7e, 0x68, 0xf0, 0x89, 0xa5, 0x4a, 0x4c, 0xce, 0x22, 0xfe, 0xa6,
+    0xf9, 0x62, 0xf6, 0xcf, 0xe5, 0x4c, 0x11, 0x9b, 0x4d, 0x85, 0x49, 0xd3, 0x2a, 0xdb, 0xa4, 0xf6,
+    0xb3, 0x7f, 0xc8, 0x91, 0x2c, 0x45, 0x97, 0x37, 0xa1, 0xc1, 0xb6, 0x37, 0xf5, 0x61, 0xc7, 0x8b,
+    0x75, 0x70, 0xbb, 0x00, 0x31, 0xae, 0xd8, 0xe4, 0x52, 0x8a, 0x74, 0x94, 0x08, 0x51, 0x07, 0xf4,
+    0xc4, 0x62, 0xd0, 0x39, 0x17, 0x2a, 0xa6, 0x85, 0x47, 0xd1, 0x78, 0xeb, 0x94, 0x19, 0xab, 0x89,
+    0xd1, 0xcb, 0x89, 0x9a, 0x4e, 0xb5, 0xb9, 0x9f, 0xce, 0xe6, 0xf3, 0xf1, 0x77, 0xec, 0xec, 0x07,
+    0x45, 0x77, 0xc7, 0x71, 0x47, 0x62, 0xf8, 0xbc, 0x3f, 0x58, 0x6b, 0xbe, 0x4c, 0xd4, 0x01, 0x00,
+    0x00,
+};
+
+// dashboard.html: 515 bytes, 336 gzipped
+static const uint8_t webasset_dashboard_html[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x6d, 0x91, 0x51, 0x4f, 0xc3, 0x20,
+    0x14, 0x85, 0xdf, 0xf7, 0x2b, 0x90, 0x27, 0x4d, 0x5c, 0x3b, 0xd3, 0x2d, 0xae, 0x49, 0xdb, 0x97,
+    0xa9, 0xf1, 0x4d, 0x93, 0x19, 0x8d, 0x8f, 0x17, 0xb8, 0x15, 0x94, 0xd2, 0x06, 0x6e, 0xb7, 0xec,
+    0xdf, 0x0b, 0xeb, 0x16, 0x13, 0xf5, 0x09, 0x38, 0x7c, 0xdc, 0x73, 0xee, 0xa5, 0xba, 0xb8, 0x7b,
+    0xda, 0xbc, 0xbc, 0x3f, 0xdf, 0x33, 0x4d, 0x9d, 0x6d, 0x66, 0xd5, 0x79, 0x41, 0x50, 0x71, 0xe9,
+    0x90, 0x80, 0x49, 0x0d, 0x3e, 0x20, 0xd5, 0x7c, 0xa4, 0x76, 0xbe, 0xe6, 0x67, 0xd9, 0x41, 0x87,
+    0x35, 0xdf, 0x19, 0xdc, 0x0f, 0xbd, 0x27, 0xce, 0x64, 0xef, 0x08, 0x5d, 0xc4, 0xf6, 0x46, 0x91,
+    0xae, 0x15, 0xee, 0x8c, 0xc4, 0xf9, 0xf1, 0x70, 0xcd, 0x8c, 0x33, 0x64, 0xc0, 0xce, 0x83, 0x04,
+    0x8b, 0xf5, 0x4d, 0x2a, 0x42, 0x86, 0x2c, 0x36, 0x6f, 0x08, 0xa4, 0xd1, 0xb3, 0x40, 0x40, 0xa6,
+    0x77, 0x55, 0x3e, 0xc9, 0xb3, 0xca, 0x1a, 0xf7, 0xc5, 0x3c, 0xda, 0x9a, 0x07, 0x3a, 0x58, 0x0c,
+    0x1a, 0x31, 0x9a, 0x68, 0x8f, 0x6d, 0xcd, 0x73, 0x08, 0x31, 0x50, 0xc8, 0x15, 0x04, 0x2d, 0x7a,
+    0xf0, 0x2a, 0x53, 0x85, 0x28, 0x85, 0x28, 0x8b, 0x12, 0xda, 0x16, 0xc5, 0x4a, 0x64, 0x32, 0x84,
+    0x64, 0x92, 0x9f, 0x1a, 0x11, 0xbd, 0x3a, 0xa4, 0xb6, 0x0a, 0x66, 0x54, 0xcd, 0x8f, 0x1e, 0xfc,
+    0xaf, 0xb7, 0x2e, 0x52, 0x2e, 0x10, 0x16, 0x8f, 0x98, 0x02, 0x02, 0xde, 0xc4, 0x48, 0x49, 0x89,
+    0x37, 0xc3, 0x51, 0x4d, 0xf4, 0x18, 0x8b, 0x6f, 0x7a, 0xe7, 0x50, 0x92, 0x71, 0x1f, 0x59, 0x96,
+    0x55, 0xf9, 0x90, 0x80, 0xa6, 0x82, 0x73, 0x44, 0xde, 0x6c, 0x23, 0x18, 0xaa, 0x1c, 0x1a, 0xf6,
+    0xa3, 0x6a, 0x13, 0xa8, 0xf7, 0x07, 0xde, 0x3c, 0x4e, 0x1b, 0x76, 0xb9, 0xd9, 0xbe, 0x5e, 0xfd,
+    0x82, 0xc6, 0xc1, 0xf6, 0xa0, 0x78, 0xf3, 0x60, 0x7c, 0xb7, 0x07, 0x8f, 0x6c, 0x1c, 0x62, 0x14,
+    0x4c, 0xd4, 0xe4, 0x13, 0xa4, 0x37, 0x03, 0xb1, 0xe0, 0xe5, 0x7f, 0xb3, 0x58, 0xae, 0x57, 0x2b,
+    0xb1, 0x58, 0x2e, 0x96, 0xa5, 0x14, 0x52, 0xa8, 0xdb, 0xec, 0x33, 0xa4, 0x2e, 0xa6, 0x47, 0x69,
+    0x26, 0xa7, 0x61, 0xe4, 0xd3, 0x5f, 0x7f, 0x03, 0x9b, 0x28, 0x2d, 0xc9, 0x03, 0x02, 0x00, 0x00,
+};
+
+static const WebAsset web_assets[] = {
+    { "/assets/dashboard.d3b9bb939affeb5b.css", "text/css", webasset_dashboard_css, sizeof(webasset_dashboard_css), "\"d3b9bb939affeb5b\"", true },
+    { "/assets/dashboard.4855b04049cbcbd7.js", "application/javascript", webasset_dashboard_js, sizeof(webasset_dashboard_js), "\"4855b04049cbcbd7\"", true },
+    { "/assets/upload.a0dc80a33cd73455.js", "application/javascript", webasset_upload_js, sizeof(webasset_upload_js), "\"a0dc80a33cd73455\"", true },
+    { "/upload", "text/html", webasset_upload_html, sizeof(webasset_upload_html), "\"bd8407109d44c02b\"", false },
+    { "/dashboard", "text/html", webasset_dashboard_html, sizeof(webasset_dashboard_html), "\"a9576fc8bae02130\"", false },
+};
+#define WEB_ASSETS  (sizeof(web_assets) / sizeof(web_assets[0]))
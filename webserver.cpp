@@ -1,7 +1,11 @@
 #include "main.h"
+#include "textwriter.h"
+#include "wsbin.h"
+#include "perfecthash.h"
+#include "webassets.h"
+#include "snapshot.h"
 #include <WiFi.h>
 #include <ESPAsyncWebSrv.h>
-#include <Update.h>
 
 // Async web server needs these additional libraries (install via Arduinio IDE Library Manager):
 // https://github.com/dvarrel/ESPAsyncWebSrv
@@ -21,262 +25,736 @@ extern "C" uint8_t temprature_sens_read(); // Very imprecise internal ESP32 temp
 // #define MY_PASS "your-password"
 static const char* ssid = MY_SSID;
 static const char* password = MY_PASS;
-static String webtext_root; // Web response to / (root)
-static String webtext_json; // Web response to /json
 static uint32_t reconnects = 0; // Count how many times WiFi had to reconnect (for stats)
 static String wifi_mac; // WiFi MAC address of this station
-static SemaphoreHandle_t webtext_semaphore; // Semaphore guarding the access to webtext strings as we are building them
 static uint32_t last_request_sec = 0; // Uptime timestamp of the last successfully served request
 static volatile bool ota_restart_pending = false;
 
 AsyncWebServer server(80);
 
-String get_uptime_str(uint32_t sec)
+// Rendered responses live in preallocated static buffers. Only the web server task renders them, one request at a time.
+// A response is rendered on the first request after the weather data changed and is then reused until the data
+// generation moves again. Live values on the root page (RSSI, INT_C...) are therefore refreshed with the sensor data.
+struct CachedResponse
+{
+    uint8_t *buf;       // Static buffer holding the rendered response
+    size_t len;         // Length of the rendered response
+    uint32_t gen;       // Data generation the response was rendered from (0 = never)
+};
+
+static char webtext_root[3072]; // Web response to / (root)
+static char webtext_json[1024]; // Web response to /json
+static uint8_t webbin[WSBIN_MAX_LEN]; // Web response to /bin
+static CachedResponse cached_root = { (uint8_t *)webtext_root };
+static CachedResponse cached_json = { (uint8_t *)webtext_json };
+static CachedResponse cached_bin = { webbin };
+
+// ETags are tied to the data generation, with a random per-boot prefix so that a tag from before a reboot never matches
+static uint32_t etag_boot;
+static uint32_t not_modified = 0; // Count how many times we answered with 304 Not Modified (for stats)
+static uint32_t bytes_saved = 0;  // Response body bytes not sent thanks to 304 answers (for stats)
+
+// Server-Sent Events stream of the 5-sec samples at /events. A new subscriber first gets the full json response and
+// then only the fields that changed. Whoever changes the weather data (the aggregation task after each 5-sec
+// calculation, /set) writes the delta into a ring of messages, and each subscriber's chunked response copies them out
+// in the web server task, the same way as /trace. So only the web server task ever touches the connections, and a
+// subscriber that falls behind is closed on its own; the browser reconnects and resyncs with a full sample.
+#define SSE_MAX_CLIENTS  4  // Maximum number of subscribers; any further connection is refused
+#define SSE_MAX_BACKLOG  4  // Maximum number of messages waiting to be sent to a subscriber
+#define SSE_RING         8  // Messages kept for the subscribers, more than SSE_MAX_BACKLOG
+#define SSE_TEXT_MAX     576
+
+// A message as it goes out on the stream
+struct SseMessage
+{
+    uint16_t len;
+    char text[SSE_TEXT_MAX];
+};
+
+// Position of a subscriber in the stream, allocated when it connects
+struct SseClient
+{
+    uint32_t next;      // Number of the next message to send
+    uint16_t len, pos;  // Message being sent out, and how much of it was sent
+    char text[1100];    // Large enough for the full sample
+};
+
+static SeqLock<SseMessage> sse_ring[SSE_RING];
+static std::atomic<uint32_t> sse_head(0); // Number of messages written so far
+static portMUX_TYPE sse_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t sse_clients = 0;    // Number of subscribers, only used by the web server
+static uint32_t sse_drops = 0;      // Count how many subscribers we had to drop for falling behind (for stats)
+
+static void write_uptime(TextWriter& w, uint32_t sec)
 {
     uint32_t seconds = (sec % 60);
     uint32_t minutes = (sec % 3600) / 60;
     uint32_t hours = (sec % 86400) / 3600;
     uint32_t days = sec / 86400;
-    return String(days) + ":" + String(hours) + ":" + String(minutes) + ":" + String(seconds);
+    w.u32(days).str(":").u32(hours).str(":").u32(minutes).str(":").u32(seconds);
 }
 
-void webserver_set_response()
+// Render the web response to / (root) from a weather data snapshot
+static size_t render_root(const WeatherData& wd, uint32_t gen)
 {
-    // Wait 20 ms before giving up. In practice, there are no other tasks that could block this sem. for longer than that
-    // This task will take the longest due to a number of string operations
-    if (xSemaphoreTake(webtext_semaphore, TickType_t(20)) != pdTRUE)
+    TextWriter w(webtext_root, sizeof(webtext_root));
+
+    // Make this web page auto-refresh every 5 sec
+    w.str("<!DOCTYPE html><html><head><meta http-equiv=\"refresh\" content=\"5\"></head><body><pre>");
+
+    w.str("\nVER = " FIRMWARE_VERSION);
+    w.str("\nID = ").str(wd.id);
+    w.str("\nTAG = ").str(wd.tag);
+    w.str("\nMAC = ").str(wifi_mac.c_str());
+    w.str("\nuptime = "); write_uptime(w, wd.seconds);
+    w.str("\nreconnects = ").u32(reconnects);
+    w.str("\nSSID = " MY_SSID);
+    w.str("\nRSSI = ").i32(WiFi.RSSI()); // Signal strength
+    w.str("\nGPIO_32/39/36 = ").u32(digitalRead(32)).u32(digitalRead(39)).u32(digitalRead(36));
+    w.str("\nINT_C = ").fixed((temprature_sens_read() - 32) / 1.8);
+    w.str("\nanem_count = ").u32(wd.anem_count);
+    w.str("\nerror = ").hex(wd.error);
+    w.str("\nbme_recoveries = ").u32(bme280_recoveries());
+    w.str("\nnot_modified = ").u32(not_modified);
+    w.str("\nbytes_saved = ").u32(bytes_saved);
+    uint32_t nvs_writes, nvs_avoided, nvs_flush_us, nvs_flush_us_max, nvs_errors;
+    int32_t nvs_last_err;
+    pref_stats(nvs_writes, nvs_avoided, nvs_flush_us, nvs_flush_us_max, nvs_errors, nvs_last_err);
+    w.str("\nnvs_writes = ").u32(nvs_writes);
+    w.str("\nnvs_avoided = ").u32(nvs_avoided);
+    w.str("\nnvs_flush_us = ").u32(nvs_flush_us).str("/").u32(nvs_flush_us_max);
+    w.str("\nnvs_errors = ").u32(nvs_errors).str(" (last 0x").hex(uint32_t(nvs_last_err)).str(")");
+    w.str("\nsse_clients = ").u32(sse_clients);
+    w.str("\nsse_drops = ").u32(sse_drops);
+    HistoryStats hist;
+    history_stats(hist);
+    w.str("\nhistory_5s = ").u32(hist.count).str("/").u32(hist.size).str(" (").fixed(hist.sec / 3600.0, 1);
+    w.str(" of ").fixed(hist.size * PERIOD_5_SEC / 3600.0, 1).str(" hr)");
+    w.str("\nhistory_1min = ").u32(hist.coarse_count).str("/").u32(hist.coarse_size).str(" (");
+    w.fixed(hist.coarse_sec / 3600.0, 1).str(" of ").fixed(hist.coarse_size * 60 / 3600.0, 1).str(" hr)");
+    uint32_t raw_depth_max, raw_drops, raw_latency_us, raw_latency_us_max;
+    pipeline_stats(raw_depth_max, raw_drops, raw_latency_us, raw_latency_us_max);
+    w.str("\nqueue_depth_max = ").u32(raw_depth_max);
+    w.str("\nqueue_drops = ").u32(raw_drops);
+    w.str("\nlatency_us = ").u32(raw_latency_us).str("/").u32(raw_latency_us_max);
+    uint32_t tick_done_us, tick_jitter_us_max;
+    tick_stats(tick_done_us, tick_jitter_us_max);
+    w.str("\ntick_jitter_us = ").u32(tick_jitter_us_max);
+    OtaStats ota;
+    ota_stats(ota);
+    if (ota.result != OTA_NONE)
     {
-        wdata.error |= ERROR_SEM_1; // Log this error since we do want to know if 20 ms is ever hit
-        return;
+        static const char *ota_result[] = { "", "unverified", "verified", "bad_hash", "failed" };
+        w.str("\nota = ").str(ota_result[ota.result]).str(", ").u32(ota.bytes).str(" bytes in ").u32(ota.ms);
+        w.str(" ms (").u32(ota.ms ? uint32_t(uint64_t(ota.bytes) * 1000 / ota.ms) : 0).str(" B/s), tick_jitter_us ");
+        w.u32(ota.jitter_us_max);
+        w.str("\nota_sha256 = ").str(ota.sha256);
     }
+    MemStats mem;
+    mem_stats(mem);
+    w.str("\nheap_free = ").u32(mem.heap_free);
+    w.str("\nheap_largest = ").u32(mem.heap_largest);
+    w.str("\nheap_min = ").u32(mem.heap_min);
+    w.str("\nstack_free =");
+    for (int i = 0; i < MEM_TASKS; i++)
+        w.str(" ").str(mem_task_name(i)).str(":").u32(mem.stack_free[i]);
+    w.str("\nmem_low = ").u32(mem.low).str(" (entered ").u32(mem.low_count).str(", shed ").u32(mem.shed).str(")");
+
+    w.str("\ntemp_c_calib = ").fixed(wd.temp_c_calib, 2);
+    w.str("\ntemp_c = ").fixed(wd.temp_c);
+    w.str("\ntemp_f = ").fixed(wd.temp_f);
+    w.str("\npressure = ").fixed(wd.pressure);
+    w.str("\nhumidity = ").fixed(wd.humidity);
+
+    w.str("\nwind_calib = ").fixed(wd.wind_calib, 4); // More decimal places
+    w.str("\nwind_peak = ").fixed(wd.wind_peak);
+    w.str("\nwind_rt = ").fixed(wd.wind_rt);
+    w.str("\nwind_avg = ").fixed(wd.wind_avg);
+    w.str("\nwind_dir_adc = ").i32(wd.wind_dir_adc);
+    w.str("\nwind_dir_rt = ").i32(wd.wind_dir_rt);
+    w.str("\nwind_dir_avg = ").i32(wd.wind_dir_avg);
+    w.str("\nvane_cal = ").u32(wd.vane_cal).str(" (").u32(wd.vane_cal_dirs).str("/16)");
+    w.str("\nvane_adc =");
+    for (int i = 0; i < 16; i++)
+        w.str(" ").u32(wd.vane_adc[i]);
+
+    w.str("\nrain_calib = ").fixed(wd.rain_calib, 4); // More decimal places
+    w.str("\nrain_rate = ").u32(wd.rain_rate);
+    w.str("\nrain_event = ").u32(wd.rain_event);
+    w.str("\nrain_event_max = ").u32(wd.rain_event_max);
+    w.str("\nrain_event_cnt = ").u32(wd.rain_event_cnt);
+    w.str("\nrain_total = ").u32(wd.rain_total);
+    w.str("\nrain_test = ").u32(wd.rain_test);
+
+    w.str("</pre></body></html>\n");
+    return w.length();
+}
 
-    // Make this web page auto-refresh every 5 sec
-    webtext_root = String("<!DOCTYPE html><html><head><meta http-equiv=\"refresh\" content=\"5\"></head><body><pre>");
-    webtext_root.reserve(1024);
-
-    webtext_root += "\nVER = " + String(FIRMWARE_VERSION);
-    webtext_root += "\nID = " + wdata.id;
-    webtext_root += "\nTAG = " + wdata.tag;
-    webtext_root += "\nMAC = " + wifi_mac;
-    webtext_root += "\nuptime = " + get_uptime_str(wdata.seconds);
-    webtext_root += "\nreconnects = " + String(reconnects);
-    webtext_root += "\nSSID = " MY_SSID;
-    webtext_root += "\nRSSI = " + String(WiFi.RSSI()); // Signal strength
-    webtext_root += "\nGPIO_32/39/36 = " + String(digitalRead(32)) + String(digitalRead(39)) + String(digitalRead(36));
-    webtext_root += "\nINT_C = " + String((temprature_sens_read() - 32) / 1.8);
-    webtext_root += "\nanem_count = " + String(wdata.anem_count);
-    webtext_root += "\nerror = " + String(wdata.error, HEX);
-
-    webtext_root += "\ntemp_c_calib = " + String(wdata.temp_c_calib, 2);
-    webtext_root += "\ntemp_c = " + String(wdata.temp_c);
-    webtext_root += "\ntemp_f = " + String(wdata.temp_f);
-    webtext_root += "\npressure = " + String(wdata.pressure);
-    webtext_root += "\nhumidity = " + String(wdata.humidity);   
-
-    webtext_root += "\nwind_calib = " + String(wdata.wind_calib, 4); // More decimal places
-    webtext_root += "\nwind_peak = " + String(wdata.wind_peak);
-    webtext_root += "\nwind_rt = " + String(wdata.wind_rt);
-    webtext_root += "\nwind_avg = " + String(wdata.wind_avg);
-    webtext_root += "\nwind_dir_adc = " + String(wdata.wind_dir_adc);
-    webtext_root += "\nwind_dir_rt = " + String(wdata.wind_dir_rt);
-    webtext_root += "\nwind_dir_avg = " + String(wdata.wind_dir_avg);
-
-    webtext_root += "\nrain_calib = " + String(wdata.rain_calib, 4); // More decimal places
-    webtext_root += "\nrain_rate = " + String(wdata.rain_rate);
-    webtext_root += "\nrain_event = " + String(wdata.rain_event);
-    webtext_root += "\nrain_event_max = " + String(wdata.rain_event_max);
-    webtext_root += "\nrain_event_cnt = " + String(wdata.rain_event_cnt);
-    webtext_root += "\nrain_total = " + String(wdata.rain_total);
-    webtext_root += "\nrain_test = " + String(wdata.rain_test);
-
-    webtext_root += String("</pre></body></html>\n");
-
-    // Format the json response
-    webtext_json = "{";
-    webtext_json.reserve(512);
-    webtext_json += " \"id\":\"" + wdata.id + "\"";
-    webtext_json += ", \"tag\":\"" + wdata.tag + "\"";
-    webtext_json += ", \"uptime\":" + String(wdata.seconds);
+// Render the web response to /json from a weather data snapshot
+static size_t render_json(const WeatherData& wd, uint32_t gen)
+{
+    TextWriter w(webtext_json, sizeof(webtext_json));
+
+    w.str("{");
+    w.str(" \"id\":\"").str(wd.id).str("\"");
+    w.str(", \"tag\":\"").str(wd.tag).str("\"");
+    w.str(", \"uptime\":").u32(wd.seconds);
+    MemStats mem;
+    mem_stats(mem);
+    w.str(", \"heap_free\":").u32(mem.heap_free);
+    w.str(", \"heap_largest\":").u32(mem.heap_largest);
+    w.str(", \"heap_min\":").u32(mem.heap_min);
+    w.str(", \"stack_free\":{");
+    for (int i = 0; i < MEM_TASKS; i++)
+        w.str(i ? ",\"" : "\"").str(mem_task_name(i)).str("\":").u32(mem.stack_free[i]);
+    w.str("}, \"mem_low\":").str(mem.low ? "true" : "false");
     // When out of reset, and until the very fist time we had a chance to read sensors and calculate some meaningful
-    // values, do not attempt to return any data nodes
-    if (wdata.seconds > PERIOD_5_SEC)
+    // values, do not attempt to return any data nodes. The first such snapshot is published at the 5 sec mark.
+    if (wd.seconds >= PERIOD_5_SEC)
     {
-        webtext_json += ", \"temp_c_calib\":" + String(wdata.temp_c_calib, 2);
-        webtext_json += ", \"temp_c\":" + String(wdata.temp_c);
-        webtext_json += ", \"temp_f\":" + String(wdata.temp_f);
-        webtext_json += ", \"pressure\":" + String(wdata.pressure);
-        webtext_json += ", \"humidity\":" + String(wdata.humidity);
-
-        webtext_json += ", \"wind_peak\":" + String(wdata.wind_peak);
-        webtext_json += ", \"wind_rt\":" + String(wdata.wind_rt);
-        webtext_json += ", \"wind_avg\":" + String(wdata.wind_avg);
-        webtext_json += ", \"wind_dir_rt\":" + String(wdata.wind_dir_rt);
-        webtext_json += ", \"wind_dir_avg\":" + String(wdata.wind_dir_avg);
-
-        webtext_json += ", \"rain_calib\":" + String(wdata.rain_calib, 4); // More decimal places
-        webtext_json += ", \"rain_rate\":" + String(wdata.rain_rate);
-        webtext_json += ", \"rain_event\":" + String(wdata.rain_event);
-        webtext_json += ", \"rain_event_cnt\":" + String(wdata.rain_event_cnt);
-        webtext_json += ", \"rain_total\":" + String(wdata.rain_total);
+        w.str(", \"temp_c_calib\":").fixed(wd.temp_c_calib, 2);
+        w.str(", \"temp_c\":").fixed(wd.temp_c);
+        w.str(", \"temp_f\":").fixed(wd.temp_f);
+        w.str(", \"pressure\":").fixed(wd.pressure);
+        w.str(", \"humidity\":").fixed(wd.humidity);
+
+        w.str(", \"wind_calib\":").fixed(wd.wind_calib, 4);
+        w.str(", \"wind_peak\":").fixed(wd.wind_peak);
+        w.str(", \"wind_rt\":").fixed(wd.wind_rt);
+        w.str(", \"wind_avg\":").fixed(wd.wind_avg);
+        w.str(", \"wind_dir_rt\":").i32(wd.wind_dir_rt);
+        w.str(", \"wind_dir_avg\":").i32(wd.wind_dir_avg);
+
+        w.str(", \"rain_calib\":").fixed(wd.rain_calib, 4); // More decimal places
+        w.str(", \"rain_rate\":").u32(wd.rain_rate);
+        w.str(", \"rain_event\":").u32(wd.rain_event);
+        w.str(", \"rain_event_max\":").u32(wd.rain_event_max);
+        w.str(", \"rain_event_cnt\":").u32(wd.rain_event_cnt);
+        w.str(", \"rain_total\":").u32(wd.rain_total);
     }
-    webtext_json += " }";
+    w.str(" }");
+    return w.length();
+}
 
-    xSemaphoreGive(webtext_semaphore);
+// Render the web response to /bin, the same fields as /json in a compact binary encoding (see wsbin.h)
+static size_t render_bin(const WeatherData& wd, uint32_t gen)
+{
+    static_assert(MEM_TASKS == WSBIN_STACKS, "wsbin.h lists the stacks of the tasks that mem_task_name() names");
+    MemStats mem;
+    mem_stats(mem);
+    WsBinSample s;
+    s.flags = ((wd.seconds >= PERIOD_5_SEC) ? WSBIN_FLAG_VALID : 0) | (mem.low ? WSBIN_FLAG_MEM_LOW : 0);
+    s.generation = gen;
+    s.uptime = wd.seconds;
+    s.temp_c_calib = wd.temp_c_calib;
+    s.temp_c = wd.temp_c;
+    s.temp_f = wd.temp_f;
+    s.pressure = wd.pressure;
+    s.humidity = wd.humidity;
+    s.wind_peak = wd.wind_peak;
+    s.wind_rt = wd.wind_rt;
+    s.wind_avg = wd.wind_avg;
+    s.wind_dir_rt = wd.wind_dir_rt;
+    s.wind_dir_avg = wd.wind_dir_avg;
+    s.rain_calib = wd.rain_calib;
+    s.rain_rate = wd.rain_rate;
+    s.rain_event = wd.rain_event;
+    s.rain_event_cnt = wd.rain_event_cnt;
+    s.rain_total = wd.rain_total;
+    s.wind_calib = wd.wind_calib;
+    s.rain_event_max = wd.rain_event_max;
+    s.heap_free = mem.heap_free;
+    s.heap_largest = mem.heap_largest;
+    s.heap_min = mem.heap_min;
+    memcpy(s.stack_free, mem.stack_free, sizeof(s.stack_free));
+    strlcpy(s.id, wd.id, sizeof(s.id));
+    strlcpy(s.tag, wd.tag, sizeof(s.tag));
+    return wsbin_encode(webbin, sizeof(webbin), s);
 }
 
-void handleRoot(AsyncWebServerRequest *request)
+// Render the cached response if the weather data changed since it was last rendered
+static void update_cached(CachedResponse& c, size_t (*render)(const WeatherData&, uint32_t))
 {
-    if (xSemaphoreTake(webtext_semaphore, TickType_t(100)) == pdTRUE)
+    if (wdata_generation() != c.gen)
     {
-        last_request_sec = wdata.seconds;
-        request->send(200, "text/html", webtext_root);
-        xSemaphoreGive(webtext_semaphore);
+        WeatherData wd;
+        c.gen = wdata_snapshot(wd);
+        c.len = render(wd, c.gen);
     }
-    else
-        request->send(503, "text/html", "Resource busy, please retry.");
+}
+
+static void make_etag(char *etag, size_t size, uint32_t gen)
+{
+    TextWriter w(etag, size);
+    w.str("\"").hex(etag_boot).str("-").u32(gen).str("\"");
+}
+
+// In the low memory mode, refuse the optional requests (the rendered HTML page and the streaming responses) with a
+// short answer, so that what is left of the heap goes to the weather data. Returns true if the request was refused.
+static bool shed_request(AsyncWebServerRequest *request)
+{
+    if (!mem_low())
+        return false;
+    mem_shed();
+    request->send(503, "text/plain", "Low memory");
+    return true;
+}
+
+// Sends a response from its static buffer, rendering it first if the weather data changed since the last time. If the
+// client already has the response for the current data generation (If-None-Match), answer 304 with no body instead.
+// Readers work on their own snapshot of the weather data, so they never wait on the aggregation task.
+static void send_cached(AsyncWebServerRequest *request, const char *type, CachedResponse& c,
+                        size_t (*render)(const WeatherData&, uint32_t), Stage stage)
+{
+    StageTimer t = stage_begin();
+    char etag[24];
+    last_request_sec = wdata.seconds;
+
+    uint32_t gen = wdata_generation();
+    if (request->hasHeader("If-None-Match"))
+    {
+        make_etag(etag, sizeof(etag), gen);
+        if (strstr(request->getHeader("If-None-Match")->value().c_str(), etag))
+        {
+            not_modified++;
+            bytes_saved += (c.gen == gen) ? c.len : 0;
+            AsyncWebServerResponse *response = request->beginResponse(304);
+            response->addHeader("ETag", etag);
+            request->send(response);
+            stage_end(stage, t);
+            return;
+        }
+    }
+
+    update_cached(c, render);
+    make_etag(etag, sizeof(etag), c.gen);
+    AsyncResponseStream *response = request->beginResponseStream(type, c.len);
+    response->write(c.buf, c.len);
+    response->addHeader("ETag", etag);
+    response->addHeader("Cache-Control", "no-cache"); // Clients may cache, but have to revalidate every time
+    request->send(response);
+    stage_end(stage, t);
+}
+
+void handleRoot(AsyncWebServerRequest *request)
+{
+    if (shed_request(request))
+        return;
+    send_cached(request, "text/html", cached_root, render_root, STAGE_ROOT);
 }
 
 void handleJson(AsyncWebServerRequest *request)
 {
-    if (xSemaphoreTake(webtext_semaphore, TickType_t(100)) == pdTRUE)
+    send_cached(request, "application/json", cached_json, render_json, STAGE_JSON);
+}
+
+void handleBin(AsyncWebServerRequest *request)
+{
+    send_cached(request, "application/octet-stream", cached_bin, render_bin, STAGE_BIN);
+}
+
+// The static pages (the firmware uploader and the dashboard) and their scripts and style sheet are kept gzipped in
+// flash, see web/gen_webassets.py, and are sent as they are, with no rendering and no copy. The scripts and the style
+// sheet are served under URLs with their content hash, so the browser keeps them for a year without asking again. The
+// pages are the entry points with fixed URLs: the browser revalidates them every time with their content hash, so that
+// a page changed by a firmware update, and the new asset URLs in it, are picked up right away; otherwise it gets a 304.
+static void send_asset(AsyncWebServerRequest *request, const WebAsset& a)
+{
+    if (request->hasHeader("If-None-Match") && strstr(request->getHeader("If-None-Match")->value().c_str(), a.etag))
     {
-        last_request_sec = wdata.seconds;
-        request->send(200, "application/json", webtext_json);
-        xSemaphoreGive(webtext_semaphore);
+        not_modified++;
+        bytes_saved += a.len;
+        AsyncWebServerResponse *response = request->beginResponse(304);
+        response->addHeader("ETag", a.etag);
+        request->send(response);
+        return;
     }
-    else
+    AsyncWebServerResponse *response = request->beginResponse_P(200, a.type, a.data, a.len);
+    response->addHeader("Content-Encoding", "gzip");
+    response->addHeader("ETag", a.etag);
+    response->addHeader("Cache-Control", a.immutable ? "public, max-age=31536000, immutable" : "no-cache");
+    request->send(response);
+}
+
+// Stream the history as CSV: /history?from=<uptime>&to=<uptime>&step=<sec>, all arguments are optional
+// The listing is sent with a chunked response that decodes the records as the client takes them in
+void handleHistory(AsyncWebServerRequest *request)
+{
+    if (shed_request(request))
+        return;
+    uint32_t from = request->hasArg("from") ? strtoul(request->arg("from").c_str(), NULL, 0) : 0;
+    uint32_t to = request->hasArg("to") ? strtoul(request->arg("to").c_str(), NULL, 0) : UINT32_MAX;
+    uint32_t step = request->hasArg("step") ? strtoul(request->arg("step").c_str(), NULL, 0) : 0;
+    last_request_sec = wdata.seconds;
+
+    HistoryCursor cur;
+    history_cursor_init(cur, from, to, step);
+    AsyncWebServerResponse *response = request->beginChunkedResponse("text/csv",
+        [cur](uint8_t *buffer, size_t maxLen, size_t index) mutable -> size_t
+        {
+            return history_read(cur, (char *)buffer, maxLen);
+        });
+    request->send(response);
+}
+
+// Timing histograms of the processing stages in the Prometheus text format, listed a line at a time
+void handleMetrics(AsyncWebServerRequest *request)
+{
+    if (shed_request(request))
+        return;
+    MetricsCursor cur;
+    metrics_cursor_init(cur);
+    AsyncWebServerResponse *response = request->beginChunkedResponse("text/plain; version=0.0.4",
+        [cur](uint8_t *buffer, size_t maxLen, size_t index) mutable -> size_t
+        {
+            return metrics_read(cur, (char *)buffer, maxLen);
+        });
+    request->send(response);
+}
+
+// Stream the trace of the raw sensor inputs for as long as the client stays connected; one client at a time
+// Save it with "curl http://<IP>/trace > storm.wst"; the format is described in trace.h
+void handleTrace(AsyncWebServerRequest *request)
+{
+    if (shed_request(request))
+        return;
+    if (!trace_start())
     {
-        // For json, instead of the error message, return the station id only. We also log this error.
-        wdata.error |= ERROR_SEM_2;
-        request->send(503, "application/json", "{ \"id\":\"" + wdata.id + "\" }");
+        request->send(503, "text/plain", "Trace is already being read");
+        return;
     }
+    request->onDisconnect([]() { trace_stop(); });
+    AsyncWebServerResponse *response = request->beginChunkedResponse("application/octet-stream",
+        [](uint8_t *buffer, size_t maxLen, size_t index) -> size_t
+        {
+            size_t len = trace_read(buffer, maxLen);
+            return len ? len : RESPONSE_TRY_AGAIN; // Nothing new yet, the server will ask again
+        });
+    request->send(response);
 }
 
-template<class T> T parse(String value, char **p_next);
-template<> inline uint32_t parse<uint32_t>(String value, char **p_next) { return strtoul(value.c_str(), p_next, 0); }
-template<> inline float parse<float>(String value, char **p_next) { return strtof(value.c_str(), p_next); }
-template<> inline String parse<String>(String value, char **p_next)
-{
-    value.trim();
-    value.replace("&", "&amp;");  // HTML entity escaping (must be first)
-    value.replace("<", "&lt;");
-    value.replace(">", "&gt;");
-    value.replace("\"", "'"); // Disallow the quotation character to ensure valid JSON output when printed
-    if (value.length() > 64)
-        value = value.substring(0, 64);
-    return value;
+static SseMessage sse_msg;      // Delta message being written, only used with the wdata lock held
+static WeatherData sse_last;    // Weather data as of the last delta, only used with the wdata lock held
+
+// Fill the buffer with the next part of a subscriber's stream; returns 0 if there is nothing new to send yet. Sets drop
+// if the subscriber fell behind and has to be closed.
+static size_t sse_read(SseClient& c, uint8_t *buf, size_t size, bool& drop)
+{
+    size_t len = 0;
+    drop = false;
+    while (len < size)
+    {
+        if (c.pos < c.len)
+        {
+            size_t n = (size_t(c.len - c.pos) < size - len) ? c.len - c.pos : size - len;
+            memcpy(buf + len, c.text + c.pos, n);
+            c.pos += n;
+            len += n;
+            continue;
+        }
+        uint32_t head = sse_head.load(std::memory_order_acquire);
+        if (c.next == head)
+            break;
+
+        // The message slot is written again every SSE_RING messages: its generation tells whether it still holds
+        // this message, or the subscriber fell so far behind that the message was overwritten while it was copied
+        static SseMessage m;
+        uint32_t gen = sse_ring[c.next % SSE_RING].read(m);
+        if ((head - c.next > SSE_MAX_BACKLOG) || (gen != c.next / SSE_RING + 1))
+        {
+            drop = true;
+            break;
+        }
+        memcpy(c.text, m.text, m.len);
+        c.len = m.len;
+        c.pos = 0;
+        c.next++;
+    }
+    return len;
 }
 
-// Parses the GET method ?name=value argument and returns false if the key or its value are not valid
-// When the key name is matched, and the value is correct, it updates the wdata reference variable and its NV value
-template <class T>
-static bool get_parse_value(AsyncWebServerRequest *request, String key_name, T& dest)
+// Stream the weather data to a subscriber for as long as it stays connected
+void handleEvents(AsyncWebServerRequest *request)
 {
-    String value = request->arg(key_name);
-    if (value.length())
+    // In the low memory mode, keep only the first subscriber
+    if ((sse_clients >= SSE_MAX_CLIENTS) || (sse_clients && shed_request(request)))
     {
-        char *p_next;
-        T n = parse<T>(value, &p_next);
+        if (sse_clients >= SSE_MAX_CLIENTS)
+            request->send(503, "text/plain", "Too many subscribers");
+        return;
+    }
+    SseClient *c = new SseClient;
+    c->next = sse_head.load(std::memory_order_acquire);
+    update_cached(cached_json, render_json);
+    TextWriter w(c->text, sizeof(c->text));
+    w.str("id: ").u32(cached_json.gen).str("\nevent: sample\ndata: ");
+    w.str(webtext_json).str("\n\n");
+    c->len = w.length();
+    c->pos = 0;
+    sse_clients++;
+
+    // The request is freed only after its disconnect handler, so the response never reads a freed subscriber
+    request->onDisconnect([c]()
+    {
+        sse_clients--;
+        delete c;
+    });
+    AsyncWebServerResponse *response = request->beginChunkedResponse("text/event-stream",
+        [c](uint8_t *buffer, size_t maxLen, size_t index) -> size_t
+        {
+            bool drop;
+            size_t len = sse_read(*c, buffer, maxLen, drop);
+            if (len)
+                return len;
+            if (drop)
+            {
+                sse_drops++;
+                return 0; // End the response, the browser reconnects and gets a full sample
+            }
+            return RESPONSE_TRY_AGAIN; // Nothing new yet, the server will ask again
+        });
+    response->addHeader("Cache-Control", "no-cache");
+    request->send(response);
+}
+
+// Push the changed fields of the new weather data to all subscribers; called with the wdata lock held by the
+// aggregation task after each 5-sec calculation and by /set. This only writes the message into the ring, it never
+// touches the connections, so it does not wait on a slow subscriber nor race with the web server task.
+void webserver_push_sample(const WeatherData& wd)
+{
+    TextWriter w(sse_msg.text, sizeof(sse_msg.text));
+    w.str("id: ").u32(wdata_generation()).str("\nevent: delta\ndata: ");
+    w.str("{\"uptime\":").u32(wd.seconds);
+    if (strcmp(wd.id, sse_last.id))             w.str(",\"id\":\"").str(wd.id).str("\"");
+    if (strcmp(wd.tag, sse_last.tag))           w.str(",\"tag\":\"").str(wd.tag).str("\"");
+    if (wd.temp_c_calib != sse_last.temp_c_calib) w.str(",\"temp_c_calib\":").fixed(wd.temp_c_calib, 2);
+    if (wd.temp_c != sse_last.temp_c)           w.str(",\"temp_c\":").fixed(wd.temp_c);
+    if (wd.temp_f != sse_last.temp_f)           w.str(",\"temp_f\":").fixed(wd.temp_f);
+    if (wd.pressure != sse_last.pressure)       w.str(",\"pressure\":").fixed(wd.pressure);
+    if (wd.humidity != sse_last.humidity)       w.str(",\"humidity\":").fixed(wd.humidity);
+    if (wd.wind_calib != sse_last.wind_calib)   w.str(",\"wind_calib\":").fixed(wd.wind_calib, 4);
+    if (wd.wind_peak != sse_last.wind_peak)     w.str(",\"wind_peak\":").fixed(wd.wind_peak);
+    if (wd.wind_rt != sse_last.wind_rt)         w.str(",\"wind_rt\":").fixed(wd.wind_rt);
+    if (wd.wind_avg != sse_last.wind_avg)       w.str(",\"wind_avg\":").fixed(wd.wind_avg);
+    if (wd.wind_dir_rt != sse_last.wind_dir_rt) w.str(",\"wind_dir_rt\":").i32(wd.wind_dir_rt);
+    if (wd.wind_dir_avg != sse_last.wind_dir_avg) w.str(",\"wind_dir_avg\":").i32(wd.wind_dir_avg);
+    if (wd.rain_calib != sse_last.rain_calib)   w.str(",\"rain_calib\":").fixed(wd.rain_calib, 4);
+    if (wd.rain_rate != sse_last.rain_rate)     w.str(",\"rain_rate\":").u32(wd.rain_rate);
+    if (wd.rain_event != sse_last.rain_event)   w.str(",\"rain_event\":").u32(wd.rain_event);
+    if (wd.rain_event_max != sse_last.rain_event_max) w.str(",\"rain_event_max\":").u32(wd.rain_event_max);
+    if (wd.rain_event_cnt != sse_last.rain_event_cnt) w.str(",\"rain_event_cnt\":").u32(wd.rain_event_cnt);
+    if (wd.rain_total != sse_last.rain_total)   w.str(",\"rain_total\":").u32(wd.rain_total);
+    w.str("}\n\n");
+    sse_msg.len = w.length();
+    sse_last = wd;
+
+    // A subscriber in the web server task, of a higher priority, must not read the slot half way through the write
+    // (see snapshot.h)
+    uint32_t head = sse_head.load(std::memory_order_relaxed);
+    portENTER_CRITICAL(&sse_mux);
+    sse_ring[head % SSE_RING].write(sse_msg);
+    portEXIT_CRITICAL(&sse_mux);
+    sse_head.store(head + 1, std::memory_order_release);
+}
+
+// Keys that can be set through /set, bound to their WeatherData members. The table is hashed at compile time (see
+// perfecthash.h), so finding a key is O(1) no matter how many there are. A value outside [min, max] is refused.
+enum SetType { SET_U32, SET_FLOAT, SET_STR };
 
-        // Check for validity of int and float types since we read them using strto* functions
-        bool is_string = sizeof(T) == sizeof(String); // Little trick to tell String type apart without having the RTTI support
-        if (is_string || ((p_next != value.c_str()) && (*p_next == 0) && (errno != ERANGE)))
+struct SetKey
+{
+    const char *name;
+    SetType type;
+    uint16_t offset;    // Offset of the member in WeatherData
+    double min, max;    // Valid range of a number
+};
+
+static constexpr SetKey set_keys[] = {
+    { "id",             SET_STR,   offsetof(WeatherData, id) },
+    { "tag",            SET_STR,   offsetof(WeatherData, tag) },
+    { "wind_calib",     SET_FLOAT, offsetof(WeatherData, wind_calib), 0.001, 100 },
+    { "rain_calib",     SET_FLOAT, offsetof(WeatherData, rain_calib), 0.0001, 10 },
+    { "rain_event",     SET_U32,   offsetof(WeatherData, rain_event), 0, UINT32_MAX },
+    { "rain_event_max", SET_U32,   offsetof(WeatherData, rain_event_max), 1, UINT32_MAX },
+    { "rain_event_cnt", SET_U32,   offsetof(WeatherData, rain_event_cnt), 0, UINT32_MAX },
+    { "rain_total",     SET_U32,   offsetof(WeatherData, rain_total), 0, UINT32_MAX },
+    { "error",          SET_U32,   offsetof(WeatherData, error), 0, UINT32_MAX },
+    { "temp_c_calib",   SET_FLOAT, offsetof(WeatherData, temp_c_calib), -50, 50 },
+    { "vane_cal",       SET_U32,   offsetof(WeatherData, vane_cal), 0, 1 },
+};
+#define SET_KEYS       (sizeof(set_keys) / sizeof(set_keys[0]))
+#define SET_SLOT_BITS  4
+#define SET_MAX_ARGS   SET_KEYS // A request can set each key once
+
+static constexpr uint32_t set_seed = ph_seed(set_keys, SET_KEYS, SET_SLOT_BITS);
+static_assert(set_seed != 0, "No perfect hash seed for the /set keys, increase SET_SLOT_BITS");
+
+#define SET_SLOT(i)  ph_slot_key(set_keys, SET_KEYS, set_seed, SET_SLOT_BITS, i)
+static constexpr uint8_t set_slots[1 << SET_SLOT_BITS] = {
+    SET_SLOT(0),  SET_SLOT(1),  SET_SLOT(2),  SET_SLOT(3),  SET_SLOT(4),  SET_SLOT(5),  SET_SLOT(6),  SET_SLOT(7),
+    SET_SLOT(8),  SET_SLOT(9),  SET_SLOT(10), SET_SLOT(11), SET_SLOT(12), SET_SLOT(13), SET_SLOT(14), SET_SLOT(15) };
+static_assert(SET_SLOT_BITS == 4, "Update the set_slots initializer to the number of slots");
+
+// Returns the key with the given name, or NULL
+static const SetKey *set_find(const char *name)
+{
+    uint8_t i = set_slots[ph_slot(name, set_seed, SET_SLOT_BITS)];
+    return ((i != PH_NONE) && (strcmp(set_keys[i].name, name) == 0)) ? &set_keys[i] : NULL;
+}
+
+// Copy a string value, trimmed, escaped for HTML and with the quotation character replaced so that it is valid in the
+// json output, and cut to WD_STR_MAX characters
+static void set_str(char *dest, const char *value)
+{
+    while (isspace((unsigned char)*value))
+        value++;
+    size_t end = strlen(value);
+    while (end && isspace((unsigned char)value[end - 1]))
+        end--;
+
+    TextWriter w(dest, WD_STR_MAX + 1);
+    for (size_t i = 0; i < end; i++)
+    {
+        switch (value[i])
         {
-            dest = n; // Set the wdata.<key_name> member
-            pref_set(key_name.c_str(), n); // Set the new value into the NV variable
-            request->send(200, "text/html", "OK " + String(n));
-            return true;
+            case '&': w.str("&amp;"); break;
+            case '<': w.str("&lt;"); break;
+            case '>': w.str("&gt;"); break;
+            case '"': w.str("'"); break;
+            default:  w.put(value + i, 1); break;
         }
     }
-    return false;
 }
 
-// Set a variable from the client side. The key/value pairs are passed using an HTTP GET method.
+// Parse the value of a key into the weather data; returns false if it is not valid
+static bool set_parse(const SetKey& k, const char *value, WeatherData& wd)
+{
+    void *member = (uint8_t *)&wd + k.offset;
+    if (k.type == SET_STR)
+    {
+        set_str((char *)member, value);
+        return true;
+    }
+
+    char *p_next;
+    errno = 0;
+    double n = (k.type == SET_U32) ? double(strtoul(value, &p_next, 0)) : double(strtof(value, &p_next));
+    // Check for validity since we read the numbers using strto* functions (also rejects a negative u32 and a nan)
+    if (!*value || (*p_next != 0) || (errno == ERANGE) || (*value == '-' && k.type == SET_U32) ||
+        !(n >= k.min && n <= k.max))
+        return false;
+    if (k.type == SET_U32)
+        *(uint32_t *)member = uint32_t(n);
+    else
+        *(float *)member = float(n);
+    return true;
+}
+
+static void set_write_value(TextWriter& w, const SetKey& k, const WeatherData& wd)
+{
+    const void *member = (const uint8_t *)&wd + k.offset;
+    if (k.type == SET_STR)
+        w.str((const char *)member);
+    else if (k.type == SET_U32)
+        w.u32(*(const uint32_t *)member);
+    else
+        w.fixed(*(const float *)member);
+}
+
+static WeatherData set_staged;  // Weather data with the new values applied, only used by the web server task
+static char set_text[256];      // Response to /set
+
+// Set any number of keys at once: /set?name=value&name=value...
+// All values are parsed into a staged copy of the weather data first, and only if every one of them is valid are they
+// applied together, under the wdata lock, so no reader ever sees only some of them. They are then written back to the
+// NVM and published. The NVM has no transactions, so a power loss during the write-back may still keep only some.
+// As with the earlier one-key-at-a-time /set, the arguments that are not keys (a cache buster such as _=<time>) and the
+// keys with an empty value are ignored, so an empty value does not clear a string. An invalid value refuses the whole
+// request, and so does a request with no key to set. The response is "OK" followed by the new value, or by name=value
+// of each key if there are more.
 void handleSet(AsyncWebServerRequest *request)
 {
-    if (xSemaphoreTake(webtext_semaphore, TickType_t(100)) == pdTRUE)
+    const SetKey *keys[SET_MAX_ARGS];
+    const char *values[SET_MAX_ARGS];
+    size_t n = 0;
+    for (size_t i = 0; i < request->params(); i++)
     {
-        last_request_sec = wdata.seconds;
-
-        // Save values that need post-parse validation so we can rollback if invalid
-
-        // Successfully updating a variable should respond with "OK" + the new value
-        bool ok = false;
-        ok |= get_parse_value(request, "id", wdata.id);
-        ok |= get_parse_value(request, "tag", wdata.tag);
-        ok |= get_parse_value(request, "wind_calib", wdata.wind_calib);
-        ok |= get_parse_value(request, "rain_calib", wdata.rain_calib);
-        ok |= get_parse_value(request, "rain_event", wdata.rain_event);
-        ok |= get_parse_value(request, "rain_event_max", wdata.rain_event_max);
-        ok |= get_parse_value(request, "rain_event_cnt", wdata.rain_event_cnt);
-        ok |= get_parse_value(request, "rain_total", wdata.rain_total);
-        ok |= get_parse_value(request, "error", wdata.error);
-        ok |= get_parse_value(request, "temp_c_calib", wdata.temp_c_calib);
-
-        // Post-parse validation: restore previous value if the new one is out of valid range
-
-        if (!ok)
+        const AsyncWebParameter *p = request->getParam(i);
+        const SetKey *k = set_find(p->name().c_str());
+        if (!k || !p->value().length())
+            continue;
+        if (n == SET_MAX_ARGS)
+        {
             request->send(400, "text/html", "?");
-
-        xSemaphoreGive(webtext_semaphore);
+            return;
+        }
+        keys[n] = k;
+        values[n++] = p->value().c_str();
     }
-    else
+    if (n == 0)
+    {
+        request->send(400, "text/html", "?");
+        return;
+    }
+
+    if (!wdata_lock(TickType_t(100)))
+    {
         request->send(503, "text/html", "Resource busy, please retry.");
-}
+        return;
+    }
+    last_request_sec = wdata.seconds;
+
+    set_staged = wdata;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (!set_parse(*keys[i], values[i], set_staged))
+        {
+            wdata_unlock();
+            request->send(400, "text/html", "?");
+            return;
+        }
+    }
+
+    // Apply the new values, mark the NV ones for the write-back and commit them right away
+    TextWriter w(set_text, sizeof(set_text));
+    w.str("OK");
+    for (size_t i = 0; i < n; i++)
+    {
+        const SetKey& k = *keys[i];
+        void *member = (uint8_t *)&wdata + k.offset;
+        memcpy(member, (const uint8_t *)&set_staged + k.offset,
+               (k.type == SET_STR) ? size_t(WD_STR_MAX + 1) : sizeof(uint32_t));
+        pref_changed(member);
+        w.str(" ");
+        if (n > 1)
+            w.str(k.name).str("=");
+        set_write_value(w, k, wdata);
+    }
+    if (!pref_flush())
+        w.str(" (not saved yet)"); // Kept dirty and retried with the next write-back, see pref_flush()
+    wdata_publish();
+    webserver_push_sample(wdata);
+    wdata_unlock();
 
-const char* uploadHtml = " \
-<script src='https://ajax.googleapis.com/ajax/libs/jquery/3.2.1/jquery.min.js'></script> \
-<form method='POST' action='#' enctype='multipart/form-data' id='upload_form'> \
- <input type='file' name='update'> \
-  <input type='submit' value='Update'> \
- </form> \
-<div id='prg'>Progress: 0%</div> \
-<script> \
- $('form').submit(function(e) \
- { \
-  e.preventDefault(); \
-  var form = $('#upload_form')[0]; \
-  var data = new FormData(form); \
-  $.ajax({ \
-   url: '/flash', \
-   type: 'POST', \
-   data: data, \
-   contentType: false, \
-   processData:false, \
-   xhr: function() \
-   { \
-    var xhr = new window.XMLHttpRequest(); \
-    xhr.upload.addEventListener('progress', function(evt) \
-    { \
-     if (evt.lengthComputable) \
-     { \
-      var per = evt.loaded / evt.total; \
-      $('#prg').html('progress: ' + Math.round(per*100) + '%'); \
-     } \
-    }, false); \
-    return xhr; \
-   }, \
-   success:function(d, s) \
-   { \
-       console.log('success!') \
-   }, \
-   error: function (a, b, c) { } \
-  }); \
- }); \
-</script> \
-";
+    request->send(200, "text/html", set_text);
+}
 
 void setup_ota()
 {
-    server.on("/upload", HTTP_GET, [](AsyncWebServerRequest *request)
-    {
-        AsyncWebServerResponse *response = request->beginResponse(200, "text/html", uploadHtml);
-        response->addHeader("Connection", "close");
-        request->send(response);
-    });
     server.on("/flash", HTTP_POST, [](AsyncWebServerRequest *request)
     {
-        AsyncWebServerResponse *response = request->beginResponse(200, "text/plain", (Update.hasError()) ? "FAIL" : "OK");
+        // "OK" only for an image that matched its hash; without one, the client gets the hash to check it against
+        OtaStats ota;
+        ota_stats(ota);
+        char text[96];
+        TextWriter w(text, sizeof(text));
+        if (ota.result == OTA_VERIFIED)
+            w.str("OK");
+        else if (ota.result == OTA_UNVERIFIED)
+            w.str("UNVERIFIED, sha256 ").str(ota.sha256);
+        else
+            w.str("FAIL");
+        AsyncWebServerResponse *response = request->beginResponse(200, "text/plain", text);
         response->addHeader("Connection", "close");
         request->send(response);
     }, [](AsyncWebServerRequest *request, String filename, size_t index, uint8_t *data, size_t len, bool final)
@@ -285,23 +763,18 @@ void setup_ota()
         if (index == 0)
         {
             Serial.printf("Uploading: %s\n", filename.c_str());
-            if (!Update.begin(UPDATE_SIZE_UNKNOWN)) // start with max available size
-                Update.printError(Serial);
-        }
-        if (!Update.hasError())
-        {
-            if (Update.write(data, len) != len) // flashing firmware to ESP
-                Update.printError(Serial);
+            ota_begin();
         }
+        ota_write(data, len);
         if (final)
         {
-            if (Update.end(true)) // true to set the size to the current progress
+            // The expected hash comes in the query string, so it is known before the upload body is processed
+            const char *sha256 = request->hasParam("sha256") ? request->getParam("sha256")->value().c_str() : NULL;
+            if (ota_end(sha256))
             {
                 Serial.println("Flash OK, rebooting...\n");
                 ota_restart_pending = true;
             }
-            else
-                Update.printError(Serial);
         }
     });
 }
@@ -360,13 +833,20 @@ void setup_wifi()
 
 void setup_webserver()
 {
-    webtext_semaphore = xSemaphoreCreateMutex();
-    xSemaphoreGive(webtext_semaphore);
-
-    webserver_set_response();
+    etag_boot = esp_random();
     server.on("/", handleRoot);
     server.on("/json", handleJson);
+    server.on("/bin", handleBin);
     server.on("/set", handleSet);
+    server.on("/history", handleHistory);
+    server.on("/trace", handleTrace);
+    server.on("/metrics", handleMetrics);
+    for (size_t i = 0; i < WEB_ASSETS; i++)
+    {
+        const WebAsset& a = web_assets[i];
+        server.on(a.path, HTTP_GET, [&a](AsyncWebServerRequest *request) { send_asset(request, a); });
+    }
+    server.on("/events", HTTP_GET, handleEvents);
     setup_ota();
     server.begin();
 }
@@ -376,6 +856,8 @@ void wifi_check_loop()
     if (ota_restart_pending)
     {
         delay(500); // Allow the async server to send the "OK" response
+        wdata_lock(portMAX_DELAY); // Stop the aggregation task and write back any pending preferences
+        pref_flush();
         ESP.restart();
     }
     delay(1000);
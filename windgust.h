@@ -0,0 +1,104 @@
+#pragma once
+#include <stdint.h>
+#include "window.h"
+
+// Wind gust meter measuring the anemometer frequency from the time between its pulses
+// Counting pulses over a fixed period quantizes the speed to one pulse per period, which is coarse at low speeds and
+// can not resolve anything shorter than the period itself. Here the frequency of each short sample is calculated from
+// the pulse periods instead: the number of pulses in the sample over the time from the pulse preceding the sample to
+// the last pulse in it. A sample with no pulse in it can not have a higher frequency than if a pulse happened at its
+// end, so the last period is stretched to that time, and the frequency drops to zero after the timeout.
+// The gust is the maximum of the running mean over N samples (WMO: 0.25-sec samples, 3-sec running mean).
+// Timestamps are in microseconds and may wrap around; pulses have to be given in the order they happened.
+template<int N>
+class GustMeter
+{
+public:
+    GustMeter(uint32_t sample_us, uint32_t timeout_us)
+        : sample_us(sample_us), timeout_us(timeout_us), sample_end(0), started(false), have_ref(false), ref_us(0),
+          first_us(0), last_us(0), period_us(0), pulses(0), gust(0), last_hz(0) {}
+
+    // Record an anemometer pulse
+    void pulse(uint32_t t_us)
+    {
+        update(t_us);
+        if (pulses++ == 0)
+            first_us = t_us;
+        last_us = t_us;
+    }
+
+    // Close all samples that ended at the given time
+    void update(uint32_t now_us)
+    {
+        if (!started)
+        {
+            sample_end = now_us + sample_us;
+            started = true;
+        }
+        while (int32_t(now_us - sample_end) >= 0)
+        {
+            close_sample();
+            sample_end += sample_us;
+        }
+    }
+
+    // Returns the highest running mean frequency (in Hz) since the last call
+    float get_and_clear_gust()
+    {
+        float g = gust;
+        gust = 0;
+        return g;
+    }
+
+    float get_last() const { return last_hz; } // Frequency of the last sample
+
+private:
+    void close_sample()
+    {
+        float hz = 0;
+        if (pulses)
+        {
+            // Periods from the pulse preceding the sample, or from the first pulse in it if that one is not known
+            uint32_t start_us = have_ref ? ref_us : first_us;
+            uint32_t periods = have_ref ? pulses : pulses - 1;
+            if (periods)
+            {
+                period_us = (last_us - start_us) / periods;
+                hz = periods * 1e6f / (last_us - start_us);
+            }
+            else
+                period_us = timeout_us; // A single pulse does not tell us the frequency yet
+            ref_us = last_us;
+            have_ref = true;
+            pulses = 0;
+        }
+        else if (have_ref)
+        {
+            uint32_t since_us = sample_end - last_us;
+            if (since_us > timeout_us)
+                have_ref = false; // The wind has stopped; the next pulse starts a new series
+            else
+                hz = 1e6f / ((since_us > period_us) ? since_us : period_us);
+        }
+
+        last_hz = hz;
+        mean.push(hz);
+        float avg = mean.get_avg();
+        if (avg > gust)
+            gust = avg;
+    }
+
+    uint32_t sample_us;   // Sample period
+    uint32_t timeout_us;  // Time without a pulse after which the frequency drops to zero
+    uint32_t sample_end;  // End time of the current sample
+    bool started;
+    bool have_ref;        // The time of the pulse preceding the current sample is known
+    uint32_t ref_us;      // Time of the last pulse before the current sample
+    uint32_t first_us;    // Time of the first pulse in the current sample
+    uint32_t last_us;     // Time of the last pulse
+    uint32_t period_us;   // Last known pulse period
+    uint32_t pulses;      // Number of pulses in the current sample
+    float gust;           // Highest running mean since the last get_and_clear_gust()
+    float last_hz;
+    WindowSum<float, N> mean; // Running mean over the last N samples
+};
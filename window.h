@@ -0,0 +1,98 @@
+#pragma once
+#include <stdint.h>
+#include <type_traits>
+
+// Sliding window templates used to aggregate sensor samples. Each update is O(1) regardless of the window length,
+// so the same code can be used for 2-min, 10-min or 1-hr windows without the cost growing with it.
+// The windows start out filled with zero samples, the same way the original static circular buffers did.
+
+// Fixed-size sliding window that keeps a running sum of its samples. S is the accumulator type, which should be
+// wider than T for small integer sample types (ex. uint8_t samples summed into a uint32_t)
+template<class T, int N, class S = T>
+class WindowSum
+{
+public:
+    WindowSum() { clear(); }
+
+    void clear()
+    {
+        for (int i = 0; i < N; i++)
+            buf[i] = T();
+        next = 0;
+        sum = S();
+    }
+
+    void push(T value)
+    {
+        sum += S(value) - S(buf[next]);
+        buf[next] = value;
+        next = (next + 1) % N;
+
+        // Floating point accumulators slowly drift with the rounding errors of add/subtract pairs; re-sum the buffer
+        // once per full turn of the window. This keeps the amortized cost O(1) and the error bounded forever.
+        if (std::is_floating_point<S>::value && (next == 0))
+        {
+            S s = S();
+            for (int i = 0; i < N; i++)
+                s += S(buf[i]);
+            sum = s;
+        }
+    }
+
+    S get_sum() const { return sum; }
+    S get_avg() const { return sum / N; }
+
+private:
+    T buf[N];
+    uint32_t next;
+    S sum;
+};
+
+// Fixed-size sliding window that tracks the maximum of its samples using a monotonic deque: the deque holds only the
+// samples that can still become the maximum, in decreasing order, so that the front is always the current maximum
+template<class T, int N>
+class WindowMax
+{
+public:
+    WindowMax() { clear(); }
+
+    void clear()
+    {
+        // Start with the window holding N zero samples; only the newest of equal values needs to be kept
+        head = 0;
+        q[0].value = T();
+        q[0].seq = N - 1;
+        count = 1;
+        seq = N;
+    }
+
+    void push(T value)
+    {
+        // Expire the front sample if it slid out of the window
+        if ((count > 0) && (seq - q[head].seq >= uint32_t(N)))
+        {
+            head = (head + 1) % N;
+            count--;
+        }
+        // Drop all samples from the back that are not larger than the new one; they can never become the maximum
+        while ((count > 0) && !(q[(head + count - 1) % N].value > value))
+            count--;
+        Entry& e = q[(head + count) % N];
+        e.value = value;
+        e.seq = seq++;
+        count++;
+    }
+
+    T get_max() const { return q[head].value; }
+
+private:
+    struct Entry
+    {
+        T value;
+        uint32_t seq;   // Monotonic sample number, used to expire samples that slid out of the window
+    };
+    Entry q[N];         // Circular deque of at most N entries
+    uint32_t head;      // Index of the front (maximum) entry
+    uint32_t count;     // Number of entries in the deque
+    uint32_t seq;       // Sample number of the next pushed sample
+};
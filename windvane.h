@@ -0,0 +1,135 @@
+#pragma once
+#include <stdint.h>
+
+// Wind vane of the Argent Data Systems weather assembly 80422: conversion of the ADC reading to a direction
+// This header has no dependencies on Arduino, so the conversion can be built and profiled off-device.
+//
+// ADC returns 0-4096 corresponding to 0V to 3.3V but it is not linear
+// https://docs.espressif.com/projects/esp-idf/en/latest/api-reference/peripherals/adc.html
+//
+// The vane switches one of 16 resistors (or a pair of them in the in-between directions) against an on-board pullup.
+// This table contains values that are measured on an actual wind vane that is in use, with a 10k Ohm on-board pullup.
+// They are the default calibration: the ADC value of each direction (its centroid).
+//
+// Direction     Resistance  Voltage (mV)
+// (Degrees)     (Ohms)      measured   ADC range   avg.
+//     0     N   33k         2535       2966,2990   2978
+//     22.5      6.57k       1308       1424,1436   1430
+//     45    NE  8.2k        1487       1650,1664   1657
+//     67.5      891          273       143,143     143
+//
+//     90    E   1k           303       175,178     176
+//     112.5     688          216       68,71       70
+//     135   SE  2.2k         596       536,545     540
+//     157.5     1.41k        408       306,307     307
+//
+//     180   S   3.9k         921       939,945     942
+//     202.5     3.14k        785       774,775     775
+//     225   SW  16k         2028       2319,2337   2328
+//     247.5     14.12k      1929       2212,2217   2215
+//
+//     270   W   120k        3051       3889,3912   3900
+//     292.5     42.12k      2669       3173,3176   3175
+//     315   NW  64.9k       2862       3485,3503   3494
+//     337.5     21.88k      2266       2633,2638   2636
+
+#define VANE_DIRS       16
+#define VANE_ADC_MAX    4096
+#define VANE_LUT_SHIFT  2    // The lookup table has one entry per 4 ADC values, closer than any two directions
+#define VANE_LUT_SIZE   (VANE_ADC_MAX >> VANE_LUT_SHIFT)
+#define VANE_CAL_MIN    12   // Samples of each direction the auto-calibration needs before it is done
+
+static const uint16_t vane_default_adc[VANE_DIRS] = {
+    2978, 1430, 1657, 143, 176, 70, 540, 307, 942, 775, 2328, 2215, 3900, 3175, 3494, 2636 };
+
+// Converts the ADC reading into the direction 0-15, N->E->S->W->, with a lookup table of the direction whose ADC
+// value is the closest. The table is built from the calibration, which the auto-calibration can learn on site:
+// each reading is taken as a sample of the direction it is closest to, and the direction's ADC value moves to the
+// running mean of its samples. Once every direction has been seen often enough, the learned values can be stored.
+class WindVane
+{
+public:
+    WindVane() : cal_active(false) { set_calibration(vane_default_adc); }
+
+    // Given the ADC sensor reading, returns the wind direction 0-15
+    int dir(int adc) const
+    {
+        adc = (adc < 0) ? 0 : (adc >= VANE_ADC_MAX) ? VANE_ADC_MAX - 1 : adc;
+        return lut[adc >> VANE_LUT_SHIFT];
+    }
+
+    void set_calibration(const uint16_t adc[VANE_DIRS])
+    {
+        for (int d = 0; d < VANE_DIRS; d++)
+            centroid[d] = adc[d];
+        build_lut();
+    }
+
+    const uint16_t *get_calibration() const { return centroid; }
+
+    void cal_start()
+    {
+        for (int d = 0; d < VANE_DIRS; d++)
+        {
+            cal_sum[d] = centroid[d]; // The current value counts as the first sample
+            cal_count[d] = 1;
+        }
+        cal_active = true;
+    }
+
+    void cal_stop() { cal_active = false; }
+    bool cal_running() const { return cal_active; }
+
+    // Returns the number of directions that have been seen often enough
+    int cal_progress() const
+    {
+        if (!cal_active)
+            return 0;
+        int n = 0;
+        for (int d = 0; d < VANE_DIRS; d++)
+            n += (cal_count[d] > VANE_CAL_MIN);
+        return n;
+    }
+
+    // Learn from a new reading; returns true when the calibration is complete and has been applied
+    bool cal_sample(int adc)
+    {
+        if (!cal_active)
+            return false;
+        int d = dir(adc);
+        cal_sum[d] += adc;
+        cal_count[d]++;
+        centroid[d] = (cal_sum[d] + cal_count[d] / 2) / cal_count[d];
+        build_lut();
+        if (cal_progress() < VANE_DIRS)
+            return false;
+        cal_active = false;
+        return true;
+    }
+
+private:
+    void build_lut()
+    {
+        for (int i = 0; i < VANE_LUT_SIZE; i++)
+        {
+            int adc = (i << VANE_LUT_SHIFT) + (1 << VANE_LUT_SHIFT) / 2;
+            int best = 0, best_dist = VANE_ADC_MAX;
+            for (int d = 0; d < VANE_DIRS; d++)
+            {
+                int dist = (adc > centroid[d]) ? adc - centroid[d] : centroid[d] - adc;
+                if (dist < best_dist)
+                {
+                    best_dist = dist;
+                    best = d;
+                }
+            }
+            lut[i] = best;
+        }
+    }
+
+    uint16_t centroid[VANE_DIRS];  // ADC value of each direction
+    uint8_t lut[VANE_LUT_SIZE];    // Direction for each group of ADC values
+    bool cal_active;
+    uint32_t cal_sum[VANE_DIRS];   // Auto-calibration: sum of the samples of each direction
+    uint32_t cal_count[VANE_DIRS]; // Auto-calibration: number of samples of each direction
+};
@@ -0,0 +1,194 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Compact binary encoding of the weather data served at /bin, for high-frequency pollers
+// This header has no dependencies on Arduino, so clients can use it as the decoder library.
+//
+// All values are little-endian, floats are IEEE-754 single precision. The layout is versioned: fields are only ever
+// appended at the end of the fixed part, and a decoder accepts any newer version whose fixed part is at least as long
+// as the one it knows about.
+//
+//  Offset  Size  Field
+//  0       2     Magic "WS"
+//  2       1     Version (WSBIN_VERSION)
+//  3       1     Flags (WSBIN_FLAG_*)
+//  4       2     Total length of the message
+//  6       2     Length of the fixed part (offset of the strings)
+//  8       4     Data generation
+//  12      4     uptime
+//  16      4     temp_c_calib (float)
+//  20      4     temp_c (float)
+//  24      4     temp_f (float)
+//  28      4     pressure (float)
+//  32      4     humidity (float)
+//  36      4     wind_peak (float)
+//  40      4     wind_rt (float)
+//  44      4     wind_avg (float)
+//  48      2     wind_dir_rt
+//  50      2     wind_dir_avg
+//  52      4     rain_calib (float)
+//  56      4     rain_rate
+//  60      4     rain_event
+//  64      4     rain_event_cnt
+//  68      4     rain_total
+//  Version 2:
+//  72      4     wind_calib (float)
+//  76      4     rain_event_max
+//  80      4     heap_free
+//  84      4     heap_largest
+//  88      4     heap_min
+//  92      20    stack_free of task_acquire, task_aggregate, task_vane, async_tcp and loopTask
+//  112           id, tag: each as 1 byte length followed by that many characters
+//
+// A version 1 message (fixed part of 72 bytes) still decodes, with the version 2 fields left at 0.
+
+#define WSBIN_VERSION      2
+#define WSBIN_FIXED_LEN_V1 72
+#define WSBIN_FIXED_LEN    112
+#define WSBIN_STR_MAX      64
+#define WSBIN_STACKS       5
+#define WSBIN_MAX_LEN      (WSBIN_FIXED_LEN + 2 * (1 + WSBIN_STR_MAX))
+#define WSBIN_FLAG_VALID   0x01 // Sensor fields are valid (the station had a chance to read the sensors)
+#define WSBIN_FLAG_MEM_LOW 0x02 // The station is in its low memory mode (mem_low)
+
+struct WsBinSample
+{
+    uint8_t flags;
+    uint32_t generation;
+    uint32_t uptime;
+    float temp_c_calib;
+    float temp_c;
+    float temp_f;
+    float pressure;
+    float humidity;
+    float wind_peak;
+    float wind_rt;
+    float wind_avg;
+    uint16_t wind_dir_rt;
+    uint16_t wind_dir_avg;
+    float rain_calib;
+    uint32_t rain_rate;
+    uint32_t rain_event;
+    uint32_t rain_event_cnt;
+    uint32_t rain_total;
+    float wind_calib;
+    uint32_t rain_event_max;
+    uint32_t heap_free;
+    uint32_t heap_largest;
+    uint32_t heap_min;
+    uint32_t stack_free[WSBIN_STACKS];
+    char id[WSBIN_STR_MAX + 1];
+    char tag[WSBIN_STR_MAX + 1];
+};
+
+static inline void wsbin_put16(uint8_t *p, uint16_t v) { p[0] = v; p[1] = v >> 8; }
+static inline void wsbin_put32(uint8_t *p, uint32_t v) { p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24; }
+static inline void wsbin_putf(uint8_t *p, float f) { uint32_t v; memcpy(&v, &f, 4); wsbin_put32(p, v); }
+static inline uint16_t wsbin_get16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+static inline uint32_t wsbin_get32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24);
+}
+static inline float wsbin_getf(const uint8_t *p) { uint32_t v = wsbin_get32(p); float f; memcpy(&f, &v, 4); return f; }
+
+// Encode the sample into the buffer, which should be at least WSBIN_MAX_LEN bytes; returns the message length or 0
+static inline size_t wsbin_encode(uint8_t *buf, size_t size, const WsBinSample& s)
+{
+    if (size < WSBIN_MAX_LEN)
+        return 0;
+    buf[0] = 'W';
+    buf[1] = 'S';
+    buf[2] = WSBIN_VERSION;
+    buf[3] = s.flags;
+    wsbin_put16(buf + 6, WSBIN_FIXED_LEN);
+    wsbin_put32(buf + 8, s.generation);
+    wsbin_put32(buf + 12, s.uptime);
+    wsbin_putf(buf + 16, s.temp_c_calib);
+    wsbin_putf(buf + 20, s.temp_c);
+    wsbin_putf(buf + 24, s.temp_f);
+    wsbin_putf(buf + 28, s.pressure);
+    wsbin_putf(buf + 32, s.humidity);
+    wsbin_putf(buf + 36, s.wind_peak);
+    wsbin_putf(buf + 40, s.wind_rt);
+    wsbin_putf(buf + 44, s.wind_avg);
+    wsbin_put16(buf + 48, s.wind_dir_rt);
+    wsbin_put16(buf + 50, s.wind_dir_avg);
+    wsbin_putf(buf + 52, s.rain_calib);
+    wsbin_put32(buf + 56, s.rain_rate);
+    wsbin_put32(buf + 60, s.rain_event);
+    wsbin_put32(buf + 64, s.rain_event_cnt);
+    wsbin_put32(buf + 68, s.rain_total);
+    wsbin_putf(buf + 72, s.wind_calib);
+    wsbin_put32(buf + 76, s.rain_event_max);
+    wsbin_put32(buf + 80, s.heap_free);
+    wsbin_put32(buf + 84, s.heap_largest);
+    wsbin_put32(buf + 88, s.heap_min);
+    for (int i = 0; i < WSBIN_STACKS; i++)
+        wsbin_put32(buf + 92 + 4 * i, s.stack_free[i]);
+
+    size_t len = WSBIN_FIXED_LEN;
+    const char *str[2] = { s.id, s.tag };
+    for (int i = 0; i < 2; i++)
+    {
+        size_t n = strnlen(str[i], WSBIN_STR_MAX);
+        buf[len++] = n;
+        memcpy(buf + len, str[i], n);
+        len += n;
+    }
+    wsbin_put16(buf + 4, len);
+    return len;
+}
+
+// Decode a message into the sample; returns false if the message is not valid
+static inline bool wsbin_decode(const uint8_t *buf, size_t len, WsBinSample& s)
+{
+    if ((len < 8) || (buf[0] != 'W') || (buf[1] != 'S') || (buf[2] < 1))
+        return false;
+    size_t fixed = wsbin_get16(buf + 6);
+    if ((wsbin_get16(buf + 4) != len) || (fixed < WSBIN_FIXED_LEN_V1) || (fixed > len))
+        return false;
+
+    s.flags = buf[3];
+    s.generation = wsbin_get32(buf + 8);
+    s.uptime = wsbin_get32(buf + 12);
+    s.temp_c_calib = wsbin_getf(buf + 16);
+    s.temp_c = wsbin_getf(buf + 20);
+    s.temp_f = wsbin_getf(buf + 24);
+    s.pressure = wsbin_getf(buf + 28);
+    s.humidity = wsbin_getf(buf + 32);
+    s.wind_peak = wsbin_getf(buf + 36);
+    s.wind_rt = wsbin_getf(buf + 40);
+    s.wind_avg = wsbin_getf(buf + 44);
+    s.wind_dir_rt = wsbin_get16(buf + 48);
+    s.wind_dir_avg = wsbin_get16(buf + 50);
+    s.rain_calib = wsbin_getf(buf + 52);
+    s.rain_rate = wsbin_get32(buf + 56);
+    s.rain_event = wsbin_get32(buf + 60);
+    s.rain_event_cnt = wsbin_get32(buf + 64);
+    s.rain_total = wsbin_get32(buf + 68);
+    bool v2 = fixed >= WSBIN_FIXED_LEN;
+    s.wind_calib = v2 ? wsbin_getf(buf + 72) : 0;
+    s.rain_event_max = v2 ? wsbin_get32(buf + 76) : 0;
+    s.heap_free = v2 ? wsbin_get32(buf + 80) : 0;
+    s.heap_largest = v2 ? wsbin_get32(buf + 84) : 0;
+    s.heap_min = v2 ? wsbin_get32(buf + 88) : 0;
+    for (int i = 0; i < WSBIN_STACKS; i++)
+        s.stack_free[i] = v2 ? wsbin_get32(buf + 92 + 4 * i) : 0;
+
+    size_t pos = fixed;
+    char *str[2] = { s.id, s.tag };
+    for (int i = 0; i < 2; i++)
+    {
+        if (pos >= len)
+            return false;
+        size_t n = buf[pos++];
+        if ((n > WSBIN_STR_MAX) || (pos + n > len))
+            return false;
+        memcpy(str[i], buf + pos, n);
+        str[i][n] = 0;
+        pos += n;
+    }
+    return true;
+}